@@ -0,0 +1,287 @@
+package by.radioegor146;
+
+import org.objectweb.asm.Opcodes;
+import org.objectweb.asm.tree.AbstractInsnNode;
+import org.objectweb.asm.tree.FrameNode;
+import org.objectweb.asm.tree.InsnList;
+import org.objectweb.asm.tree.IntInsnNode;
+import org.objectweb.asm.tree.JumpInsnNode;
+import org.objectweb.asm.tree.LabelNode;
+import org.objectweb.asm.tree.LdcInsnNode;
+import org.objectweb.asm.tree.LineNumberNode;
+import org.objectweb.asm.tree.LookupSwitchInsnNode;
+import org.objectweb.asm.tree.MethodNode;
+import org.objectweb.asm.tree.TableSwitchInsnNode;
+import org.objectweb.asm.tree.TryCatchBlockNode;
+
+import java.util.HashSet;
+import java.util.Set;
+
+/**
+ * A constant array initializer as javac emits it: {@code NEWARRAY} of a
+ * constant size followed by {@code DUP; <index>; <value>; xASTORE} for every
+ * element. Instead of one JNI store per element, the values are kept in a
+ * masked static blob and written with a single {@code Set*ArrayRegion} call.
+ */
+public final class ConstantArrayFill {
+
+    /** Shorter runs are left to the per-element handlers. */
+    static final int MIN_ELEMENTS = 2;
+
+    /** Index of the last instruction of the run. */
+    public final int end;
+    /** Line of the last line number node inside the run, or -1. */
+    public final int line;
+    private final int arrayType;
+    private final int start;
+    private final long[] bits;
+
+    private ConstantArrayFill(int end, int line, int arrayType, int start, long[] bits) {
+        this.end = end;
+        this.line = line;
+        this.arrayType = arrayType;
+        this.start = start;
+        this.bits = bits;
+    }
+
+    /**
+     * @return labels that a run must not skip: targets of jumps and switches,
+     * and try-catch boundaries, which carry handler state
+     */
+    public static Set<LabelNode> getReferencedLabels(MethodNode method) {
+        Set<LabelNode> labels = new HashSet<>();
+        for (AbstractInsnNode insn : method.instructions) {
+            if (insn instanceof JumpInsnNode) {
+                labels.add(((JumpInsnNode) insn).label);
+            } else if (insn instanceof TableSwitchInsnNode) {
+                labels.add(((TableSwitchInsnNode) insn).dflt);
+                labels.addAll(((TableSwitchInsnNode) insn).labels);
+            } else if (insn instanceof LookupSwitchInsnNode) {
+                labels.add(((LookupSwitchInsnNode) insn).dflt);
+                labels.addAll(((LookupSwitchInsnNode) insn).labels);
+            }
+        }
+        if (method.tryCatchBlocks != null) {
+            for (TryCatchBlockNode tryCatch : method.tryCatchBlocks) {
+                labels.add(tryCatch.start);
+                labels.add(tryCatch.end);
+                labels.add(tryCatch.handler);
+            }
+        }
+        return labels;
+    }
+
+    /**
+     * Matches the stores following the {@code NEWARRAY} at {@code index}.
+     *
+     * @return {@code null} if fewer than {@link #MIN_ELEMENTS} consecutive
+     * elements are stored with constants within the array's constant size
+     */
+    public static ConstantArrayFill match(InsnList instructions, int index, Set<LabelNode> referencedLabels) {
+        AbstractInsnNode newArray = instructions.get(index);
+        if (newArray.getOpcode() != Opcodes.NEWARRAY || index == 0) {
+            return null;
+        }
+        Number size = getConstant(instructions.get(index - 1));
+        if (!(size instanceof Integer)) {
+            return null;
+        }
+        int arrayType = ((IntInsnNode) newArray).operand;
+        int storeOpcode = getStoreOpcode(arrayType);
+
+        long[] bits = new long[Math.max(0, (Integer) size)];
+        int start = -1;
+        int count = 0;
+        int end = index;
+        int line = -1;
+        int pending = -1;
+        for (int i = index + 1; i + 3 < instructions.size(); ) {
+            AbstractInsnNode insn = instructions.get(i);
+            if (insn instanceof LineNumberNode || insn instanceof FrameNode
+                    || (insn instanceof LabelNode && !referencedLabels.contains(insn))) {
+                if (insn instanceof LineNumberNode) {
+                    pending = ((LineNumberNode) insn).line;
+                }
+                i++;
+                continue;
+            }
+            if (insn.getOpcode() != Opcodes.DUP || instructions.get(i + 3).getOpcode() != storeOpcode) {
+                break;
+            }
+            Number elementIndex = getConstant(instructions.get(i + 1));
+            Number value = getConstant(instructions.get(i + 2));
+            if (!(elementIndex instanceof Integer) || value == null
+                    || (start < 0 ? (Integer) elementIndex < 0 : (Integer) elementIndex != start + count)
+                    || (Integer) elementIndex >= bits.length || !isValueFor(arrayType, value)) {
+                break;
+            }
+            if (start < 0) {
+                start = (Integer) elementIndex;
+            }
+            bits[start + count] = toBits(arrayType, value);
+            count++;
+            end = i + 3;
+            if (pending >= 0) {
+                line = pending;
+                pending = -1;
+            }
+            i += 4;
+        }
+        if (count < MIN_ELEMENTS) {
+            return null;
+        }
+        long[] elements = new long[count];
+        System.arraycopy(bits, start, elements, 0, count);
+        return new ConstantArrayFill(end, line, arrayType, start, elements);
+    }
+
+    public int getCount() {
+        return bits.length;
+    }
+
+    /**
+     * @param array C++ expression of the freshly created array
+     * @param key   mask seed, mirrored by {@code utils::fill_array}
+     */
+    public String toCpp(String array, long key) {
+        StringBuilder data = new StringBuilder();
+        long state = key;
+        for (int i = 0; i < bits.length; i++) {
+            state = state * 6364136223846793005L + 1442695040888963407L;
+            long masked = bits[i] ^ (state ^ (state >>> 29));
+            if (i > 0) {
+                data.append(", ");
+            }
+            switch (getWidth()) {
+                case 8:
+                    data.append(masked & 0xFF);
+                    break;
+                case 16:
+                    data.append(masked & 0xFFFF);
+                    break;
+                case 32:
+                    data.append(masked & 0xFFFFFFFFL).append("U");
+                    break;
+                default:
+                    data.append(Long.toUnsignedString(masked)).append("ULL");
+                    break;
+            }
+        }
+        String arrayName = getArrayName();
+        return String.format("{ static const uint%d_t __ngen_fill[] = { %s }; "
+                        + "utils::fill_array(env, (j%sArray) %s, __ngen_fill, %d, %d, %sULL, &JNIEnv::Set%sArrayRegion); }",
+                getWidth(), data, arrayName.toLowerCase(), array, start, bits.length,
+                Long.toUnsignedString(key), arrayName);
+    }
+
+    private int getWidth() {
+        switch (arrayType) {
+            case Opcodes.T_BOOLEAN:
+            case Opcodes.T_BYTE:
+                return 8;
+            case Opcodes.T_CHAR:
+            case Opcodes.T_SHORT:
+                return 16;
+            case Opcodes.T_INT:
+            case Opcodes.T_FLOAT:
+                return 32;
+            default:
+                return 64;
+        }
+    }
+
+    private String getArrayName() {
+        switch (arrayType) {
+            case Opcodes.T_BOOLEAN:
+                return "Boolean";
+            case Opcodes.T_BYTE:
+                return "Byte";
+            case Opcodes.T_CHAR:
+                return "Char";
+            case Opcodes.T_SHORT:
+                return "Short";
+            case Opcodes.T_INT:
+                return "Int";
+            case Opcodes.T_FLOAT:
+                return "Float";
+            case Opcodes.T_LONG:
+                return "Long";
+            default:
+                return "Double";
+        }
+    }
+
+    private static int getStoreOpcode(int arrayType) {
+        switch (arrayType) {
+            case Opcodes.T_BOOLEAN:
+            case Opcodes.T_BYTE:
+                return Opcodes.BASTORE;
+            case Opcodes.T_CHAR:
+                return Opcodes.CASTORE;
+            case Opcodes.T_SHORT:
+                return Opcodes.SASTORE;
+            case Opcodes.T_INT:
+                return Opcodes.IASTORE;
+            case Opcodes.T_FLOAT:
+                return Opcodes.FASTORE;
+            case Opcodes.T_LONG:
+                return Opcodes.LASTORE;
+            default:
+                return Opcodes.DASTORE;
+        }
+    }
+
+    private static boolean isValueFor(int arrayType, Number value) {
+        switch (arrayType) {
+            case Opcodes.T_FLOAT:
+                return value instanceof Float;
+            case Opcodes.T_LONG:
+                return value instanceof Long;
+            case Opcodes.T_DOUBLE:
+                return value instanceof Double;
+            default:
+                return value instanceof Integer;
+        }
+    }
+
+    private static long toBits(int arrayType, Number value) {
+        switch (arrayType) {
+            case Opcodes.T_BOOLEAN:
+                // bastore keeps only the lowest bit for boolean arrays
+                return value.intValue() & 1;
+            case Opcodes.T_FLOAT:
+                return Float.floatToRawIntBits(value.floatValue()) & 0xFFFFFFFFL;
+            case Opcodes.T_DOUBLE:
+                return Double.doubleToRawLongBits(value.doubleValue());
+            default:
+                return value.longValue();
+        }
+    }
+
+    private static Number getConstant(AbstractInsnNode insn) {
+        int opcode = insn.getOpcode();
+        if (opcode >= Opcodes.ICONST_M1 && opcode <= Opcodes.ICONST_5) {
+            return opcode - Opcodes.ICONST_0;
+        }
+        switch (opcode) {
+            case Opcodes.LCONST_0:
+            case Opcodes.LCONST_1:
+                return (long) (opcode - Opcodes.LCONST_0);
+            case Opcodes.FCONST_0:
+            case Opcodes.FCONST_1:
+            case Opcodes.FCONST_2:
+                return (float) (opcode - Opcodes.FCONST_0);
+            case Opcodes.DCONST_0:
+            case Opcodes.DCONST_1:
+                return (double) (opcode - Opcodes.DCONST_0);
+            case Opcodes.BIPUSH:
+            case Opcodes.SIPUSH:
+                return ((IntInsnNode) insn).operand;
+            case Opcodes.LDC:
+                Object cst = ((LdcInsnNode) insn).cst;
+                return cst instanceof Number ? (Number) cst : null;
+            default:
+                return null;
+        }
+    }
+}
@@ -5,7 +5,7 @@ import java.util.HashMap;
 import java.util.LinkedHashMap;
 import java.util.Map;
 import java.util.Objects;
-import java.util.concurrent.ThreadLocalRandom;
+import java.util.Random;
 import java.util.regex.Matcher;
 import java.util.regex.Pattern;
 
@@ -66,7 +66,7 @@ public class ControlFlowFlattener {
         private final Map<Integer, Integer> stateSalts = new HashMap<>();
 
         private DefaultStateObfuscation() {
-            ThreadLocalRandom random = ThreadLocalRandom.current();
+            Random random = RandomSource.current();
             this.xorMask = random.nextInt();
             int candidate;
             do {
@@ -210,7 +210,7 @@ public class ControlFlowFlattener {
         }
 
         private int getSalt(int rawState) {
-            return stateSalts.computeIfAbsent(rawState, ignored -> ThreadLocalRandom.current().nextInt());
+            return stateSalts.computeIfAbsent(rawState, ignored -> RandomSource.current().nextInt());
         }
     }
 
@@ -259,6 +259,29 @@ public class ControlFlowFlattener {
         flattened.append("    volatile int __ngen_state = ")
                 .append(stateObfuscation.generateEncodeExpression(initialState))
                 .append(";\n");
+        appendDispatchLoop(flattened, stateBlocks, defaultBlock, stateObfuscation);
+        return flattened.toString();
+    }
+
+    /**
+     * Emits one region of a state machine that was split across several C++
+     * functions. The state variable lives in the caller's frame and is bound
+     * by reference; states outside the region run {@code exitBlock}.
+     */
+    public static String generateStateMachineRegion(String stateReference,
+                                                    Map<Integer, StringBuilder> stateBlocks,
+                                                    String exitBlock,
+                                                    StateObfuscation obfuscation) {
+        Objects.requireNonNull(obfuscation, "obfuscation");
+        StringBuilder flattened = new StringBuilder();
+        obfuscation.appendPrologue(flattened, "    ");
+        flattened.append("    volatile int &__ngen_state = ").append(stateReference).append(";\n");
+        appendDispatchLoop(flattened, stateBlocks, exitBlock, obfuscation);
+        return flattened.toString();
+    }
+
+    private static void appendDispatchLoop(StringBuilder flattened, Map<Integer, StringBuilder> stateBlocks,
+                                           String defaultBlock, StateObfuscation stateObfuscation) {
         flattened.append("    while (true) {\n");
         flattened.append("        switch (__ngen_state) {\n");
 
@@ -291,7 +314,6 @@ public class ControlFlowFlattener {
 
         flattened.append("        }\n");
         flattened.append("    }\n\n");
-        return flattened.toString();
     }
 
     public static String flattenControlFlow(String originalCode, String methodName) {
@@ -303,9 +325,9 @@ public class ControlFlowFlattener {
             return originalCode;
         }
 
-        long seed = ThreadLocalRandom.current().nextLong();
+        long seed = RandomSource.current().nextLong();
         int realState = generateStateId(methodName, seed);
-        int[] dummyStates = generateDummyStates(realState, 3 + ThreadLocalRandom.current().nextInt(5));
+        int[] dummyStates = generateDummyStates(realState, 3 + RandomSource.current().nextInt(5));
 
         StateObfuscation stateObfuscation = createObfuscation(methodName);
         StringBuilder flattened = new StringBuilder();
@@ -365,7 +387,7 @@ public class ControlFlowFlattener {
         int[] dummyStates = new int[count];
         for (int i = 0; i < count; i++) {
             do {
-                dummyStates[i] = ThreadLocalRandom.current().nextInt(100000) + 2000;
+                dummyStates[i] = RandomSource.current().nextInt(100000) + 2000;
             } while (dummyStates[i] == realState);
         }
         return dummyStates;
@@ -375,7 +397,7 @@ public class ControlFlowFlattener {
         StringBuilder dummy = new StringBuilder();
 
         dummy.append("            volatile int __dummy = 0x")
-             .append(Integer.toHexString(ThreadLocalRandom.current().nextInt()))
+             .append(Integer.toHexString(RandomSource.current().nextInt()))
              .append(";\n");
         dummy.append("            volatile jlong __temp = 0;\n");
 
@@ -383,13 +405,13 @@ public class ControlFlowFlattener {
             "            __temp = (jlong)(__dummy ^ 0xDEADBEEF);\n",
             "            __dummy = (int)(__temp & 0xFFFFFFFF);\n",
             "            if (__dummy == 0x12345678) { __dummy ^= 0x87654321; }\n",
-            "            __dummy = __dummy ^ 0x" + Integer.toHexString(ThreadLocalRandom.current().nextInt()) + ";\n",
+            "            __dummy = __dummy ^ 0x" + Integer.toHexString(RandomSource.current().nextInt()) + ";\n",
             "            __temp = __temp + (__dummy & 0xFF);\n"
         };
 
-        int numOps = 2 + ThreadLocalRandom.current().nextInt(3);
+        int numOps = 2 + RandomSource.current().nextInt(3);
         for (int i = 0; i < numOps; i++) {
-            dummy.append(dummyOperations[ThreadLocalRandom.current().nextInt(dummyOperations.length)]);
+            dummy.append(dummyOperations[RandomSource.current().nextInt(dummyOperations.length)]);
         }
         return dummy.toString();
     }
@@ -436,8 +458,8 @@ public class ControlFlowFlattener {
 
     public static String obfuscateVariableNames(String code) {
         return code
-            .replaceAll("\\btemp\\b", "__ngen_tmp_" + ThreadLocalRandom.current().nextInt(1000))
-            .replaceAll("\\bindex\\b", "__ngen_idx_" + ThreadLocalRandom.current().nextInt(1000))
-            .replaceAll("\\bresult\\b", "__ngen_res_" + ThreadLocalRandom.current().nextInt(1000));
+            .replaceAll("\\btemp\\b", "__ngen_tmp_" + RandomSource.current().nextInt(1000))
+            .replaceAll("\\bindex\\b", "__ngen_idx_" + RandomSource.current().nextInt(1000))
+            .replaceAll("\\bresult\\b", "__ngen_res_" + RandomSource.current().nextInt(1000));
     }
 }
@@ -0,0 +1,346 @@
+package by.radioegor146;
+
+import java.util.ArrayList;
+import java.util.HashSet;
+import java.util.LinkedHashMap;
+import java.util.List;
+import java.util.Map;
+import java.util.Set;
+import java.util.TreeSet;
+import java.util.regex.Matcher;
+import java.util.regex.Pattern;
+
+/**
+ * Splits the state machine of an oversized native method into several C++
+ * functions. Optimising compilers scale super-linearly with function size, and
+ * a single huge switch over thousands of states also spills every stack slot,
+ * so each region of consecutive states becomes a {@code static} part function.
+ * <p>
+ * All variables shared between states (operand stack, locals, the reference
+ * set, the class cache locals and the current state) move into a per-method
+ * frame struct owned by the JNI entry point, which also points parts at its
+ * {@code NATIVE_JVM_REF_METRICS} scope. Parts bind the members they use by
+ * reference under their usual names, so state blocks are emitted unchanged. A
+ * part returns to the entry point when control leaves its region, and the entry
+ * point dispatches on the state to the part that owns it.
+ */
+public final class FunctionSplitter {
+
+    /** Default limit for the generated C++ size of one function, in characters. */
+    public static final int DEFAULT_MAX_FUNCTION_SIZE = 128 * 1024;
+
+    private static final Pattern FRAME_NAME_PATTERN = Pattern.compile(
+            "\\b(cstack\\d+|clocal\\d+|__ngen_local_class_(?:ready_)?\\d+|clazz|classloader|lookup|refs"
+                    + "|__ngen_ref_metrics)\\b");
+
+    private FunctionSplitter() {
+    }
+
+    /**
+     * Cuts {@code stateBlocks} (in emission order) into consecutive regions
+     * whose total size stays under {@code maxSize}. A region is preferably cut
+     * before one of the {@code leaders} (basic block entries) in its second
+     * half, so straight-line code stays in one part; a single block larger than
+     * the limit gets a part of its own.
+     */
+    public static List<List<Integer>> partition(Map<Integer, StringBuilder> stateBlocks, Set<Integer> leaders,
+                                                int maxSize) {
+        List<List<Integer>> parts = new ArrayList<>();
+        List<Integer> current = new ArrayList<>();
+        List<Integer> sizes = new ArrayList<>();
+        int size = 0;
+        for (Map.Entry<Integer, StringBuilder> entry : stateBlocks.entrySet()) {
+            int blockSize = entry.getValue().length();
+            while (!current.isEmpty() && size + blockSize > maxSize) {
+                int cut = current.size();
+                for (int i = current.size() - 1; i >= (current.size() + 1) / 2; i--) {
+                    if (leaders.contains(current.get(i))) {
+                        cut = i;
+                        break;
+                    }
+                }
+                parts.add(new ArrayList<>(current.subList(0, cut)));
+                current = new ArrayList<>(current.subList(cut, current.size()));
+                sizes = new ArrayList<>(sizes.subList(cut, sizes.size()));
+                size = 0;
+                for (int s : sizes) {
+                    size += s;
+                }
+            }
+            current.add(entry.getKey());
+            sizes.add(blockSize);
+            size += blockSize;
+        }
+        if (!current.isEmpty()) {
+            parts.add(current);
+        }
+        return parts;
+    }
+
+    /** Layout of the variables shared by all parts of one method. */
+    public static final class Frame {
+        final String functionName;
+        final String returnType;
+        final int maxStack;
+        final int maxLocals;
+        final Set<Integer> classCacheIds;
+
+        public Frame(String functionName, String returnType, int maxStack, int maxLocals,
+                     Set<Integer> classCacheIds) {
+            this.functionName = functionName;
+            this.returnType = returnType;
+            this.maxStack = maxStack;
+            this.maxLocals = maxLocals;
+            this.classCacheIds = new TreeSet<>(classCacheIds);
+        }
+
+        String typeName() {
+            return functionName + "_frame";
+        }
+
+        String partName(int part) {
+            return functionName + "_part" + part;
+        }
+
+        String declare() {
+            StringBuilder out = new StringBuilder();
+            out.append("struct ").append(typeName()).append(" {\n");
+            out.append("    jclass clazz = nullptr;\n");
+            out.append("    jobject classloader = nullptr;\n");
+            out.append("    jobject lookup = nullptr;\n");
+            appendMembers(out, "cstack", maxStack);
+            appendMembers(out, "clocal", maxLocals);
+            out.append("    std::unordered_set<jobject> refs;\n");
+            for (int id : classCacheIds) {
+                out.append(String.format("    jclass __ngen_local_class_%d = nullptr;\n", id));
+                out.append(String.format("    bool __ngen_local_class_ready_%d = false;\n", id));
+            }
+            out.append("#ifdef NATIVE_JVM_REF_METRICS\n");
+            out.append("    utils::ref_metrics_scope *ref_metrics = nullptr;\n");
+            out.append("#endif\n");
+            out.append("    int state = 0;\n");
+            out.append("    bool resume = false;\n");
+            out.append("};\n\n");
+            return out.toString();
+        }
+
+        private static void appendMembers(StringBuilder out, String prefix, int count) {
+            if (count == 0) {
+                return;
+            }
+            out.append("    jvalue ");
+            for (int i = 0; i < count; i++) {
+                out.append(prefix).append(i).append(" = {}");
+                if (i != count - 1) {
+                    out.append(", ");
+                }
+            }
+            out.append(";\n");
+        }
+
+        /**
+         * Replaces the entry point's own declarations of the shared variables.
+         * The entry point still loads the arguments into the locals and
+         * reports on {@code refs}, so those keep their names.
+         */
+        String bind() {
+            StringBuilder out = new StringBuilder();
+            out.append("    ").append(typeName()).append(" __ngen_frame;\n");
+            out.append("    __ngen_frame.clazz = clazz;\n");
+            out.append("    __ngen_frame.classloader = classloader;\n");
+            if (maxLocals > 0) {
+                out.append("    jvalue ");
+                for (int i = 0; i < maxLocals; i++) {
+                    out.append(String.format("&clocal%d = __ngen_frame.clocal%d", i, i));
+                    if (i != maxLocals - 1) {
+                        out.append(", ");
+                    }
+                }
+                out.append(";\n");
+            }
+            out.append("    std::unordered_set<jobject> &refs = __ngen_frame.refs;\n");
+            return out.toString();
+        }
+
+        String exit() {
+            return "    __ngen_frame.resume = true;\n    return (" + returnType + ") 0;\n";
+        }
+    }
+
+    /** Generated code of a split method. */
+    public static final class Result {
+        /** Frame struct and part functions, emitted before the entry point. */
+        public final String declarations;
+        /** Replaces the shared variable declarations in the entry point prologue. */
+        public final String frameBinding;
+        /** Dispatch loop that ends the entry point. */
+        public final String dispatcher;
+
+        Result(String declarations, String frameBinding, String dispatcher) {
+            this.declarations = declarations;
+            this.frameBinding = frameBinding;
+            this.dispatcher = dispatcher;
+        }
+    }
+
+    /**
+     * Emits the parts of a split method.
+     *
+     * @param obfuscation state encoding when control flow flattening is on,
+     *                    {@code null} for the goto-based linear layout
+     */
+    public static Result split(Frame frame, LinkedHashMap<Integer, StringBuilder> stateBlocks,
+                               List<List<Integer>> parts, int initialState, String defaultBlock,
+                               ControlFlowFlattener.StateObfuscation obfuscation) {
+        StringBuilder declarations = new StringBuilder(frame.declare());
+        StringBuilder dispatcher = new StringBuilder();
+        // The metrics scope is declared after the frame binding, so it is
+        // linked here, right before the first part runs
+        dispatcher.append("#ifdef NATIVE_JVM_REF_METRICS\n");
+        dispatcher.append("    __ngen_frame.ref_metrics = &__ngen_ref_metrics;\n");
+        dispatcher.append("#endif\n");
+        dispatcher.append("    __ngen_frame.state = ").append(caseValue(initialState, obfuscation)).append(";\n");
+        dispatcher.append("    while (true) {\n");
+        dispatcher.append("        __ngen_frame.resume = false;\n");
+        dispatcher.append("        switch (__ngen_frame.state) {\n");
+
+        List<Integer> order = new ArrayList<>(stateBlocks.keySet());
+        int emitted = 0;
+        for (int part = 0; part < parts.size(); part++) {
+            List<Integer> states = parts.get(part);
+            emitted += states.size();
+            // The last block may fall through to the next state in emission order
+            String tail = emitted < order.size()
+                    ? transition(order.get(emitted), obfuscation)
+                    : defaultBlock;
+
+            LinkedHashMap<Integer, StringBuilder> region = new LinkedHashMap<>();
+            for (int i = 0; i < states.size(); i++) {
+                StringBuilder block = stateBlocks.get(states.get(i));
+                if (i == states.size() - 1) {
+                    block = new StringBuilder(block).append(tail);
+                }
+                region.put(states.get(i), block);
+            }
+            String body = obfuscation != null
+                    ? ControlFlowFlattener.generateStateMachineRegion("__ngen_frame.state", region, frame.exit(), obfuscation)
+                    : linearRegion(frame, region);
+
+            declarations.append("static ").append(frame.returnType).append(' ').append(frame.partName(part))
+                    .append("(JNIEnv *env, ").append(frame.typeName()).append(" &__ngen_frame) {\n");
+            declarations.append(bindUsed(body));
+            declarations.append(body);
+            declarations.append("}\n\n");
+
+            for (int i = 0; i < states.size(); i++) {
+                dispatcher.append(i % 8 == 0 ? "        " : " ")
+                        .append("case ").append(caseValue(states.get(i), obfuscation)).append(':');
+                if (i % 8 == 7 && i != states.size() - 1) {
+                    dispatcher.append('\n');
+                }
+            }
+            dispatcher.append(" {\n");
+            if ("void".equals(frame.returnType)) {
+                dispatcher.append("            ").append(frame.partName(part)).append("(env, __ngen_frame);\n");
+                dispatcher.append("            if (!__ngen_frame.resume) return;\n");
+            } else {
+                dispatcher.append("            ").append(frame.returnType).append(" __ngen_ret = ")
+                        .append(frame.partName(part)).append("(env, __ngen_frame);\n");
+                dispatcher.append("            if (!__ngen_frame.resume) return __ngen_ret;\n");
+            }
+            dispatcher.append("            break;\n");
+            dispatcher.append("        }\n");
+        }
+        dispatcher.append("        default:\n");
+        dispatcher.append(defaultBlock);
+        dispatcher.append("        }\n");
+        dispatcher.append("    }\n");
+        return new Result(declarations.toString(), frame.bind(), dispatcher.toString());
+    }
+
+    private static String caseValue(int state, ControlFlowFlattener.StateObfuscation obfuscation) {
+        return String.valueOf(obfuscation != null ? obfuscation.encodeCase(state) : state);
+    }
+
+    private static String transition(int state, ControlFlowFlattener.StateObfuscation obfuscation) {
+        StringBuilder out = new StringBuilder();
+        if (obfuscation != null) {
+            ControlFlowFlattener.appendStateTransition(out, "            ", "__ngen_state", state, obfuscation);
+        } else {
+            out.append("            __ngen_state = ").append(state).append("; break;\n");
+        }
+        return out.toString();
+    }
+
+    /**
+     * Goto-based region: an entry switch jumps to the label of the resumed
+     * state, transitions inside the region stay gotos and transitions out of it
+     * store the target in the frame and return.
+     */
+    private static String linearRegion(Frame frame, LinkedHashMap<Integer, StringBuilder> region) {
+        Set<String> local = new HashSet<>();
+        for (int state : region.keySet()) {
+            local.add(String.valueOf(state));
+        }
+        StringBuilder out = new StringBuilder();
+        out.append("    switch (__ngen_frame.state) {\n");
+        for (int state : region.keySet()) {
+            out.append("        case ").append(state).append(": goto ")
+                    .append(MethodProcessor.getLinearLabelName(String.valueOf(state))).append(";\n");
+        }
+        out.append("        default: goto __ngen_exit;\n");
+        out.append("    }\n");
+        for (Map.Entry<Integer, StringBuilder> entry : region.entrySet()) {
+            out.append("    ").append(MethodProcessor.getLinearLabelName(String.valueOf(entry.getKey()))).append(":\n");
+            String block = MethodProcessor.linearizeStateAssignments(entry.getValue().toString(),
+                    rawState -> local.contains(rawState)
+                            ? "goto " + MethodProcessor.getLinearLabelName(rawState) + ";"
+                            : "{ __ngen_frame.state = " + rawState + "; goto __ngen_exit; }");
+            out.append(block);
+            if (!block.isEmpty() && block.charAt(block.length() - 1) != '\n') {
+                out.append('\n');
+            }
+        }
+        out.append("    __ngen_exit:\n");
+        out.append(frame.exit());
+        return out.toString();
+    }
+
+    /** Binds the frame members a part refers to under their usual names. */
+    private static String bindUsed(String body) {
+        Set<String> used = new TreeSet<>();
+        Matcher matcher = FRAME_NAME_PATTERN.matcher(body);
+        while (matcher.find()) {
+            used.add(matcher.group(1));
+        }
+        StringBuilder out = new StringBuilder();
+        for (String name : used) {
+            switch (name) {
+                case "clazz":
+                    out.append("    jclass clazz = __ngen_frame.clazz;\n");
+                    break;
+                case "classloader":
+                    out.append("    jobject classloader = __ngen_frame.classloader;\n");
+                    break;
+                case "lookup":
+                    out.append("    jobject &lookup = __ngen_frame.lookup;\n");
+                    break;
+                case "refs":
+                    out.append("    std::unordered_set<jobject> &refs = __ngen_frame.refs;\n");
+                    break;
+                case "__ngen_ref_metrics":
+                    out.append("#ifdef NATIVE_JVM_REF_METRICS\n");
+                    out.append("    utils::ref_metrics_scope &__ngen_ref_metrics = *__ngen_frame.ref_metrics;\n");
+                    out.append("#endif\n");
+                    break;
+                default:
+                    String type = name.startsWith("__ngen_local_class_ready_") ? "bool"
+                            : name.startsWith("__ngen_local_class_") ? "jclass" : "jvalue";
+                    out.append("    ").append(type).append(" &").append(name)
+                            .append(" = __ngen_frame.").append(name).append(";\n");
+                    break;
+            }
+        }
+        return out.toString();
+    }
+}
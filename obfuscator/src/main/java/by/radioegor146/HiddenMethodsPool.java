@@ -5,9 +5,10 @@ import org.objectweb.asm.Type;
 import org.objectweb.asm.tree.ClassNode;
 import org.objectweb.asm.tree.MethodNode;
 
-import java.util.ArrayList;
 import java.util.HashMap;
-import java.util.List;
+import java.util.Map;
+import java.util.SortedMap;
+import java.util.TreeMap;
 import java.util.function.Consumer;
 
 public class HiddenMethodsPool {
@@ -18,17 +19,29 @@ public class HiddenMethodsPool {
         this.baseName = baseName;
     }
 
-    private final HashMap<String, Integer> namePool = new HashMap<>();
-    private final HashMap<String, HashMap<String, HiddenMethod>> methods = new HashMap<>();
-    private final List<ClassNode> classes = new ArrayList<>();
+    private static class HiddenClass {
+        final ClassNode classNode;
+        final HashMap<String, Integer> namePool = new HashMap<>();
+        final HashMap<String, HashMap<String, HiddenMethod>> methods = new HashMap<>();
+
+        HiddenClass(ClassNode classNode) {
+            this.classNode = classNode;
+        }
+    }
+
+    // One hidden class per obfuscated class, keyed by its class index, so
+    // the helpers of a class do not depend on the classes processed before it
+    private final SortedMap<Integer, HiddenClass> classes = new TreeMap<>();
 
     public static class HiddenMethod {
 
         private final ClassNode classNode;
+        private final int classIndex;
         private final MethodNode methodNode;
 
-        private HiddenMethod(ClassNode classNode, MethodNode methodNode) {
+        private HiddenMethod(ClassNode classNode, int classIndex, MethodNode methodNode) {
             this.classNode = classNode;
+            this.classIndex = classIndex;
             this.methodNode = methodNode;
         }
 
@@ -36,37 +49,60 @@ public class HiddenMethodsPool {
             return classNode;
         }
 
+        /**
+         * @return index passed to {@code utils::define_hidden_class}
+         */
+        public int getClassIndex() {
+            return classIndex;
+        }
+
         public MethodNode getMethodNode() {
             return methodNode;
         }
     }
 
-    public HiddenMethod getMethod(String name, String desc, Consumer<MethodNode> creator) {
-        HiddenMethod existingMethod = methods.computeIfAbsent(name, unused -> new HashMap<>()).get(desc);
+    public HiddenMethod getMethod(int classIndex, String name, String desc, Consumer<MethodNode> creator) {
+        HiddenClass hiddenClass = classes.computeIfAbsent(classIndex, unused -> {
+            ClassNode classNode = new ClassNode(Opcodes.ASM7);
+            classNode.access = Opcodes.ACC_PUBLIC;
+            classNode.version = 52;
+            classNode.name = baseName + "/Hidden" + classIndex;
+            classNode.superName = Type.getInternalName(Object.class);
+            return new HiddenClass(classNode);
+        });
+        HiddenMethod existingMethod = hiddenClass.methods.computeIfAbsent(name, unused -> new HashMap<>()).get(desc);
         if (existingMethod != null) {
             return existingMethod;
         }
 
-        String newName = name + namePool.compute(name, (otherName, value) -> value == null ? 0 : value + 1);
+        String newName = name + hiddenClass.namePool.compute(name, (otherName, value) -> value == null ? 0 : value + 1);
         MethodNode newMethod = new MethodNode(Opcodes.ACC_PUBLIC | Opcodes.ACC_STATIC | Opcodes.ACC_BRIDGE |
                 Opcodes.ACC_SYNTHETIC, newName, desc, null, new String[0]);
         creator.accept(newMethod);
-        ClassNode classNode = classes.isEmpty() ? null : classes.get(classes.size() - 1).methods.size() > 10000 ? null : classes.get(classes.size() - 1);
-        if (classNode == null) {
-            classNode = new ClassNode(Opcodes.ASM7);
-            classNode.access = Opcodes.ACC_PUBLIC;
-            classNode.version = 52;
-            classNode.name = baseName + "/Hidden" + classes.size();
-            classNode.superName = Type.getInternalName(Object.class);
-            classes.add(classNode);
-        }
-        classNode.methods.add(newMethod);
-        HiddenMethod hiddenMethod = new HiddenMethod(classNode, newMethod);
-        methods.computeIfAbsent(name, unused -> new HashMap<>()).put(desc, hiddenMethod);
+        hiddenClass.classNode.methods.add(newMethod);
+        HiddenMethod hiddenMethod = new HiddenMethod(hiddenClass.classNode, classIndex, newMethod);
+        hiddenClass.methods.get(name).put(desc, hiddenMethod);
         return hiddenMethod;
     }
 
-    public List<ClassNode> getClasses() {
-        return classes;
+    /**
+     * @return hidden classes by class index
+     */
+    public SortedMap<Integer, ClassNode> getClasses() {
+        SortedMap<Integer, ClassNode> result = new TreeMap<>();
+        classes.forEach((index, hiddenClass) -> result.put(index, hiddenClass.classNode));
+        return result;
+    }
+
+    /**
+     * @return index of the hidden class named {@code name}, or -1 if it is not one
+     */
+    public int getClassIndex(String name) {
+        for (Map.Entry<Integer, HiddenClass> entry : classes.entrySet()) {
+            if (entry.getValue().classNode.name.equals(name)) {
+                return entry.getKey();
+            }
+        }
+        return -1;
     }
 }
@@ -5,7 +5,6 @@ import org.objectweb.asm.Label;
 import java.util.HashSet;
 import java.util.Set;
 import java.util.WeakHashMap;
-import java.util.concurrent.ThreadLocalRandom;
 
 public class LabelPool {
 
@@ -15,7 +14,7 @@ public class LabelPool {
     private int generateKey() {
         int key;
         do {
-            key = ThreadLocalRandom.current().nextInt();
+            key = RandomSource.current().nextInt();
         } while (usedStates.contains(key));
         usedStates.add(key);
         return key;
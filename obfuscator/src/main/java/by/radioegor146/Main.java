@@ -76,6 +76,15 @@ public class Main {
         @CommandLine.Option(names = {"--enable-native-obfuscation"}, defaultValue = "true", description = "Enable native obfuscation (default: true)")
         private boolean enableNativeObfuscation;
 
+        @CommandLine.Option(names = {"--seed"}, description = "Seed for reproducible output: identical input and seed produce identical sources and jars")
+        private Long seed;
+
+        @CommandLine.Option(names = {"--max-function-size"}, description = "Split generated C++ functions larger than this many characters (default: ${DEFAULT-VALUE}, 0 disables)")
+        private int maxFunctionSize = FunctionSplitter.DEFAULT_MAX_FUNCTION_SIZE;
+
+        @CommandLine.Option(names = {"--hot-methods"}, description = "File with a list of classes/methods, in whitelist format, whose native code is placed with the hot runtime helpers")
+        private File hotMethodsFile;
+
         @Override
         public Integer call() throws Exception {
             List<Path> libs = new ArrayList<>();
@@ -106,7 +115,16 @@ public class Main {
                 javaWhiteList = Files.readAllLines(javaWhiteListFile.toPath(), StandardCharsets.UTF_8);
             }
 
-            new NativeObfuscator().process(jarFile.toPath(), Paths.get(outputDirectory),
+            List<String> hotMethods = null;
+            if (hotMethodsFile != null) {
+                hotMethods = Files.readAllLines(hotMethodsFile.toPath(), StandardCharsets.UTF_8);
+            }
+
+            NativeObfuscator obfuscator = new NativeObfuscator();
+            obfuscator.setSeed(seed);
+            obfuscator.setMaxFunctionSize(maxFunctionSize);
+            obfuscator.setHotMethods(hotMethods);
+            obfuscator.process(jarFile.toPath(), Paths.get(outputDirectory),
                     libs, blackList, whiteList, libraryName, customLibraryDirectory, platform, useAnnotations, generateDebugJar,
                     enableVirtualization, enableJit, flattenControlFlow, enableJavaObfuscation, javaObfuscationStrength,
                     javaBlackList, javaWhiteList, enableNativeObfuscation);
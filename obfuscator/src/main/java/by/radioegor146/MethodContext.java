@@ -3,6 +3,8 @@ package by.radioegor146;
 import by.radioegor146.source.StringPool;
 import org.objectweb.asm.Type;
 import org.objectweb.asm.tree.ClassNode;
+import org.objectweb.asm.tree.LabelNode;
+import org.objectweb.asm.tree.MethodInsnNode;
 import org.objectweb.asm.tree.MethodNode;
 import org.objectweb.asm.tree.TryCatchBlockNode;
 
@@ -10,6 +12,7 @@ import java.util.ArrayList;
 import java.util.BitSet;
 import java.util.HashMap;
 import java.util.HashSet;
+import java.util.LinkedHashMap;
 import java.util.List;
 import java.util.Map;
 import java.util.Set;
@@ -57,6 +60,18 @@ public class MethodContext {
     // and skip generating/registering any native implementation for it.
     public boolean skipNative;
 
+    // Set when the method body runs in the micro VM instead of the state machine.
+    public boolean virtualized;
+
+    // Set when the state machine was emitted as a flattened dispatch loop.
+    public boolean flattened;
+
+    // Why the method was skipped or fell back from the requested mode, for the report.
+    public String fallbackReason;
+
+    // Number of part functions the state machine was split into, 0 if it was not split.
+    public int functionParts;
+
     // Protection configuration settings
     public ProtectionConfig protectionConfig;
 
@@ -101,6 +116,21 @@ public class MethodContext {
      */
     public int classCacheInsertPosition = -1;
 
+    /**
+     * Labels that are targets of a backward branch in the current method. The
+     * frame following such a label is where {@link by.radioegor146.instructions.FrameHandler}
+     * releases local references that are no longer held by any live slot, so a
+     * loop does not grow the JNI local reference table on every iteration.
+     */
+    public final Set<LabelNode> loopHeaders = new HashSet<>();
+
+    /**
+     * {@code INVOKESPECIAL <init>} instructions whose {@code NEW} was deferred
+     * by {@link by.radioegor146.instructions.TypeHandler}. They allocate and
+     * construct the object with a single {@code NewObjectA} call.
+     */
+    public final Set<MethodInsnNode> fusedConstructors = new HashSet<>();
+
     public MethodContext(NativeObfuscator obfuscator, MethodNode method, int methodIndex, ClassNode clazz,
                          int classIndex, ProtectionConfig protectionConfig) {
         this.obfuscator = obfuscator;
@@ -117,7 +147,7 @@ public class MethodContext {
         this.stack = new ArrayList<>();
         this.locals = new ArrayList<>();
         this.tryCatches = new HashSet<>();
-        this.catches = new HashMap<>();
+        this.catches = new LinkedHashMap<>();
     }
 
     public NodeCache<String> getCachedStrings() {
@@ -11,7 +11,7 @@ import org.objectweb.asm.tree.*;
 
 import java.lang.reflect.Field;
 import java.util.*;
-import java.util.concurrent.ThreadLocalRandom;
+import java.util.function.Function;
 import java.util.stream.Collectors;
 import java.util.regex.Matcher;
 import java.util.regex.Pattern;
@@ -30,6 +30,10 @@ public class MethodProcessor {
         }
     }
 
+    // JNI guarantees 16 local references per native frame without asking
+    private static final int DEFAULT_LOCAL_CAPACITY = 16;
+    private static final int MAX_LOCAL_CAPACITY = 65536;
+
     public static final String[] CPP_TYPES = {
             "void", // 0
             "jboolean", // 1
@@ -112,6 +116,10 @@ public class MethodProcessor {
         if (desc.endsWith(";")) {
             desc = desc.substring(1, desc.length() - 1);
         }
+        int hiddenIndex = context.obfuscator.getHiddenMethodsPool().getClassIndex(desc);
+        if (hiddenIndex >= 0) {
+            return "utils::define_hidden_class(env, " + hiddenIndex + ")";
+        }
         return "utils::find_class_wo_static(env, classloader, " + context.getCachedStrings().getPointer(desc.replace('/', '.')) + ")";
     }
 
@@ -124,6 +132,7 @@ public class MethodProcessor {
         // and lead to linkage errors if RegisterNatives is not invoked.
         if ((context.clazz.access & Opcodes.ACC_ENUM) != 0) {
             context.skipNative = true;
+            context.fallbackReason = "enum class";
             return;
         }
 
@@ -163,6 +172,10 @@ public class MethodProcessor {
                     obfuscator.getStringPool().get(method.desc), methodName));
         }
 
+        int functionStart = output.length();
+        if (obfuscator.isHotMethod(nameFromNode(method, context.clazz))) {
+            output.append("NATIVE_JVM_HOT ");
+        }
         output.append(String.format("%s JNICALL %s(JNIEnv *env, ", CPP_TYPES[context.ret.getSort()], methodName));
         if (context.proxyMethod != null) {
             output.append("jobject ignored_hidden, ");
@@ -194,8 +207,7 @@ public class MethodProcessor {
 
         // Only use VM translation if virtualization is enabled
         if (context.protectionConfig.isVirtualizationEnabled()) {
-            vmKeySeed = ThreadLocalRandom.current().nextLong();
-            output.append(String.format("    native_jvm::vm::init_key(%dLL);\n", vmKeySeed));
+            vmKeySeed = RandomSource.current().nextLong();
 
             boolean useJit = context.protectionConfig.isJitEnabled();
             vmTranslator = new VmTranslator(useJit);
@@ -204,6 +216,9 @@ public class MethodProcessor {
             // dispatch (default/interface semantics) across JVM versions.
             if ((context.clazz.access & Opcodes.ACC_INTERFACE) != 0) {
                 vmCode = null;
+                context.fallbackReason = "VM disabled for interface methods";
+            } else if (vmCode == null) {
+                context.fallbackReason = "VM translation unsupported";
             }
 
             if (vmCode != null) {
@@ -216,12 +231,18 @@ public class MethodProcessor {
                 // mismatches across JVMs. Arithmetic/stack-only methods still benefit.
                 if (!methodRefs.isEmpty()) {
                     vmCode = null;
+                    context.fallbackReason = String.format("VM fallback: %d method call(s)", methodRefs.size());
                 }
                 constantPool = vmTranslator.getConstantPool();
             }
         }
         if (vmCode != null && vmCode.length > 0) {
-            output.append(String.format("    native_jvm::vm::Instruction __ngen_vm_code[] = %s;\n",
+            context.virtualized = true;
+            // Built once by the first call: the program is encoded and the
+            // reference tables are decrypted a single time
+            int descriptorPosition = output.length();
+            StringBuilder setup = new StringBuilder();
+            setup.append(String.format("        static native_jvm::vm::Instruction __ngen_vm_code[] = %s;\n",
                     VmTranslator.serialize(vmCode)));
             output.append(String.format("    jlong __ngen_vm_locals[%d] = {0};\n", Math.max(1, method.maxLocals)));
             // Initialize VM locals with exact bit patterns for primitives and raw pointers for refs
@@ -265,177 +286,169 @@ public class MethodProcessor {
                 }
             }
             if (!fieldRefs.isEmpty()) {
-                output.append("    native_jvm::vm::FieldRef __ngen_vm_fields[] = {");
+                setup.append("        static const native_jvm::vm::FieldRef __ngen_vm_fields[] = {");
                 for (int i = 0; i < fieldRefs.size(); i++) {
                     VmTranslator.FieldRefInfo fr = fieldRefs.get(i);
-                    output.append(String.format("{ %s, %s, %s }",
+                    setup.append(String.format("{ %s, %s, %s }",
                             context.getStringPool().get(fr.owner),
                             context.getStringPool().get(fr.name),
                             context.getStringPool().get(fr.desc)));
                     if (i + 1 < fieldRefs.size()) {
-                        output.append(", ");
+                        setup.append(", ");
                     }
                 }
-                output.append(" };\n");
+                setup.append(" };\n");
             }
             if (!methodRefs.isEmpty()) {
-                output.append("    native_jvm::vm::MethodRef __ngen_vm_methods[] = {");
+                setup.append("        static const native_jvm::vm::MethodRef __ngen_vm_methods[] = {");
                 for (int i = 0; i < methodRefs.size(); i++) {
                     VmTranslator.MethodRefInfo mr = methodRefs.get(i);
-                    output.append(String.format("{ %s, %s, %s }",
+                    setup.append(String.format("{ %s, %s, %s }",
                             context.getStringPool().get(mr.owner),
                             context.getStringPool().get(mr.name),
                             context.getStringPool().get(mr.desc)));
                     if (i + 1 < methodRefs.size()) {
-                        output.append(", ");
+                        setup.append(", ");
                     }
                 }
-                output.append(" };\n");
+                setup.append(" };\n");
             }
             if (!classRefs.isEmpty()) {
-                output.append("    const char* __ngen_vm_classes[] = {");
+                setup.append("        static const char* const __ngen_vm_classes[] = {");
                 for (int i = 0; i < classRefs.size(); i++) {
-                    output.append(context.getStringPool().get(classRefs.get(i)));
-                    if (i + 1 < classRefs.size()) output.append(", ");
+                    setup.append(context.getStringPool().get(classRefs.get(i)));
+                    if (i + 1 < classRefs.size()) setup.append(", ");
                 }
-                output.append(" };\n");
+                setup.append(" };\n");
             }
             if (!multiArrayRefs.isEmpty()) {
-                output.append("    native_jvm::vm::MultiArrayInfo __ngen_vm_multi[] = {");
+                setup.append("        static const native_jvm::vm::MultiArrayInfo __ngen_vm_multi[] = {");
                 for (int i = 0; i < multiArrayRefs.size(); i++) {
                     VmTranslator.MultiArrayRefInfo mi = multiArrayRefs.get(i);
-                    output.append(String.format("{ %s, %d }",
+                    setup.append(String.format("{ %s, %d }",
                             context.getStringPool().get(mi.desc), mi.dims));
-                    if (i + 1 < multiArrayRefs.size()) output.append(", ");
+                    if (i + 1 < multiArrayRefs.size()) setup.append(", ");
                 }
-                output.append(" };\n");
+                setup.append(" };\n");
             }
             // Generate constant pool array
             if (!constantPool.isEmpty()) {
-                output.append("    native_jvm::vm::ConstantPoolEntry __ngen_vm_constants[").append(constantPool.size()).append("];\n");
+                setup.append("        static native_jvm::vm::ConstantPoolEntry __ngen_vm_constants[").append(constantPool.size()).append("];\n");
                 for (int i = 0; i < constantPool.size(); i++) {
                     VmTranslator.ConstantPoolEntry cp = constantPool.get(i);
-                    output.append(String.format("    __ngen_vm_constants[%d].type = native_jvm::vm::ConstantPoolEntry::", i));
+                    setup.append(String.format("        __ngen_vm_constants[%d].type = native_jvm::vm::ConstantPoolEntry::", i));
                     switch (cp.type) {
                         case INTEGER:
-                            output.append(String.format("TYPE_INTEGER;\n"));
-                            output.append(String.format("    __ngen_vm_constants[%d].i_value = %d;\n", i, (Integer)cp.value));
+                            setup.append(String.format("TYPE_INTEGER;\n"));
+                            setup.append(String.format("        __ngen_vm_constants[%d].i_value = %d;\n", i, (Integer)cp.value));
                             break;
                         case FLOAT:
-                            output.append(String.format("TYPE_FLOAT;\n"));
+                            setup.append(String.format("TYPE_FLOAT;\n"));
                             // Print with enough precision to round-trip single-precision values
-                            output.append(String.format(java.util.Locale.ROOT,
-                                    "    __ngen_vm_constants[%d].f_value = %.9gF;\n", i, (Float)cp.value));
+                            setup.append(String.format(java.util.Locale.ROOT,
+                                    "        __ngen_vm_constants[%d].f_value = %.9gF;\n", i, (Float)cp.value));
                             break;
                         case LONG:
-                            output.append(String.format("TYPE_LONG;\n"));
-                            output.append(String.format("    __ngen_vm_constants[%d].l_value = %dLL;\n", i, (Long)cp.value));
+                            setup.append(String.format("TYPE_LONG;\n"));
+                            setup.append(String.format("        __ngen_vm_constants[%d].l_value = %dLL;\n", i, (Long)cp.value));
                             break;
                         case DOUBLE:
-                            output.append(String.format("TYPE_DOUBLE;\n"));
+                            setup.append(String.format("TYPE_DOUBLE;\n"));
                             // Print with enough precision to round-trip double-precision values
-                            output.append(String.format(java.util.Locale.ROOT,
-                                    "    __ngen_vm_constants[%d].d_value = %.17g;\n", i, (Double)cp.value));
+                            setup.append(String.format(java.util.Locale.ROOT,
+                                    "        __ngen_vm_constants[%d].d_value = %.17g;\n", i, (Double)cp.value));
                             break;
                         case STRING:
-                            output.append(String.format("TYPE_STRING;\n"));
-                            output.append(String.format("    __ngen_vm_constants[%d].str_value = %s;\n", i,
+                            setup.append(String.format("TYPE_STRING;\n"));
+                            setup.append(String.format("        __ngen_vm_constants[%d].str_value = %s;\n", i,
                                     context.getStringPool().get((String)cp.value)));
                             break;
                         case CLASS:
-                            output.append(String.format("TYPE_CLASS;\n"));
-                            output.append(String.format("    __ngen_vm_constants[%d].class_name = %s;\n", i,
+                            setup.append(String.format("TYPE_CLASS;\n"));
+                            setup.append(String.format("        __ngen_vm_constants[%d].class_name = %s;\n", i,
                                     context.getStringPool().get((String)cp.value)));
                             break;
                         default:
                             // Unsupported types - should not reach here
-                            output.append(String.format("TYPE_INTEGER;\n"));
-                            output.append(String.format("    __ngen_vm_constants[%d].i_value = 0;\n", i));
+                            setup.append(String.format("TYPE_INTEGER;\n"));
+                            setup.append(String.format("        __ngen_vm_constants[%d].i_value = 0;\n", i));
                             break;
                     }
                 }
             }
             if (!fieldRefs.isEmpty() || !methodRefs.isEmpty() || !classRefs.isEmpty() || !multiArrayRefs.isEmpty()) {
-                output.append("    for (auto &ins : __ngen_vm_code) {\n");
-                output.append("        switch (ins.op) {\n");
+                setup.append("        for (auto &ins : __ngen_vm_code) {\n");
+                setup.append("            switch (ins.op) {\n");
                 if (!fieldRefs.isEmpty()) {
-                    output.append("            case native_jvm::vm::OP_GETSTATIC:\n");
-                    output.append("            case native_jvm::vm::OP_PUTSTATIC:\n");
-                    output.append("            case native_jvm::vm::OP_GETFIELD:\n");
-                    output.append("            case native_jvm::vm::OP_PUTFIELD:\n");
+                    setup.append("                case native_jvm::vm::OP_GETSTATIC:\n");
+                    setup.append("                case native_jvm::vm::OP_PUTSTATIC:\n");
+                    setup.append("                case native_jvm::vm::OP_GETFIELD:\n");
+                    setup.append("                case native_jvm::vm::OP_PUTFIELD:\n");
                     // Keep operand as index; native VM indexes into __ngen_vm_fields
                     // (do not convert to pointer here)
-                    output.append("                break;\n");
+                    setup.append("                    break;\n");
                 }
                 if (!methodRefs.isEmpty()) {
-                    output.append("            case native_jvm::vm::OP_INVOKESTATIC:\n");
-                    output.append("            case native_jvm::vm::OP_INVOKEVIRTUAL:\n");
-                    output.append("            case native_jvm::vm::OP_INVOKESPECIAL:\n");
-                    output.append("            case native_jvm::vm::OP_INVOKEINTERFACE:\n");
+                    setup.append("                case native_jvm::vm::OP_INVOKESTATIC:\n");
+                    setup.append("                case native_jvm::vm::OP_INVOKEVIRTUAL:\n");
+                    setup.append("                case native_jvm::vm::OP_INVOKESPECIAL:\n");
+                    setup.append("                case native_jvm::vm::OP_INVOKEINTERFACE:\n");
                     // Keep operand as index; native VM indexes into __ngen_vm_methods
                     // (do not convert to pointer here)
-                    output.append("                break;\n");
+                    setup.append("                    break;\n");
                 }
                 if (!classRefs.isEmpty()) {
-                    output.append("            case native_jvm::vm::OP_NEW:\n");
-                    output.append("            case native_jvm::vm::OP_ANEWARRAY:\n");
-                    output.append("            case native_jvm::vm::OP_CHECKCAST:\n");
-                    output.append("            case native_jvm::vm::OP_INSTANCEOF:\n");
+                    setup.append("                case native_jvm::vm::OP_NEW:\n");
+                    setup.append("                case native_jvm::vm::OP_ANEWARRAY:\n");
+                    setup.append("                case native_jvm::vm::OP_CHECKCAST:\n");
+                    setup.append("                case native_jvm::vm::OP_INSTANCEOF:\n");
                     // Convert index -> actual const char* pointer value
                     // Native VM expects ins.operand to be a C string pointer
-                    output.append("                ins.operand = reinterpret_cast<jlong>(__ngen_vm_classes[ins.operand]);\n");
-                    output.append("                break;\n");
+                    setup.append("                    ins.operand = reinterpret_cast<jlong>(__ngen_vm_classes[ins.operand]);\n");
+                    setup.append("                    break;\n");
                 }
                 if (!multiArrayRefs.isEmpty()) {
-                    output.append("            case native_jvm::vm::OP_MULTIANEWARRAY:\n");
+                    setup.append("                case native_jvm::vm::OP_MULTIANEWARRAY:\n");
                     // Keep operand as index; native VM indexes into __ngen_vm_multi
                     // (do not convert to pointer here)
-                    output.append("                break;\n");
+                    setup.append("                    break;\n");
                 }
-                output.append("        }\n");
-                output.append("    }\n");
+                setup.append("            }\n");
+                setup.append("        }\n");
+            }
+            List<VmTranslator.ExceptionTableEntry> exceptionTable = vmTranslator.getExceptionTable();
+            if (!exceptionTable.isEmpty()) {
+                setup.append("        static const native_jvm::vm::ExceptionEntry __ngen_vm_exceptions[] = {");
+                for (int i = 0; i < exceptionTable.size(); i++) {
+                    VmTranslator.ExceptionTableEntry entry = exceptionTable.get(i);
+                    setup.append(String.format("{ %d, %d, %d, %s }", entry.startPc, entry.endPc, entry.handlerPc,
+                            entry.catchType == null ? "nullptr" : context.getStringPool().get(entry.catchType)));
+                    if (i + 1 < exceptionTable.size()) setup.append(", ");
+                }
+                setup.append(" };\n");
             }
-            output.append(String.format(
-                    "    native_jvm::vm::encode_program(__ngen_vm_code, %d, %dLL);\n",
-                    vmCode.length, vmKeySeed));
-            // Determine constant pool parameters
             String constantPoolPtr = constantPool.isEmpty() ? "nullptr" : "__ngen_vm_constants";
-            int constantPoolSize = constantPool.size();
-
-            // Determine method references parameters
             String methodRefsPtr = methodRefs.isEmpty() ? "nullptr" : "__ngen_vm_methods";
-            int methodRefsSize = methodRefs.size();
-
-            // Determine field references parameters
             String fieldRefsPtr = fieldRefs.isEmpty() ? "nullptr" : "__ngen_vm_fields";
-            int fieldRefsSize = fieldRefs.size();
-
-            // Determine multi-array references parameters
             String multiRefsPtr = multiArrayRefs.isEmpty() ? "nullptr" : "__ngen_vm_multi";
-            int multiRefsSize = multiArrayRefs.size();
-
-            // Determine class references parameters (for switches, not implemented yet)
-            String tableRefsPtr = "nullptr";
-            int tableRefsSize = 0;
-            String lookupRefsPtr = "nullptr";
-            int lookupRefsSize = 0;
+            String exceptionTablePtr = exceptionTable.isEmpty() ? "nullptr" : "__ngen_vm_exceptions";
+            boolean useJit = vmTranslator != null && vmTranslator.isUseJit();
+            setup.append(String.format(
+                    "        static native_jvm::vm::MethodDescriptor __ngen_vm_descriptor = { __ngen_vm_code, %d, %d, static_cast<uint64_t>(%dLL), %s, %d, %s, %d, %s, %d, %s, %d, %s, %d, %s, nullptr };\n",
+                    vmCode.length, method.maxLocals, vmKeySeed, constantPoolPtr, constantPool.size(),
+                    methodRefsPtr, methodRefs.size(), fieldRefsPtr, fieldRefs.size(), multiRefsPtr,
+                    multiArrayRefs.size(), exceptionTablePtr, exceptionTable.size(), useJit));
+            setup.append("        native_jvm::vm::prepare_method(__ngen_vm_descriptor, __ngen_vm_code);\n");
+            setup.append("        return &__ngen_vm_descriptor;\n");
+            output.insert(descriptorPosition, "    static const native_jvm::vm::MethodDescriptor *__ngen_vm_method = []() {\n"
+                    + setup + "    }();\n");
 
             // Execute micro VM and correctly convert the encoded top-of-stack value
             // back to the Java return type. The VM encodes values on a 64-bit stack:
             // - int/float use low 32 bits (float is raw IEEE754 bits)
             // - long/double use all 64 bits (double is raw IEEE754 bits)
             // - object/array are stored as their pointer cast to int64
-            String vmCallFmt;
-            if (vmTranslator != null && vmTranslator.isUseJit()) {
-                vmCallFmt = String.format(
-                        "    auto __ngen_vm_ret = native_jvm::vm::execute_jit(env, __ngen_vm_code, %d, __ngen_vm_locals, %d, %dLL, %s, %d, %s, %d, %s, %d, %s, %d, %s, %d, %s, %d);\n",
-                        vmCode.length, method.maxLocals, vmKeySeed, constantPoolPtr, constantPoolSize, methodRefsPtr, methodRefsSize, fieldRefsPtr, fieldRefsSize, multiRefsPtr, multiRefsSize, tableRefsPtr, tableRefsSize, lookupRefsPtr, lookupRefsSize);
-            } else {
-                vmCallFmt = String.format(
-                        "    auto __ngen_vm_ret = native_jvm::vm::execute(env, __ngen_vm_code, %d, __ngen_vm_locals, %d, %dLL, %s, %d, %s, %d, %s, %d, %s, %d, %s, %d, %s, %d);\n",
-                        vmCode.length, method.maxLocals, vmKeySeed, constantPoolPtr, constantPoolSize, methodRefsPtr, methodRefsSize, fieldRefsPtr, fieldRefsSize, multiRefsPtr, multiRefsSize, tableRefsPtr, tableRefsSize, lookupRefsPtr, lookupRefsSize);
-            }
-            output.append(vmCallFmt);
+            output.append("    auto __ngen_vm_ret = native_jvm::vm::execute(env, *__ngen_vm_method, __ngen_vm_locals);\n");
             switch (context.ret.getSort()) {
                 case Type.DOUBLE: {
                     output.append("    jdouble __ngen_vm_ret_d; std::memcpy(&__ngen_vm_ret_d, &__ngen_vm_ret, sizeof(jdouble)); return __ngen_vm_ret_d;\n");
@@ -523,8 +536,6 @@ public class MethodProcessor {
             output.append("    if (env->ExceptionCheck()) { ").append(String.format("return (%s) 0;",
                     CPP_TYPES[context.ret.getSort()])).append(" }\n");
         }
-        output.append("    jobject lookup = nullptr;\n");
-
         if (method.tryCatchBlocks != null) {
             for (TryCatchBlockNode tryCatch : method.tryCatchBlocks) {
                 context.getLabelPool().getName(tryCatch.start.getLabel());
@@ -552,6 +563,9 @@ public class MethodProcessor {
             });
         }
 
+        // Variables shared by all states; moved into a frame struct if the method gets split
+        int frameDeclarationStart = output.length();
+        output.append("    jobject lookup = nullptr;\n");
         if (method.maxStack > 0) {
             output.append("    jvalue ");
             for (int i = 0; i < method.maxStack; i++) {
@@ -575,7 +589,18 @@ public class MethodProcessor {
         }
 
         output.append("    std::unordered_set<jobject> refs;\n");
+        int frameDeclarationEnd = output.length();
+        int localRefEstimate = estimateLocalRefs(method);
+        if (localRefEstimate > DEFAULT_LOCAL_CAPACITY) {
+            output.append(String.format("    env->EnsureLocalCapacity(%d); if (env->ExceptionCheck()) { return (%s) 0; }\n",
+                    Math.min(localRefEstimate, MAX_LOCAL_CAPACITY), CPP_TYPES[context.ret.getSort()]));
+        }
+        output.append("#ifdef NATIVE_JVM_REF_METRICS\n");
+        output.append(String.format("    utils::ref_metrics_scope __ngen_ref_metrics(\"%s\", refs);\n",
+                nameFromNode(method, context.clazz).replaceAll("[^\\x20-\\x7e]|[\"\\\\]", "?")));
+        output.append("#endif\n");
         output.append("\n");
+        context.loopHeaders.addAll(findLoopHeaders(method));
         context.classCacheInsertPosition = output.length();
 
         int localIndex = 0;
@@ -625,8 +650,10 @@ public class MethodProcessor {
             stateObfuscation = ControlFlowFlattener.createObfuscation(method.name);
         }
         context.stateObfuscation = stateObfuscation;
+        context.flattened = flattenControlFlow;
 
         LinkedHashMap<Integer, StringBuilder> stateBlocks = new LinkedHashMap<>();
+        Set<LabelNode> referencedLabels = ConstantArrayFill.getReferencedLabels(method);
 
         for (int instruction = 0; instruction < instructionCount; ++instruction) {
             AbstractInsnNode node = method.instructions.get(instruction);
@@ -650,6 +677,20 @@ public class MethodProcessor {
             block.append("        // New stack: ").append(newStackPointer).append("\n");
             context.stackPointer = newStackPointer;
 
+            if (node.getOpcode() == Opcodes.NEWARRAY) {
+                ConstantArrayFill fill = ConstantArrayFill.match(method.instructions, instruction, referencedLabels);
+                if (fill != null) {
+                    // The element stores are skipped, their states stay unused
+                    block.append("        // Constant fill of ").append(fill.getCount()).append(" elements\n");
+                    block.append("        ").append(fill.toCpp(String.format("cstack%d.l", context.stackPointer - 1),
+                            RandomSource.current().nextLong())).append("\n");
+                    if (fill.line >= 0) {
+                        context.line = fill.line;
+                    }
+                    instruction = fill.end;
+                }
+            }
+
             boolean changesFlow = node instanceof JumpInsnNode || node instanceof LookupSwitchInsnNode
                     || node instanceof TableSwitchInsnNode;
             int opcode = node.getOpcode();
@@ -712,27 +753,53 @@ public class MethodProcessor {
             }
         }
 
-        if (context.classCacheDeclarations.length() > 0 && context.classCacheInsertPosition >= 0) {
-            output.insert(context.classCacheInsertPosition, context.classCacheDeclarations.toString());
-            context.classCacheDeclarations.setLength(0);
-            context.classCacheInsertPosition = -1;
+        String defaultBlock = String.format("            return (%s) 0;\n", CPP_TYPES[context.ret.getSort()]);
+        int maxFunctionSize = obfuscator.getMaxFunctionSize();
+        List<List<Integer>> parts = Collections.emptyList();
+        if (maxFunctionSize > 0) {
+            Set<Integer> leaders = new HashSet<>(stateBlocks.keySet());
+            for (int i = 0; i < instructionCount; i++) {
+                if (!(method.instructions.get(i) instanceof LabelNode)) {
+                    leaders.remove(states[i]);
+                }
+            }
+            parts = FunctionSplitter.partition(stateBlocks, leaders, maxFunctionSize);
         }
 
-        String defaultBlock = String.format("            return (%s) 0;\n", CPP_TYPES[context.ret.getSort()]);
-        if (flattenControlFlow) {
-            String stateMachine = ControlFlowFlattener.generateStateMachine(
-                    method.name,
-                    CPP_TYPES[context.ret.getSort()],
-                    states[0],
-                    stateBlocks,
-                    defaultBlock,
-                    stateObfuscation
-            );
-            output.append(stateMachine);
+        if (parts.size() > 1) {
+            FunctionSplitter.Frame frame = new FunctionSplitter.Frame(methodName, CPP_TYPES[context.ret.getSort()],
+                    method.maxStack, method.maxLocals, context.verifiedClasses.keySet());
+            FunctionSplitter.Result split = FunctionSplitter.split(frame, stateBlocks, parts, states[0],
+                    defaultBlock, stateObfuscation);
+            context.classCacheDeclarations.setLength(0);
+            context.classCacheInsertPosition = -1;
+            context.functionParts = parts.size();
+            output.append(split.dispatcher);
+            output.append("}\n");
+            output.replace(frameDeclarationStart, frameDeclarationEnd, split.frameBinding);
+            output.insert(functionStart, split.declarations);
         } else {
-            output.append(buildLinearControlFlow(stateBlocks, defaultBlock));
+            if (context.classCacheDeclarations.length() > 0 && context.classCacheInsertPosition >= 0) {
+                output.insert(context.classCacheInsertPosition, context.classCacheDeclarations.toString());
+                context.classCacheDeclarations.setLength(0);
+                context.classCacheInsertPosition = -1;
+            }
+
+            if (flattenControlFlow) {
+                String stateMachine = ControlFlowFlattener.generateStateMachine(
+                        method.name,
+                        CPP_TYPES[context.ret.getSort()],
+                        states[0],
+                        stateBlocks,
+                        defaultBlock,
+                        stateObfuscation
+                );
+                output.append(stateMachine);
+            } else {
+                output.append(buildLinearControlFlow(stateBlocks, defaultBlock));
+            }
+            output.append("}\n");
         }
-        output.append("}\n");
 
         context.stateObfuscation = null;
 
@@ -742,6 +809,79 @@ public class MethodProcessor {
         specialMethodProcessor.postProcess(context);
     }
 
+    /**
+     * Collects labels that are reached by a backward jump or switch branch,
+     * i.e. loop headers in the straight-line instruction order.
+     */
+    static Set<LabelNode> findLoopHeaders(MethodNode method) {
+        Set<LabelNode> headers = new HashSet<>();
+        InsnList instructions = method.instructions;
+        for (AbstractInsnNode insn : instructions) {
+            List<LabelNode> targets = new ArrayList<>();
+            if (insn instanceof JumpInsnNode) {
+                targets.add(((JumpInsnNode) insn).label);
+            } else if (insn instanceof TableSwitchInsnNode) {
+                targets.add(((TableSwitchInsnNode) insn).dflt);
+                targets.addAll(((TableSwitchInsnNode) insn).labels);
+            } else if (insn instanceof LookupSwitchInsnNode) {
+                targets.add(((LookupSwitchInsnNode) insn).dflt);
+                targets.addAll(((LookupSwitchInsnNode) insn).labels);
+            }
+            int index = instructions.indexOf(insn);
+            for (LabelNode target : targets) {
+                if (instructions.indexOf(target) <= index) {
+                    headers.add(target);
+                }
+            }
+        }
+        return headers;
+    }
+
+    /**
+     * Upper bound on JNI local references alive at once in the generated body.
+     * Loop headers release dead references, so every reference producing
+     * instruction contributes at most one; the prologue adds clazz, classloader,
+     * lookup and the arguments, and every try-catch handler one exception.
+     */
+    static int estimateLocalRefs(MethodNode method) {
+        int count = 3 + Type.getArgumentTypes(method.desc).length + 1;
+        if (method.tryCatchBlocks != null) {
+            count += method.tryCatchBlocks.size();
+        }
+        for (AbstractInsnNode insn : method.instructions) {
+            switch (insn.getOpcode()) {
+                case Opcodes.NEW:
+                case Opcodes.ANEWARRAY:
+                case Opcodes.NEWARRAY:
+                case Opcodes.MULTIANEWARRAY:
+                case Opcodes.AALOAD:
+                case Opcodes.INVOKEDYNAMIC:
+                    count++;
+                    break;
+                case Opcodes.GETFIELD:
+                case Opcodes.GETSTATIC: {
+                    int sort = Type.getType(((FieldInsnNode) insn).desc).getSort();
+                    if (sort == Type.OBJECT || sort == Type.ARRAY) {
+                        count++;
+                    }
+                    break;
+                }
+                case Opcodes.INVOKEVIRTUAL:
+                case Opcodes.INVOKESPECIAL:
+                case Opcodes.INVOKESTATIC:
+                case Opcodes.INVOKEINTERFACE: {
+                    int sort = Type.getReturnType(((MethodInsnNode) insn).desc).getSort();
+                    // Receiver-less calls also resolve their owner class into a local
+                    count += (sort == Type.OBJECT || sort == Type.ARRAY) ? 2 : 1;
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+        return count;
+    }
+
     public static String nameFromNode(MethodNode m, ClassNode cn) {
         return cn.name + '#' + m.name + '!' + m.desc;
     }
@@ -847,6 +987,14 @@ public class MethodProcessor {
     }
 
     private static String linearizeStateAssignments(String code) {
+        return linearizeStateAssignments(code, rawState -> "goto " + getLinearLabelName(rawState) + ";");
+    }
+
+    /**
+     * Replaces every {@code __ngen_state = N; break;} transition with the
+     * statement produced by {@code transition} for the raw state {@code N}.
+     */
+    static String linearizeStateAssignments(String code, Function<String, String> transition) {
         if (code == null || code.isEmpty()) {
             return "";
         }
@@ -854,7 +1002,7 @@ public class MethodProcessor {
         StringBuffer sb = new StringBuffer();
         while (matcher.find()) {
             String rawState = matcher.group(1);
-            matcher.appendReplacement(sb, Matcher.quoteReplacement("goto " + getLinearLabelName(rawState) + ";"));
+            matcher.appendReplacement(sb, Matcher.quoteReplacement(transition.apply(rawState)));
         }
         matcher.appendTail(sb);
         return STANDALONE_BREAK_PATTERN.matcher(sb.toString()).replaceAll("");
@@ -864,7 +1012,7 @@ public class MethodProcessor {
         return getLinearLabelName(Integer.toString(state));
     }
 
-    private static String getLinearLabelName(String rawState) {
+    static String getLinearLabelName(String rawState) {
         if (rawState == null || rawState.isEmpty()) {
             return "__ngen_label_0";
         }
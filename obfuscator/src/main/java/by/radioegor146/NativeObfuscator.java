@@ -1,6 +1,8 @@
 package by.radioegor146;
 
+import by.radioegor146.bytecode.EnumSwitchMaps;
 import by.radioegor146.bytecode.PreprocessorRunner;
+import by.radioegor146.bytecode.PreprocessorUtils;
 import by.radioegor146.javaobf.JavaObfuscationConfig;
 import by.radioegor146.javaobf.JavaObfuscator;
 import by.radioegor146.source.CMakeFilesBuilder;
@@ -28,6 +30,7 @@ import java.nio.file.Path;
 import java.util.ArrayList;
 import java.util.Arrays;
 import java.util.List;
+import java.util.Map;
 import java.util.Objects;
 import java.util.jar.JarFile;
 import java.util.jar.Manifest;
@@ -84,6 +87,10 @@ public class NativeObfuscator {
 
     private int currentClassId;
     private String nativeDir;
+    private Long seed;
+    private int maxFunctionSize = FunctionSplitter.DEFAULT_MAX_FUNCTION_SIZE;
+    private ClassMethodList hotMethods;
+    private ObfuscationReport report = new ObfuscationReport();
 
     public NativeObfuscator() {
         stringPool = new StringPool();
@@ -95,6 +102,42 @@ public class NativeObfuscator {
         methodProcessor = new MethodProcessor(this);
     }
 
+    /**
+     * Makes the generated sources and jars reproducible. Each class draws its
+     * randomness from a seed derived from this value and the class bytes, and
+     * string pool keys are derived from the string contents. {@code null}
+     * restores fully random output.
+     */
+    public void setSeed(Long seed) {
+        this.seed = seed;
+    }
+
+    /**
+     * Limits the generated C++ size of a single function. Larger state
+     * machines are split into several functions sharing a frame struct;
+     * {@code 0} disables splitting.
+     */
+    public void setMaxFunctionSize(int maxFunctionSize) {
+        this.maxFunctionSize = maxFunctionSize;
+    }
+
+    public int getMaxFunctionSize() {
+        return maxFunctionSize;
+    }
+
+    /**
+     * Marks the native functions of the listed classes/methods, in white list
+     * format, as hot, so the compiler places them together with the hot
+     * runtime helpers. {@code null} leaves every function unmarked.
+     */
+    public void setHotMethods(List<String> hotMethods) {
+        this.hotMethods = ClassMethodList.parse(hotMethods);
+    }
+
+    public boolean isHotMethod(String name) {
+        return hotMethods != null && hotMethods.contains(name);
+    }
+
     public void process(Path inputJarPath, Path outputDir, List<Path> inputLibs,
                         List<String> blackList, List<String> whiteList, String plainLibName,
                         String customLibraryDirectory,
@@ -114,43 +157,40 @@ public class NativeObfuscator {
                         boolean enableJavaObfuscation, String javaObfuscationStrength,
                         List<String> javaBlackList, List<String> javaWhiteList, boolean enableNativeObfuscation) throws IOException {
         ProtectionConfig protectionConfig = new ProtectionConfig(enableVirtualization, enableJit, flattenControlFlow);
+        RandomSource.reset();
+        stringPool.setSeed(seed);
+        PreprocessorUtils.setSeed(seed);
+        report = new ObfuscationReport();
         if (Files.exists(outputDir) && Files.isSameFile(inputJarPath.toRealPath().getParent(), outputDir.toRealPath())) {
             throw new RuntimeException("Input jar can't be in the same directory as output directory");
         }
 
-        // Step 1: Apply Java obfuscation if enabled
-        Path processedJarPath = inputJarPath;
-        if (enableJavaObfuscation) {
-            logger.info("Starting Java-layer obfuscation...");
-            JavaObfuscationConfig.Strength strength;
-            try {
-                strength = JavaObfuscationConfig.Strength.valueOf(javaObfuscationStrength.toUpperCase());
-            } catch (IllegalArgumentException e) {
-                logger.warn("Invalid Java obfuscation strength '{}', using MEDIUM", javaObfuscationStrength);
-                strength = JavaObfuscationConfig.Strength.MEDIUM;
-            }
-
-            JavaObfuscationConfig javaConfig = new JavaObfuscationConfig(true, strength, javaBlackList, javaWhiteList);
-            JavaObfuscator javaObfuscator = new JavaObfuscator();
+        JavaObfuscationConfig javaConfig = enableJavaObfuscation
+                ? createJavaConfig(javaObfuscationStrength, javaBlackList, javaWhiteList) : null;
 
-            Path javaObfOutputDir = outputDir.resolve("java-obf-temp");
-            processedJarPath = javaObfuscator.process(inputJarPath, javaObfOutputDir, inputLibs, javaConfig, useAnnotations);
-            logger.info("Java-layer obfuscation completed. Output: {}", processedJarPath);
-        }
-
-        // Step 2: Check if native obfuscation is disabled
         if (!enableNativeObfuscation) {
-            logger.info("Native obfuscation disabled. Copying final JAR to output directory...");
-            Path finalOutputJar = outputDir.resolve(processedJarPath.getFileName().toString());
-            Files.createDirectories(outputDir);
-            Files.deleteIfExists(finalOutputJar);
-            Files.copy(processedJarPath, finalOutputJar);
+            Path finalOutputJar = outputDir.resolve(inputJarPath.getFileName().toString());
+            if (javaConfig != null) {
+                logger.info("Native obfuscation disabled. Running Java-layer obfuscation only...");
+                JavaObfuscator javaObfuscator = new JavaObfuscator();
+                javaObfuscator.setSeed(seed);
+                javaObfuscator.process(inputJarPath, outputDir, inputLibs, javaConfig, useAnnotations);
+            } else {
+                logger.info("Native obfuscation disabled. Copying JAR to output directory...");
+                Files.createDirectories(outputDir);
+                Files.deleteIfExists(finalOutputJar);
+                Files.copy(inputJarPath, finalOutputJar);
+            }
             logger.info("Processing completed. Output: {}", finalOutputJar);
             return;
         }
 
+        // Java-layer obfuscation runs on each ClassNode right after it is parsed below, so the
+        // input jar is read and parsed once and no intermediate jar is written.
+        ClassMethodFilter javaFilter = javaConfig != null ? JavaObfuscator.createFilter(javaConfig, useAnnotations) : null;
+
         List<Path> libs = new ArrayList<>(inputLibs);
-        libs.add(processedJarPath);
+        libs.add(inputJarPath);
         ClassMethodFilter classMethodFilter = new ClassMethodFilter(ClassMethodList.parse(blackList), ClassMethodList.parse(whiteList), useAnnotations);
         ClassMetadataReader metadataReader = new ClassMetadataReader(libs.stream().map(x -> {
             try {
@@ -193,11 +233,10 @@ public class NativeObfuscator {
 
         MainSourceBuilder mainSourceBuilder = new MainSourceBuilder();
 
-        File jarFile = processedJarPath.toAbsolutePath().toFile();
+        File jarFile = inputJarPath.toAbsolutePath().toFile();
         try (JarFile jar = new JarFile(jarFile);
-             ZipOutputStream out = new ZipOutputStream(Files.newOutputStream(outputDir.resolve(jarFile.getName())));
-             ZipOutputStream debug = generateDebugJar ? new ZipOutputStream(
-                     Files.newOutputStream(outputDir.resolve("debug.jar"))) : null) {
+             ZipOutputStream out = newZipOutputStream(outputDir.resolve(jarFile.getName()));
+             ZipOutputStream debug = generateDebugJar ? newZipOutputStream(outputDir.resolve("debug.jar")) : null) {
 
             logger.info("Processing {}...", jarFile);
 
@@ -217,6 +256,19 @@ public class NativeObfuscator {
             }
 
             hiddenMethodsPool = new HiddenMethodsPool(nativeDir + "/hidden");
+            PreprocessorRunner.setEnumSwitchMaps(new EnumSwitchMaps(name -> {
+                ZipEntry classEntry = jar.getEntry(name + ".class");
+                if (classEntry == null) {
+                    return null;
+                }
+                ByteArrayOutputStream baos = new ByteArrayOutputStream();
+                try (InputStream in = jar.getInputStream(classEntry)) {
+                    Util.transfer(in, baos);
+                } catch (IOException ex) {
+                    return null;
+                }
+                return baos.toByteArray();
+            }));
 
             Integer[] classIndexReference = new Integer[]{0};
 
@@ -246,6 +298,10 @@ public class NativeObfuscator {
                         return;
                     }
 
+                    if (seed != null) {
+                        RandomSource.reseed(RandomSource.deriveSeed(seed, src));
+                    }
+
                     StringBuilder nativeMethods = new StringBuilder();
                     List<HiddenCppMethod> hiddenMethods = new ArrayList<>();
 
@@ -253,13 +309,19 @@ public class NativeObfuscator {
                     ClassNode rawClassNode = new ClassNode(Opcodes.ASM7);
                     classReader.accept(rawClassNode, 0);
 
+                    boolean javaObfuscated = javaConfig != null
+                            && JavaObfuscator.obfuscate(rawClassNode, javaFilter, javaConfig);
+
                     if (!classMethodFilter.shouldProcess(rawClassNode) ||
                             rawClassNode.methods.stream().noneMatch(method -> MethodProcessor.shouldProcess(method) &&
                                     classMethodFilter.shouldProcess(rawClassNode, method))) {
                         logger.info("Skipping {}", rawClassNode.name);
-                        if (useAnnotations) {
-                            ClassMethodFilter.cleanAnnotations(rawClassNode);
-                            ClassWriter clearedClassWriter = new SafeClassWriter(metadataReader, Opcodes.ASM7);
+                        if (useAnnotations || javaObfuscated) {
+                            if (useAnnotations) {
+                                ClassMethodFilter.cleanAnnotations(rawClassNode);
+                            }
+                            ClassWriter clearedClassWriter = new SafeClassWriter(metadataReader, javaObfuscated
+                                    ? Opcodes.ASM7 | ClassWriter.COMPUTE_MAXS | ClassWriter.COMPUTE_FRAMES : Opcodes.ASM7);
                             rawClassNode.accept(clearedClassWriter);
                             Util.writeEntry(out, entry.getName(), clearedClassWriter.toByteArray());
                             if (debug != null) {
@@ -310,15 +372,25 @@ public class NativeObfuscator {
                             MethodNode method = classNode.methods.get(i);
 
                             if (!MethodProcessor.shouldProcess(method)) {
+                                if (method.instructions.size() > 0) {
+                                    ObfuscationReport.MethodEntry reportEntry = new ObfuscationReport.MethodEntry(classNode.name, method);
+                                    reportEntry.skip("constructor or lambda body");
+                                    report.add(reportEntry);
+                                }
                                 continue;
                             }
 
+                            ObfuscationReport.MethodEntry reportEntry = new ObfuscationReport.MethodEntry(classNode.name, method);
+                            report.add(reportEntry);
+
                             if (!classMethodFilter.shouldProcess(classNode, method)) {
+                                reportEntry.skip("excluded by filter");
                                 continue;
                             }
 
                             MethodContext context = new MethodContext(this, method, i, classNode, currentClassId, protectionConfig);
                             methodProcessor.processMethod(context);
+                            reportEntry.complete(context);
                             instructions.append(context.output.toString().replace("\n", "\n    "));
 
                             nativeMethods.append(context.nativeMethods);
@@ -353,47 +425,58 @@ public class NativeObfuscator {
                         mainSourceBuilder.registerClassMethods(currentClassId, cppBuilder.getFilename());
                     }
 
+                    report.addClass();
                     currentClassId++;
                 } catch (IOException ex) {
                     logger.error("Error while processing {}", entry.getName(), ex);
                 }
             });
 
+            RandomSource.reset();
+
             if (platform == Platform.ANDROID) {
-                for (ClassNode hiddenClass : hiddenMethodsPool.getClasses()) {
+                for (ClassNode hiddenClass : hiddenMethodsPool.getClasses().values()) {
                     ClassWriter classWriter = new SafeClassWriter(metadataReader, Opcodes.ASM7 | ClassWriter.COMPUTE_MAXS | ClassWriter.COMPUTE_FRAMES);
                     hiddenClass.accept(classWriter);
                     Util.writeEntry(out, hiddenClass.name + ".class", classWriter.toByteArray());
                 }
             } else {
-                for (ClassNode hiddenClass : hiddenMethodsPool.getClasses()) {
+                for (Map.Entry<Integer, ClassNode> hiddenEntry : hiddenMethodsPool.getClasses().entrySet()) {
+                    ClassNode hiddenClass = hiddenEntry.getValue();
                     String hiddenClassFileName = "data_" + Util.escapeCppNameString(hiddenClass.name.replace('/', '_'));
 
                     cMakeBuilder.addClassFile("output/" + hiddenClassFileName + ".hpp");
                     cMakeBuilder.addClassFile("output/" + hiddenClassFileName + ".cpp");
 
                     mainSourceBuilder.addHeader(hiddenClassFileName + ".hpp");
-                    mainSourceBuilder.registerDefine(stringPool.get(hiddenClass.name), hiddenClassFileName);
+                    mainSourceBuilder.registerHiddenClass(hiddenEntry.getKey(), hiddenClassFileName);
 
                     ClassWriter classWriter = new SafeClassWriter(metadataReader, Opcodes.ASM7 | ClassWriter.COMPUTE_MAXS | ClassWriter.COMPUTE_FRAMES);
                     hiddenClass.accept(classWriter);
                     byte[] rawData = classWriter.toByteArray();
-                    List<Byte> data = new ArrayList<>(rawData.length);
-                    for (byte b : rawData) {
-                        data.add(b);
-                    }
 
                     if (debug != null) {
                         Util.writeEntry(debug, hiddenClass.name + ".class", rawData);
                     }
 
+                    // Masked with the keystream of utils::define_hidden_class, unmasked only when first used
+                    long key = seed != null ? RandomSource.deriveSeed(seed, rawData) : RandomSource.current().nextLong();
+                    StringBuilder data = new StringBuilder();
+                    long state = key;
+                    for (int i = 0; i < rawData.length; i++) {
+                        state = state * 6364136223846793005L + 1442695040888963407L;
+                        if (i > 0) {
+                            data.append(", ");
+                        }
+                        data.append((rawData[i] ^ (state ^ (state >>> 29))) & 0xFF);
+                    }
+
                     try (BufferedWriter hppWriter = Files.newBufferedWriter(cppOutput.resolve(hiddenClassFileName + ".hpp"))) {
                         hppWriter.append("#include \"../native_jvm.hpp\"\n\n");
                         hppWriter.append("#ifndef ").append(hiddenClassFileName.toUpperCase()).append("_HPP_GUARD\n\n");
                         hppWriter.append("#define ").append(hiddenClassFileName.toUpperCase()).append("_HPP_GUARD\n\n");
                         hppWriter.append("namespace native_jvm::data::__ngen_").append(hiddenClassFileName).append(" {\n");
-                        hppWriter.append("    const jbyte* get_class_data();\n");
-                        hppWriter.append("    const jsize get_class_data_length();\n");
+                        hppWriter.append("    const utils::hidden_class_data &get_class_data();\n");
                         hppWriter.append("}\n\n");
                         hppWriter.append("#endif\n");
                     }
@@ -401,12 +484,12 @@ public class NativeObfuscator {
                     try (BufferedWriter cppWriter = Files.newBufferedWriter(cppOutput.resolve(hiddenClassFileName + ".cpp"))) {
                         cppWriter.append("#include \"").append(hiddenClassFileName).append(".hpp\"\n\n");
                         cppWriter.append("namespace native_jvm::data::__ngen_").append(hiddenClassFileName).append(" {\n");
-                        cppWriter.append("    static const jbyte class_data[").append(String.valueOf(data.size())).append("] = { ");
-                        cppWriter.append(data.stream().map(String::valueOf).collect(Collectors.joining(", ")));
-                        cppWriter.append("};\n");
-                        cppWriter.append("    static const jsize class_data_length = ").append(String.valueOf(data.size())).append(";\n\n");
-                        cppWriter.append("    const jbyte* get_class_data() { return class_data; }\n");
-                        cppWriter.append("    const jsize get_class_data_length() { return class_data_length; }\n");
+                        cppWriter.append("    static const unsigned char class_data[").append(String.valueOf(rawData.length)).append("] = { ");
+                        cppWriter.append(data);
+                        cppWriter.append(" };\n");
+                        cppWriter.append(String.format("    static const utils::hidden_class_data hidden_class = { class_data, %d, %sULL };\n\n",
+                                rawData.length, Long.toUnsignedString(key)));
+                        cppWriter.append("    const utils::hidden_class_data &get_class_data() { return hidden_class; }\n");
                         cppWriter.append("}\n");
                     }
                 }
@@ -469,6 +552,33 @@ public class NativeObfuscator {
                 .getBytes(StandardCharsets.UTF_8));
 
         Files.write(cppDir.resolve("CMakeLists.txt"), cMakeBuilder.build().getBytes(StandardCharsets.UTF_8));
+
+        report.setStringPool(stringPool.getTotalLength(), stringPool.getStringCount());
+        report.write(outputDir.resolve(ObfuscationReport.FILE_NAME));
+        logger.info("Report: {} native, {} virtualized, {} skipped methods, ~{} JNI calls, {} bytes of C++, {} bytes of strings",
+                report.count(ObfuscationReport.Mode.NATIVE), report.count(ObfuscationReport.Mode.VIRTUALIZED),
+                report.count(ObfuscationReport.Mode.SKIPPED), report.getJniCalls(), report.getCppBytes(),
+                report.getStringPoolBytes());
+        for (ObfuscationReport.MethodEntry entry : report.getHotspots(5)) {
+            logger.info("  {}.{}{}: ~{} JNI calls over {} instructions", entry.getClassName(), entry.getMethodName(),
+                    entry.getDesc(), entry.getJniCalls(), entry.getInstructions());
+        }
+    }
+
+    private static JavaObfuscationConfig createJavaConfig(String strengthName, List<String> blackList, List<String> whiteList) {
+        JavaObfuscationConfig.Strength strength;
+        try {
+            strength = JavaObfuscationConfig.Strength.valueOf(strengthName.toUpperCase());
+        } catch (IllegalArgumentException e) {
+            logger.warn("Invalid Java obfuscation strength '{}', using MEDIUM", strengthName);
+            strength = JavaObfuscationConfig.Strength.MEDIUM;
+        }
+        return new JavaObfuscationConfig(true, strength, blackList, whiteList);
+    }
+
+    private ZipOutputStream newZipOutputStream(Path path) throws IOException {
+        OutputStream stream = Files.newOutputStream(path);
+        return seed != null ? new ReproducibleZipOutputStream(stream) : new ZipOutputStream(stream);
     }
 
     public Snippets getSnippets() {
@@ -499,6 +609,13 @@ public class NativeObfuscator {
         return nativeDir;
     }
 
+    /**
+     * @return metrics collected by the last {@code process} call
+     */
+    public ObfuscationReport getReport() {
+        return report;
+    }
+
     public HiddenMethodsPool getHiddenMethodsPool() {
         return hiddenMethodsPool;
     }
@@ -1,6 +1,6 @@
 package by.radioegor146;
 
-import java.util.HashMap;
+import java.util.LinkedHashMap;
 import java.util.Map;
 
 public class NodeCache<T> {
@@ -10,7 +10,7 @@ public class NodeCache<T> {
 
     public NodeCache(String pointerPattern) {
         this.pointerPattern = pointerPattern;
-        cache = new HashMap<>();
+        cache = new LinkedHashMap<>();
     }
 
     public String getPointer(T key) {
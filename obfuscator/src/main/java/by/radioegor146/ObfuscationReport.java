@@ -0,0 +1,324 @@
+package by.radioegor146;
+
+import org.objectweb.asm.Opcodes;
+import org.objectweb.asm.Type;
+import org.objectweb.asm.tree.AbstractInsnNode;
+import org.objectweb.asm.tree.LdcInsnNode;
+import org.objectweb.asm.tree.MethodNode;
+import org.objectweb.asm.tree.MultiANewArrayInsnNode;
+
+import java.io.IOException;
+import java.nio.charset.StandardCharsets;
+import java.nio.file.Files;
+import java.nio.file.Path;
+import java.util.ArrayList;
+import java.util.Collections;
+import java.util.Comparator;
+import java.util.List;
+import java.util.Locale;
+import java.util.stream.Collectors;
+
+/**
+ * Per-method record of what the obfuscator did and what it is likely to cost
+ * at runtime: transpiled/virtualized/skipped, flattening, estimated JNI calls,
+ * generated C++ size and the reason a method fell back to a cheaper mode.
+ */
+public class ObfuscationReport {
+
+    public static final String FILE_NAME = "native-report.json";
+
+    public enum Mode {
+        NATIVE, VIRTUALIZED, SKIPPED
+    }
+
+    public static class MethodEntry {
+        private final String className;
+        private final String methodName;
+        private final String desc;
+        private final int instructions;
+        private final int jniCalls;
+
+        private Mode mode = Mode.SKIPPED;
+        private boolean flattened;
+        private int cppBytes;
+        private int functions;
+        private String fallbackReason;
+
+        public MethodEntry(String className, MethodNode method) {
+            this.className = className;
+            this.methodName = method.name;
+            this.desc = method.desc;
+            this.instructions = countInstructions(method);
+            this.jniCalls = estimateJniCalls(method);
+        }
+
+        /**
+         * Records the outcome of {@link MethodProcessor#processMethod(MethodContext)}.
+         */
+        public void complete(MethodContext context) {
+            if (context.skipNative) {
+                mode = Mode.SKIPPED;
+            } else {
+                mode = context.virtualized ? Mode.VIRTUALIZED : Mode.NATIVE;
+                flattened = !context.virtualized && context.flattened;
+                cppBytes = context.output.length();
+                functions = context.functionParts + 1;
+            }
+            fallbackReason = context.fallbackReason;
+        }
+
+        public void skip(String reason) {
+            mode = Mode.SKIPPED;
+            fallbackReason = reason;
+        }
+
+        public String getClassName() {
+            return className;
+        }
+
+        public String getMethodName() {
+            return methodName;
+        }
+
+        public String getDesc() {
+            return desc;
+        }
+
+        public Mode getMode() {
+            return mode;
+        }
+
+        public boolean isFlattened() {
+            return flattened;
+        }
+
+        public int getInstructions() {
+            return instructions;
+        }
+
+        public int getJniCalls() {
+            return jniCalls;
+        }
+
+        public double getJniPerBytecode() {
+            return instructions == 0 ? 0 : (double) jniCalls / instructions;
+        }
+
+        public int getCppBytes() {
+            return cppBytes;
+        }
+
+        /**
+         * @return number of C++ functions emitted for the method, more than one
+         * when an oversized state machine was split
+         */
+        public int getFunctions() {
+            return functions;
+        }
+
+        public String getFallbackReason() {
+            return fallbackReason;
+        }
+    }
+
+    private final List<MethodEntry> methods = new ArrayList<>();
+    private int classes;
+    private long stringPoolBytes;
+    private int stringPoolEntries;
+
+    public void addClass() {
+        classes++;
+    }
+
+    public void add(MethodEntry entry) {
+        methods.add(entry);
+    }
+
+    public void setStringPool(long bytes, int entries) {
+        this.stringPoolBytes = bytes;
+        this.stringPoolEntries = entries;
+    }
+
+    public List<MethodEntry> getMethods() {
+        return Collections.unmodifiableList(methods);
+    }
+
+    public int getClasses() {
+        return classes;
+    }
+
+    public long getStringPoolBytes() {
+        return stringPoolBytes;
+    }
+
+    public long count(Mode mode) {
+        return methods.stream().filter(m -> m.mode == mode).count();
+    }
+
+    public long getCppBytes() {
+        return methods.stream().mapToLong(MethodEntry::getCppBytes).sum();
+    }
+
+    public long getJniCalls() {
+        return methods.stream().filter(m -> m.mode != Mode.SKIPPED).mapToLong(MethodEntry::getJniCalls).sum();
+    }
+
+    /**
+     * @return the transpiled methods with the most estimated JNI calls first
+     */
+    public List<MethodEntry> getHotspots(int limit) {
+        return methods.stream()
+                .filter(m -> m.mode != Mode.SKIPPED)
+                .sorted(Comparator.comparingInt(MethodEntry::getJniCalls).reversed())
+                .limit(limit)
+                .collect(Collectors.toList());
+    }
+
+    public void write(Path path) throws IOException {
+        Files.write(path, toJson().getBytes(StandardCharsets.UTF_8));
+    }
+
+    public String toJson() {
+        StringBuilder json = new StringBuilder();
+        json.append("{\n");
+        json.append("  \"summary\": {\n");
+        json.append("    \"classes\": ").append(classes).append(",\n");
+        json.append("    \"methods\": ").append(methods.size()).append(",\n");
+        json.append("    \"native\": ").append(count(Mode.NATIVE)).append(",\n");
+        json.append("    \"virtualized\": ").append(count(Mode.VIRTUALIZED)).append(",\n");
+        json.append("    \"skipped\": ").append(count(Mode.SKIPPED)).append(",\n");
+        json.append("    \"flattened\": ").append(methods.stream().filter(MethodEntry::isFlattened).count()).append(",\n");
+        json.append("    \"estimatedJniCalls\": ").append(getJniCalls()).append(",\n");
+        json.append("    \"cppBytes\": ").append(getCppBytes()).append(",\n");
+        json.append("    \"stringPoolBytes\": ").append(stringPoolBytes).append(",\n");
+        json.append("    \"stringPoolEntries\": ").append(stringPoolEntries).append("\n");
+        json.append("  },\n");
+        json.append("  \"methods\": [");
+        for (int i = 0; i < methods.size(); i++) {
+            MethodEntry m = methods.get(i);
+            json.append(i == 0 ? "\n" : ",\n");
+            json.append("    {")
+                    .append("\"class\": ").append(quote(m.className))
+                    .append(", \"name\": ").append(quote(m.methodName))
+                    .append(", \"desc\": ").append(quote(m.desc))
+                    .append(", \"mode\": ").append(quote(m.mode.name().toLowerCase(Locale.ROOT)))
+                    .append(", \"flattened\": ").append(m.flattened)
+                    .append(", \"instructions\": ").append(m.instructions)
+                    .append(", \"jniCalls\": ").append(m.jniCalls)
+                    .append(", \"jniPerBytecode\": ").append(String.format(Locale.ROOT, "%.3f", m.getJniPerBytecode()))
+                    .append(", \"cppBytes\": ").append(m.cppBytes)
+                    .append(", \"functions\": ").append(m.functions)
+                    .append(", \"fallback\": ").append(m.fallbackReason == null ? "null" : quote(m.fallbackReason))
+                    .append("}");
+        }
+        json.append(methods.isEmpty() ? "]\n" : "\n  ]\n");
+        json.append("}\n");
+        return json.toString();
+    }
+
+    static String quote(String value) {
+        StringBuilder sb = new StringBuilder(value.length() + 2);
+        sb.append('"');
+        for (int i = 0; i < value.length(); i++) {
+            char c = value.charAt(i);
+            switch (c) {
+                case '"':
+                    sb.append("\\\"");
+                    break;
+                case '\\':
+                    sb.append("\\\\");
+                    break;
+                case '\n':
+                    sb.append("\\n");
+                    break;
+                case '\r':
+                    sb.append("\\r");
+                    break;
+                case '\t':
+                    sb.append("\\t");
+                    break;
+                default:
+                    if (c < 0x20) {
+                        sb.append(String.format("\\u%04x", (int) c));
+                    } else {
+                        sb.append(c);
+                    }
+            }
+        }
+        return sb.append('"').toString();
+    }
+
+    static int countInstructions(MethodNode method) {
+        int count = 0;
+        for (AbstractInsnNode insn = method.instructions.getFirst(); insn != null; insn = insn.getNext()) {
+            if (insn.getOpcode() >= 0) {
+                count++;
+            }
+        }
+        return count;
+    }
+
+    /**
+     * Static estimate of the JNI transitions the generated code performs for a
+     * method body. Calls count twice (the call and its exception check); every
+     * other instruction that has to go through {@code JNIEnv} counts once.
+     */
+    static int estimateJniCalls(MethodNode method) {
+        int calls = 0;
+        for (AbstractInsnNode insn = method.instructions.getFirst(); insn != null; insn = insn.getNext()) {
+            switch (insn.getOpcode()) {
+                case Opcodes.INVOKEVIRTUAL:
+                case Opcodes.INVOKESPECIAL:
+                case Opcodes.INVOKESTATIC:
+                case Opcodes.INVOKEINTERFACE:
+                case Opcodes.INVOKEDYNAMIC:
+                    calls += 2;
+                    break;
+                case Opcodes.GETSTATIC:
+                case Opcodes.PUTSTATIC:
+                case Opcodes.GETFIELD:
+                case Opcodes.PUTFIELD:
+                case Opcodes.NEW:
+                case Opcodes.NEWARRAY:
+                case Opcodes.ANEWARRAY:
+                case Opcodes.CHECKCAST:
+                case Opcodes.INSTANCEOF:
+                case Opcodes.ARRAYLENGTH:
+                case Opcodes.IALOAD:
+                case Opcodes.LALOAD:
+                case Opcodes.FALOAD:
+                case Opcodes.DALOAD:
+                case Opcodes.AALOAD:
+                case Opcodes.BALOAD:
+                case Opcodes.CALOAD:
+                case Opcodes.SALOAD:
+                case Opcodes.IASTORE:
+                case Opcodes.LASTORE:
+                case Opcodes.FASTORE:
+                case Opcodes.DASTORE:
+                case Opcodes.AASTORE:
+                case Opcodes.BASTORE:
+                case Opcodes.CASTORE:
+                case Opcodes.SASTORE:
+                case Opcodes.ATHROW:
+                case Opcodes.MONITORENTER:
+                case Opcodes.MONITOREXIT:
+                    calls++;
+                    break;
+                case Opcodes.MULTIANEWARRAY:
+                    calls += ((MultiANewArrayInsnNode) insn).dims;
+                    break;
+                case Opcodes.LDC: {
+                    Object cst = ((LdcInsnNode) insn).cst;
+                    if (cst instanceof String || cst instanceof Type) {
+                        calls++;
+                    }
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+        return calls;
+    }
+}
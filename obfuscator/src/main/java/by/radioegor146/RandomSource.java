@@ -0,0 +1,80 @@
+package by.radioegor146;
+
+import java.nio.ByteBuffer;
+import java.nio.charset.StandardCharsets;
+import java.security.MessageDigest;
+import java.security.NoSuchAlgorithmException;
+import java.util.Random;
+import java.util.concurrent.ThreadLocalRandom;
+
+/**
+ * Single source of randomness for code generation. By default it hands out
+ * {@link ThreadLocalRandom}; when a build seed is configured the obfuscator
+ * reseeds it per class from the class contents so that repeated runs on the
+ * same input produce byte-for-byte identical output.
+ */
+public final class RandomSource {
+
+    private static final ThreadLocal<Random> SEEDED = new ThreadLocal<>();
+
+    private RandomSource() {
+    }
+
+    public static Random current() {
+        Random random = SEEDED.get();
+        return random != null ? random : ThreadLocalRandom.current();
+    }
+
+    /**
+     * Makes {@link #current()} deterministic on this thread until {@link #reset()}.
+     */
+    public static void reseed(long seed) {
+        SEEDED.set(new Random(seed));
+    }
+
+    public static void reset() {
+        SEEDED.remove();
+    }
+
+    public static boolean isSeeded() {
+        return SEEDED.get() != null;
+    }
+
+    /**
+     * Mixes the build seed with a content hash, so unchanged content maps to
+     * the same derived seed regardless of where it appears in the input.
+     */
+    public static long deriveSeed(long seed, byte[] content) {
+        byte[] digest = digest(seed, content);
+        return ByteBuffer.wrap(digest).getLong();
+    }
+
+    public static long deriveSeed(long seed, String content) {
+        return deriveSeed(seed, content.getBytes(StandardCharsets.UTF_8));
+    }
+
+    /**
+     * Fills {@code out} with bytes derived from the build seed and content.
+     */
+    public static void deriveBytes(long seed, String content, byte[] out) {
+        byte[] input = content.getBytes(StandardCharsets.UTF_8);
+        int offset = 0;
+        for (int counter = 0; offset < out.length; counter++) {
+            byte[] block = digest(seed + counter, input);
+            int count = Math.min(block.length, out.length - offset);
+            System.arraycopy(block, 0, out, offset, count);
+            offset += count;
+        }
+    }
+
+    private static byte[] digest(long seed, byte[] content) {
+        try {
+            MessageDigest sha = MessageDigest.getInstance("SHA-256");
+            sha.update(ByteBuffer.allocate(Long.BYTES).putLong(seed).array());
+            sha.update(content);
+            return sha.digest();
+        } catch (NoSuchAlgorithmException ex) {
+            throw new IllegalStateException(ex);
+        }
+    }
+}
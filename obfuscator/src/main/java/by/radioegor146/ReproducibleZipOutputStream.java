@@ -0,0 +1,30 @@
+package by.radioegor146;
+
+import java.io.IOException;
+import java.io.OutputStream;
+import java.time.LocalDateTime;
+import java.time.ZoneId;
+import java.util.zip.ZipEntry;
+import java.util.zip.ZipOutputStream;
+
+/**
+ * {@link ZipOutputStream} that stamps every entry with the same timestamp so
+ * the archive bytes depend only on entry names, order and contents.
+ */
+public class ReproducibleZipOutputStream extends ZipOutputStream {
+
+    // Zip stores local DOS time; convert in the default zone so the stored
+    // value is 1980-02-01 00:00 on every machine.
+    private static final long ENTRY_TIME = LocalDateTime.of(1980, 2, 1, 0, 0)
+            .atZone(ZoneId.systemDefault()).toInstant().toEpochMilli();
+
+    public ReproducibleZipOutputStream(OutputStream out) {
+        super(out);
+    }
+
+    @Override
+    public void putNextEntry(ZipEntry e) throws IOException {
+        e.setTime(ENTRY_TIME);
+        super.putNextEntry(e);
+    }
+}
@@ -0,0 +1,173 @@
+package by.radioegor146;
+
+import by.radioegor146.source.StringPool;
+
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.Comparator;
+import java.util.LinkedHashMap;
+import java.util.List;
+import java.util.Map;
+
+/**
+ * Build-time perfect hash over the {@link String#hashCode()} values of the
+ * labels of a lowered string switch, looked up by
+ * {@code utils::string_switch_index}. Hash codes are spread into buckets, and
+ * each bucket gets a displacement that sends its codes to free slots
+ * (hash-and-displace), so a lookup probes exactly one slot.
+ */
+public final class StringSwitchTable {
+
+    private static final int MAX_DISPLACEMENT = 1 << 16;
+
+    private final List<String> cases;
+    private final List<Integer> results;
+    private final int[] displacements;
+    private final int[] slots;
+
+    private StringSwitchTable(List<String> cases, List<Integer> results, int[] displacements, int[] slots) {
+        this.cases = cases;
+        this.results = results;
+        this.displacements = displacements;
+        this.slots = slots;
+    }
+
+    static int fmix32(int h) {
+        h ^= h >>> 16;
+        h *= 0x85EBCA6B;
+        h ^= h >>> 13;
+        h *= 0xC2B2AE35;
+        h ^= h >>> 16;
+        return h;
+    }
+
+    static int slot(int hash, int displacement, int mask) {
+        return fmix32(hash ^ (displacement * 0x9E3779B9)) & mask;
+    }
+
+    /**
+     * @param cases labels, the result of a label is its index
+     */
+    public static StringSwitchTable build(List<String> cases) {
+        // Cases sharing a hash code are probed one after another
+        Map<Integer, List<Integer>> byHash = new LinkedHashMap<>();
+        for (int i = 0; i < cases.size(); i++) {
+            byHash.computeIfAbsent(cases.get(i).hashCode(), unused -> new ArrayList<>()).add(i);
+        }
+        List<String> ordered = new ArrayList<>();
+        List<Integer> results = new ArrayList<>();
+        Map<Integer, Integer> firstIndex = new LinkedHashMap<>();
+        byHash.forEach((hash, indices) -> {
+            firstIndex.put(hash, ordered.size());
+            for (int index : indices) {
+                ordered.add(cases.get(index));
+                results.add(index);
+            }
+        });
+
+        int[] hashes = byHash.keySet().stream().mapToInt(Integer::intValue).toArray();
+        int bucketCount = Integer.highestOneBit(Math.max(1, hashes.length / 2) * 2 - 1);
+        for (int slotCount = Integer.highestOneBit(Math.max(1, hashes.length) * 2 - 1) * 2; ; slotCount *= 2) {
+            int[] displacements = new int[bucketCount];
+            int[] slots = findSlots(hashes, bucketCount, slotCount, displacements);
+            if (slots != null) {
+                for (int i = 0; i < slots.length; i++) {
+                    slots[i] = slots[i] < 0 ? -1 : firstIndex.get(hashes[slots[i]]);
+                }
+                return new StringSwitchTable(ordered, results, displacements, slots);
+            }
+        }
+    }
+
+    /**
+     * @return for each slot the index in {@code hashes} placed there or -1,
+     * or {@code null} if some bucket found no displacement
+     */
+    private static int[] findSlots(int[] hashes, int bucketCount, int slotCount, int[] displacements) {
+        List<List<Integer>> buckets = new ArrayList<>();
+        for (int i = 0; i < bucketCount; i++) {
+            buckets.add(new ArrayList<>());
+        }
+        for (int i = 0; i < hashes.length; i++) {
+            buckets.get(fmix32(hashes[i]) & (bucketCount - 1)).add(i);
+        }
+        Integer[] order = new Integer[bucketCount];
+        for (int i = 0; i < bucketCount; i++) {
+            order[i] = i;
+        }
+        // Fullest buckets first, while most slots are free
+        Arrays.sort(order, Comparator.comparingInt((Integer bucket) -> -buckets.get(bucket).size()));
+
+        int[] slots = new int[slotCount];
+        Arrays.fill(slots, -1);
+        for (int bucket : order) {
+            List<Integer> members = buckets.get(bucket);
+            if (members.isEmpty()) {
+                break;
+            }
+            boolean placed = false;
+            for (int displacement = 0; displacement < MAX_DISPLACEMENT && !placed; displacement++) {
+                int[] taken = new int[members.size()];
+                placed = true;
+                for (int i = 0; i < members.size() && placed; i++) {
+                    taken[i] = slot(hashes[members.get(i)], displacement, slotCount - 1);
+                    placed = slots[taken[i]] < 0;
+                    for (int j = 0; j < i && placed; j++) {
+                        placed = taken[j] != taken[i];
+                    }
+                }
+                if (placed) {
+                    for (int i = 0; i < members.size(); i++) {
+                        slots[taken[i]] = members.get(i);
+                    }
+                    displacements[bucket] = displacement;
+                }
+            }
+            if (!placed) {
+                return null;
+            }
+        }
+        return slots;
+    }
+
+    /**
+     * @return index of the case equal to {@code value}, or -1, as the native lookup computes it
+     */
+    public int lookup(String value) {
+        int hash = value.hashCode();
+        int displacement = displacements[fmix32(hash) & (displacements.length - 1)];
+        for (int index = slots[slot(hash, displacement, slots.length - 1)];
+             index >= 0 && index < cases.size() && cases.get(index).hashCode() == hash; index++) {
+            if (cases.get(index).equals(value)) {
+                return results.get(index);
+            }
+        }
+        return -1;
+    }
+
+    /**
+     * @return statements declaring the table as {@code __ngen_switch} and
+     * decrypting its labels on first use
+     */
+    public String toCpp(StringPool stringPool) {
+        StringBuilder cpp = new StringBuilder("static const utils::string_switch_case __ngen_cases[] = { ");
+        for (int i = 0; i < cases.size(); i++) {
+            cpp.append(String.format("{ %d, %d, %s }, ", cases.get(i).hashCode(), results.get(i),
+                    stringPool.getTableEntry(cases.get(i))));
+        }
+        cpp.append("}; static const uint32_t __ngen_displacements[] = { ");
+        for (int displacement : displacements) {
+            cpp.append(displacement).append("U, ");
+        }
+        cpp.append("}; static const jint __ngen_slots[] = { ");
+        for (int slot : slots) {
+            cpp.append(slot).append(", ");
+        }
+        cpp.append(String.format("}; static const utils::string_switch __ngen_switch = { __ngen_cases, %d, "
+                        + "__ngen_displacements, %dU, __ngen_slots, %dU }; ",
+                cases.size(), displacements.length - 1, slots.length - 1));
+        cpp.append("static std::once_flag __ngen_prepared; "
+                + "std::call_once(__ngen_prepared, [] { utils::prepare_string_switch(__ngen_switch); }); ");
+        return cpp.toString();
+    }
+}
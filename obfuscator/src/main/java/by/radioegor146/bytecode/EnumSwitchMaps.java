@@ -0,0 +1,201 @@
+package by.radioegor146.bytecode;
+
+import org.objectweb.asm.ClassReader;
+import org.objectweb.asm.Opcodes;
+import org.objectweb.asm.tree.*;
+
+import java.util.HashMap;
+import java.util.Map;
+import java.util.function.Function;
+
+/**
+ * Resolves javac's synthetic {@code $SwitchMap$} arrays at build time. The
+ * holder's {@code <clinit>} stores {@code map[E.NAME.ordinal()] = case} for
+ * every enum constant named in a switch, and the enum's own {@code <clinit>}
+ * passes each constant its ordinal, so both classes together give the
+ * contents of the array without running either of them.
+ */
+public class EnumSwitchMaps {
+
+    private final Function<String, byte[]> classSource;
+    private final Map<String, ClassNode> classes = new HashMap<>();
+    private final Map<String, Map<String, Integer>> ordinals = new HashMap<>();
+    private final Map<String, int[]> maps = new HashMap<>();
+
+    /**
+     * @param classSource class file bytes by internal name, or {@code null}
+     *                    for classes outside the jar
+     */
+    public EnumSwitchMaps(Function<String, byte[]> classSource) {
+        this.classSource = classSource;
+    }
+
+    private ClassNode getClass(String name) {
+        return classes.computeIfAbsent(name, key -> {
+            byte[] bytes = classSource.apply(key);
+            if (bytes == null) {
+                return null;
+            }
+            ClassNode classNode = new ClassNode(Opcodes.ASM7);
+            new ClassReader(bytes).accept(classNode, ClassReader.SKIP_DEBUG | ClassReader.SKIP_FRAMES);
+            return classNode;
+        });
+    }
+
+    private static MethodNode getClinit(ClassNode classNode) {
+        return classNode.methods.stream().filter(method -> method.name.equals("<clinit>")).findFirst().orElse(null);
+    }
+
+    private static AbstractInsnNode nextReal(AbstractInsnNode insn) {
+        do {
+            insn = insn.getNext();
+        } while (insn != null && insn.getOpcode() < 0);
+        return insn;
+    }
+
+    private static Integer getIntConstant(AbstractInsnNode insn) {
+        if (insn == null) {
+            return null;
+        }
+        int opcode = insn.getOpcode();
+        if (opcode >= Opcodes.ICONST_M1 && opcode <= Opcodes.ICONST_5) {
+            return opcode - Opcodes.ICONST_0;
+        }
+        if (opcode == Opcodes.BIPUSH || opcode == Opcodes.SIPUSH) {
+            return ((IntInsnNode) insn).operand;
+        }
+        if (opcode == Opcodes.LDC && ((LdcInsnNode) insn).cst instanceof Integer) {
+            return (Integer) ((LdcInsnNode) insn).cst;
+        }
+        return null;
+    }
+
+    private static boolean isField(AbstractInsnNode insn, int opcode, String owner, String name, String desc) {
+        if (insn == null || insn.getOpcode() != opcode) {
+            return false;
+        }
+        FieldInsnNode fieldInsnNode = (FieldInsnNode) insn;
+        return fieldInsnNode.owner.equals(owner) && (name == null || fieldInsnNode.name.equals(name))
+                && (desc == null || fieldInsnNode.desc.equals(desc));
+    }
+
+    /**
+     * @return ordinal of every constant of {@code enumName} by field name, from
+     * the {@code NEW; DUP; LDC name; <ordinal>} sequence that constructs it
+     */
+    private Map<String, Integer> getOrdinals(String enumName) {
+        if (ordinals.containsKey(enumName)) {
+            return ordinals.get(enumName);
+        }
+        Map<String, Integer> result = null;
+        ClassNode enumClass = getClass(enumName);
+        MethodNode clinit = enumClass == null || (enumClass.access & Opcodes.ACC_ENUM) == 0
+                ? null : getClinit(enumClass);
+        if (clinit != null) {
+            result = new HashMap<>();
+            String desc = "L" + enumName + ";";
+            Integer pending = null;
+            for (AbstractInsnNode insn : clinit.instructions) {
+                if (insn.getOpcode() == Opcodes.NEW && pending == null
+                        && (((TypeInsnNode) insn).desc.equals(enumName)
+                        || ((TypeInsnNode) insn).desc.startsWith(enumName + "$"))) {
+                    AbstractInsnNode dup = nextReal(insn);
+                    AbstractInsnNode name = dup == null ? null : nextReal(dup);
+                    if (dup != null && dup.getOpcode() == Opcodes.DUP && name != null
+                            && name.getOpcode() == Opcodes.LDC && ((LdcInsnNode) name).cst instanceof String) {
+                        pending = getIntConstant(nextReal(name));
+                    }
+                } else if (insn.getOpcode() == Opcodes.PUTSTATIC) {
+                    if (pending != null && isField(insn, Opcodes.PUTSTATIC, enumName, null, desc)) {
+                        result.put(((FieldInsnNode) insn).name, pending);
+                    }
+                    pending = null;
+                }
+            }
+            long constants = enumClass.fields.stream()
+                    .filter(field -> (field.access & Opcodes.ACC_ENUM) != 0).count();
+            boolean[] seen = new boolean[result.size()];
+            for (Map.Entry<String, Integer> entry : result.entrySet()) {
+                int ordinal = entry.getValue();
+                if (ordinal < 0 || ordinal >= seen.length || seen[ordinal] || enumClass.fields.stream()
+                        .noneMatch(field -> field.name.equals(entry.getKey())
+                                && (field.access & Opcodes.ACC_ENUM) != 0)) {
+                    result = null;
+                    break;
+                }
+                seen[ordinal] = true;
+            }
+            if (result != null && result.size() != constants) {
+                result = null;
+            }
+        }
+        ordinals.put(enumName, result);
+        return result;
+    }
+
+    /**
+     * @return contents of {@code owner.field} indexed by ordinal, or
+     * {@code null} if it is not a javac switch map over an enum in the jar
+     */
+    public int[] resolve(String owner, String field) {
+        String key = owner + "." + field;
+        if (maps.containsKey(key)) {
+            return maps.get(key);
+        }
+        int[] result = null;
+        ClassNode holder = getClass(owner);
+        MethodNode clinit = holder == null ? null : getClinit(holder);
+        if (clinit != null) {
+            result = resolve(clinit, owner, field);
+        }
+        maps.put(key, result);
+        return result;
+    }
+
+    private int[] resolve(MethodNode clinit, String owner, String field) {
+        String enumName = null;
+        Map<String, Integer> cases = new HashMap<>();
+        for (AbstractInsnNode insn : clinit.instructions) {
+            if (isField(insn, Opcodes.PUTSTATIC, owner, field, "[I")) {
+                // INVOKESTATIC E.values(); ARRAYLENGTH; NEWARRAY T_INT; PUTSTATIC map
+                AbstractInsnNode newArray = insn.getPrevious();
+                AbstractInsnNode length = newArray == null ? null : newArray.getPrevious();
+                AbstractInsnNode values = length == null ? null : length.getPrevious();
+                if (enumName != null || values == null || newArray.getOpcode() != Opcodes.NEWARRAY
+                        || ((IntInsnNode) newArray).operand != Opcodes.T_INT
+                        || length.getOpcode() != Opcodes.ARRAYLENGTH || values.getOpcode() != Opcodes.INVOKESTATIC
+                        || !((MethodInsnNode) values).name.equals("values")) {
+                    return null;
+                }
+                enumName = ((MethodInsnNode) values).owner;
+                continue;
+            }
+            if (!isField(insn, Opcodes.GETSTATIC, owner, field, "[I")) {
+                if (isField(insn, Opcodes.PUTSTATIC, owner, field, null)) {
+                    return null;
+                }
+                continue;
+            }
+            // GETSTATIC map; GETSTATIC E.NAME; INVOKEVIRTUAL E.ordinal(); <case>; IASTORE
+            AbstractInsnNode constant = nextReal(insn);
+            AbstractInsnNode ordinal = constant == null ? null : nextReal(constant);
+            AbstractInsnNode value = ordinal == null ? null : nextReal(ordinal);
+            AbstractInsnNode store = value == null ? null : nextReal(value);
+            if (enumName == null || store == null || store.getOpcode() != Opcodes.IASTORE
+                    || !isField(constant, Opcodes.GETSTATIC, enumName, null, "L" + enumName + ";")
+                    || ordinal.getOpcode() != Opcodes.INVOKEVIRTUAL || !((MethodInsnNode) ordinal).name.equals("ordinal")
+                    || !((MethodInsnNode) ordinal).desc.equals("()I") || getIntConstant(value) == null) {
+                return null;
+            }
+            cases.put(((FieldInsnNode) constant).name, getIntConstant(value));
+        }
+
+        Map<String, Integer> enumOrdinals = enumName == null ? null : getOrdinals(enumName);
+        if (enumOrdinals == null || !enumOrdinals.keySet().containsAll(cases.keySet())) {
+            return null;
+        }
+        int[] map = new int[enumOrdinals.size()];
+        cases.forEach((name, value) -> map[enumOrdinals.get(name)] = value);
+        return map;
+    }
+}
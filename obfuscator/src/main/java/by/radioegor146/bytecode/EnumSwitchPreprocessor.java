@@ -0,0 +1,77 @@
+package by.radioegor146.bytecode;
+
+import by.radioegor146.Platform;
+import org.objectweb.asm.Opcodes;
+import org.objectweb.asm.tree.*;
+
+/**
+ * Replaces {@code GETSTATIC $SwitchMap$E; <enum>; INVOKEVIRTUAL ordinal; IALOAD}
+ * with {@code <enum>; <enum switch marker>} when {@link EnumSwitchMaps} can
+ * resolve the map, so the lowered switch reads the ordinal field and indexes
+ * a native constant table instead of initializing the synthetic holder class.
+ */
+public class EnumSwitchPreprocessor implements Preprocessor {
+
+    // Keeps the marker name below the constant pool's UTF-8 limit
+    private static final int MAX_NAME_LENGTH = 60000;
+
+    /**
+     * @return the {@code ordinal()} call reading the index for the map loaded
+     * by {@code mapLoad}, or {@code null} if the enum expression branches
+     */
+    private static MethodInsnNode findOrdinal(AbstractInsnNode mapLoad) {
+        for (AbstractInsnNode insn = mapLoad.getNext(); insn != null; insn = insn.getNext()) {
+            if (insn instanceof JumpInsnNode || insn instanceof TableSwitchInsnNode
+                    || insn instanceof LookupSwitchInsnNode || insn instanceof LabelNode
+                    || insn.getOpcode() == Opcodes.ATHROW
+                    || (insn.getOpcode() >= Opcodes.IRETURN && insn.getOpcode() <= Opcodes.RETURN)
+                    || (insn instanceof FieldInsnNode && ((FieldInsnNode) insn).name.startsWith("$SwitchMap$"))) {
+                return null;
+            }
+            if (insn.getOpcode() == Opcodes.INVOKEVIRTUAL && ((MethodInsnNode) insn).name.equals("ordinal")
+                    && ((MethodInsnNode) insn).desc.equals("()I")) {
+                AbstractInsnNode load = insn.getNext();
+                while (load != null && load.getOpcode() < 0 && !(load instanceof LabelNode)) {
+                    load = load.getNext();
+                }
+                return load != null && load.getOpcode() == Opcodes.IALOAD ? (MethodInsnNode) insn : null;
+            }
+        }
+        return null;
+    }
+
+    @Override
+    public void process(ClassNode classNode, MethodNode methodNode, Platform platform) {
+        EnumSwitchMaps enumSwitchMaps = PreprocessorRunner.getEnumSwitchMaps();
+        AbstractInsnNode insnNode = methodNode.instructions.getFirst();
+        while (insnNode != null) {
+            AbstractInsnNode next = insnNode.getNext();
+            if (insnNode.getOpcode() != Opcodes.GETSTATIC || !((FieldInsnNode) insnNode).desc.equals("[I")
+                    || !((FieldInsnNode) insnNode).name.startsWith("$SwitchMap$")) {
+                insnNode = next;
+                continue;
+            }
+            MethodInsnNode ordinal = findOrdinal(insnNode);
+            int[] map = ordinal == null ? null
+                    : enumSwitchMaps.resolve(((FieldInsnNode) insnNode).owner, ((FieldInsnNode) insnNode).name);
+            if (map == null) {
+                insnNode = next;
+                continue;
+            }
+            MethodInsnNode marker = (MethodInsnNode) PreprocessorUtils.ENUM_SWITCH.apply(map);
+            if (marker.name.length() >= MAX_NAME_LENGTH) {
+                insnNode = next;
+                continue;
+            }
+
+            AbstractInsnNode load = ordinal.getNext();
+            while (load.getOpcode() != Opcodes.IALOAD) {
+                load = load.getNext();
+            }
+            methodNode.instructions.remove(load);
+            methodNode.instructions.set(ordinal, marker);
+            methodNode.instructions.remove(insnNode);
+            insnNode = next;
+        }
+    }
+}
@@ -12,10 +12,14 @@ public class PreprocessorRunner {
 
     private final static List<Preprocessor> PREPROCESSORS = new ArrayList<>();
     private static Remapper remapper = new Remapper() {};
+    private static EnumSwitchMaps enumSwitchMaps = new EnumSwitchMaps(name -> null);
 
     static {
+        PREPROCESSORS.add(new StringConcatPreprocessor());
         PREPROCESSORS.add(new IndyPreprocessor());
         PREPROCESSORS.add(new LdcPreprocessor());
+        PREPROCESSORS.add(new StringSwitchPreprocessor());
+        PREPROCESSORS.add(new EnumSwitchPreprocessor());
     }
 
     public static void setRemapper(Remapper remapper) {
@@ -26,6 +30,14 @@ public class PreprocessorRunner {
         return remapper;
     }
 
+    public static void setEnumSwitchMaps(EnumSwitchMaps enumSwitchMaps) {
+        PreprocessorRunner.enumSwitchMaps = enumSwitchMaps;
+    }
+
+    public static EnumSwitchMaps getEnumSwitchMaps() {
+        return enumSwitchMaps;
+    }
+
     public static void preprocess(ClassNode classNode, MethodNode methodNode, Platform platform) {
         for (Preprocessor preprocessor : PREPROCESSORS) {
             preprocessor.process(classNode, methodNode, platform);
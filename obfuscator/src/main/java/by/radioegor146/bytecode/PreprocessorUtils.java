@@ -1,5 +1,6 @@
 package by.radioegor146.bytecode;
 
+import by.radioegor146.RandomSource;
 import org.objectweb.asm.Opcodes;
 import org.objectweb.asm.Type;
 import org.objectweb.asm.tree.AbstractInsnNode;
@@ -8,11 +9,23 @@ import org.objectweb.asm.tree.MethodInsnNode;
 import java.util.ArrayList;
 import java.util.Arrays;
 import java.util.List;
+import java.util.function.BiFunction;
 import java.util.function.Function;
 import java.util.function.Supplier;
 
 public class PreprocessorUtils {
-    private static final String MAGIC_CONST = String.valueOf(Math.random());
+    private static String MAGIC_CONST = String.valueOf(Math.random());
+
+    /**
+     * Derives the marker owner suffix from {@code seed}, so the markers, and
+     * any output depending on their names, are the same on every run.
+     * {@code null} picks a random suffix.
+     */
+    public static void setSeed(Long seed) {
+        MAGIC_CONST = seed != null
+                ? Long.toUnsignedString(RandomSource.deriveSeed(seed, "preprocessor markers"))
+                : String.valueOf(Math.random());
+    }
 
     public static final Supplier<AbstractInsnNode> LOOKUP_LOCAL = () -> new MethodInsnNode(Opcodes.INVOKESTATIC,
             "native/magic/1/lookup/obfuscator" + MAGIC_CONST, "a",
@@ -34,6 +47,49 @@ public class PreprocessorUtils {
             "native/magic/1/linkcallsite/obfuscator" + MAGIC_CONST, "a", "(Ljava/lang/Object;Ljava/lang/Object;" +
             "Ljava/lang/Object;Ljava/lang/Object;" +
             "Ljava/lang/Object;[Ljava/lang/Object;)Ljava/lang/invoke/MemberName;");
+    // (String)I, the case labels are encoded in the name in result order
+    public static final Function<List<String>, AbstractInsnNode> STRING_SWITCH = cases -> {
+        StringBuilder name = new StringBuilder("s");
+        for (int i = 0; i < cases.size(); i++) {
+            if (i > 0) {
+                name.append('_');
+            }
+            for (char c : cases.get(i).toCharArray()) {
+                name.append(String.format("%04x", (int) c));
+            }
+        }
+        return new MethodInsnNode(Opcodes.INVOKESTATIC, "native/magic/1/stringswitch/obfuscator" + MAGIC_CONST,
+                name.toString(), "(Ljava/lang/String;)I");
+    };
+
+    // (Object)I, the switch map is encoded in the name, indexed by ordinal
+    public static final Function<int[], AbstractInsnNode> ENUM_SWITCH = map -> {
+        StringBuilder name = new StringBuilder("e");
+        for (int i = 0; i < map.length; i++) {
+            if (i > 0) {
+                name.append('_');
+            }
+            name.append(map[i]);
+        }
+        return new MethodInsnNode(Opcodes.INVOKESTATIC, "native/magic/1/enumswitch/obfuscator" + MAGIC_CONST,
+                name.toString(), "(Ljava/lang/Object;)I");
+    };
+
+    // (arguments)String, the constant text before each argument and after the
+    // last one is encoded in the name
+    public static final BiFunction<List<String>, List<Type>, AbstractInsnNode> STRING_CONCAT = (constants, arguments) -> {
+        StringBuilder name = new StringBuilder("c");
+        for (int i = 0; i < constants.size(); i++) {
+            if (i > 0) {
+                name.append('_');
+            }
+            for (char c : constants.get(i).toCharArray()) {
+                name.append(String.format("%04x", (int) c));
+            }
+        }
+        return new MethodInsnNode(Opcodes.INVOKESTATIC, "native/magic/1/concat/obfuscator" + MAGIC_CONST,
+                name.toString(), Type.getMethodDescriptor(Type.getType(String.class), arguments.toArray(new Type[0])));
+    };
 
     private static boolean areMethodNodesEqual(MethodInsnNode methodInsnNode, MethodInsnNode realMethodInsnNode) {
         if (methodInsnNode.getType() != realMethodInsnNode.getType()) {
@@ -82,6 +138,64 @@ public class PreprocessorUtils {
         return compareSuppliers(abstractInsnNode, LINK_CALL_SITE_METHOD);
     }
 
+    public static boolean isStringSwitch(AbstractInsnNode abstractInsnNode) {
+        if (!(abstractInsnNode instanceof MethodInsnNode)) {
+            return false;
+        }
+        MethodInsnNode methodInsnNode = (MethodInsnNode) abstractInsnNode;
+        MethodInsnNode realMethodInsnNode = (MethodInsnNode) STRING_SWITCH.apply(new ArrayList<>());
+        return methodInsnNode.owner.equals(realMethodInsnNode.owner);
+    }
+
+    public static List<String> getStringSwitchCases(MethodInsnNode methodInsnNode) {
+        List<String> cases = new ArrayList<>();
+        for (String encoded : methodInsnNode.name.substring(1).split("_", -1)) {
+            StringBuilder value = new StringBuilder();
+            for (int i = 0; i < encoded.length(); i += 4) {
+                value.append((char) Integer.parseInt(encoded.substring(i, i + 4), 16));
+            }
+            cases.add(value.toString());
+        }
+        return cases;
+    }
+
+    public static boolean isEnumSwitch(AbstractInsnNode abstractInsnNode) {
+        if (!(abstractInsnNode instanceof MethodInsnNode)) {
+            return false;
+        }
+        MethodInsnNode methodInsnNode = (MethodInsnNode) abstractInsnNode;
+        MethodInsnNode realMethodInsnNode = (MethodInsnNode) ENUM_SWITCH.apply(new int[0]);
+        return methodInsnNode.owner.equals(realMethodInsnNode.owner);
+    }
+
+    public static int[] getEnumSwitchMap(MethodInsnNode methodInsnNode) {
+        if (methodInsnNode.name.length() == 1) {
+            return new int[0];
+        }
+        return Arrays.stream(methodInsnNode.name.substring(1).split("_")).mapToInt(Integer::parseInt).toArray();
+    }
+
+    public static boolean isStringConcat(AbstractInsnNode abstractInsnNode) {
+        if (!(abstractInsnNode instanceof MethodInsnNode)) {
+            return false;
+        }
+        MethodInsnNode methodInsnNode = (MethodInsnNode) abstractInsnNode;
+        MethodInsnNode realMethodInsnNode = (MethodInsnNode) STRING_CONCAT.apply(new ArrayList<>(), new ArrayList<>());
+        return methodInsnNode.owner.equals(realMethodInsnNode.owner);
+    }
+
+    public static List<String> getStringConcatConstants(MethodInsnNode methodInsnNode) {
+        List<String> constants = new ArrayList<>();
+        for (String encoded : methodInsnNode.name.substring(1).split("_", -1)) {
+            StringBuilder value = new StringBuilder();
+            for (int i = 0; i < encoded.length(); i += 4) {
+                value.append((char) Integer.parseInt(encoded.substring(i, i + 4), 16));
+            }
+            constants.add(value.toString());
+        }
+        return constants;
+    }
+
     private PreprocessorUtils() {
     }
 }
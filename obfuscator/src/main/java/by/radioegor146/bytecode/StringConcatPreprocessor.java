@@ -0,0 +1,312 @@
+package by.radioegor146.bytecode;
+
+import by.radioegor146.Platform;
+import org.objectweb.asm.Opcodes;
+import org.objectweb.asm.Type;
+import org.objectweb.asm.tree.*;
+import org.objectweb.asm.tree.analysis.Analyzer;
+import org.objectweb.asm.tree.analysis.AnalyzerException;
+import org.objectweb.asm.tree.analysis.Frame;
+import org.objectweb.asm.tree.analysis.SourceInterpreter;
+import org.objectweb.asm.tree.analysis.SourceValue;
+
+import java.util.ArrayList;
+import java.util.HashMap;
+import java.util.HashSet;
+import java.util.List;
+import java.util.Map;
+import java.util.Set;
+
+/**
+ * Replaces string concatenation over primitives and strings with one
+ * {@code <string concat marker>}, which is lowered to a native formatter and
+ * a single NewString. Two shapes are handled: javac's pre-9
+ * <pre>
+ * NEW StringBuilder; DUP; [LDC "c"]; INVOKESPECIAL &lt;init&gt;
+ * (&lt;value&gt;; INVOKEVIRTUAL append(T))*
+ * INVOKEVIRTUAL toString
+ * </pre>
+ * and {@code INVOKEDYNAMIC} through {@code StringConcatFactory}. The value
+ * expressions stay where they are and leave their results on the stack in
+ * order; the builder and its appends are removed and constant strings are
+ * folded into the marker. Builder chains must be straight-line code that
+ * never touches the builder other than through the chain.
+ */
+public class StringConcatPreprocessor implements Preprocessor {
+
+    // Keeps the marker name below the constant pool's UTF-8 limit
+    private static final int MAX_NAME_LENGTH = 60000;
+    // A descriptor takes at most 255 argument slots
+    private static final int MAX_ARGUMENT_SLOTS = 200;
+
+    private static final String BUILDER = "java/lang/StringBuilder";
+    private static final Type STRING_TYPE = Type.getType(String.class);
+    private static final Map<String, Type> APPEND_TYPES = new HashMap<>();
+
+    static {
+        APPEND_TYPES.put("(Ljava/lang/String;)Ljava/lang/StringBuilder;", STRING_TYPE);
+        APPEND_TYPES.put("(I)Ljava/lang/StringBuilder;", Type.INT_TYPE);
+        APPEND_TYPES.put("(J)Ljava/lang/StringBuilder;", Type.LONG_TYPE);
+        APPEND_TYPES.put("(F)Ljava/lang/StringBuilder;", Type.FLOAT_TYPE);
+        APPEND_TYPES.put("(D)Ljava/lang/StringBuilder;", Type.DOUBLE_TYPE);
+        APPEND_TYPES.put("(Z)Ljava/lang/StringBuilder;", Type.BOOLEAN_TYPE);
+        APPEND_TYPES.put("(C)Ljava/lang/StringBuilder;", Type.CHAR_TYPE);
+    }
+
+    // Constant text around the arguments: constants.size() == arguments.size() + 1
+    private static class Recipe {
+        private final List<String> constants = new ArrayList<>();
+        private final List<Type> arguments = new ArrayList<>();
+        private final StringBuilder current = new StringBuilder();
+
+        void constant(String value) {
+            current.append(value);
+        }
+
+        void argument(Type type) {
+            constants.add(current.toString());
+            current.setLength(0);
+            arguments.add(type);
+        }
+
+        MethodInsnNode toMarker() {
+            int slots = arguments.stream().mapToInt(Type::getSize).sum();
+            if (slots > MAX_ARGUMENT_SLOTS) {
+                return null;
+            }
+            List<String> allConstants = new ArrayList<>(constants);
+            allConstants.add(current.toString());
+            MethodInsnNode marker = (MethodInsnNode) PreprocessorUtils.STRING_CONCAT.apply(allConstants, arguments);
+            return marker.name.length() < MAX_NAME_LENGTH ? marker : null;
+        }
+    }
+
+    private static class Chain {
+        private final List<AbstractInsnNode> removed = new ArrayList<>();
+        private final Recipe recipe = new Recipe();
+        private MethodInsnNode toString;
+    }
+
+    private static boolean isConcatArgument(Type type) {
+        return (type.getSort() >= Type.BOOLEAN && type.getSort() <= Type.DOUBLE) || type.equals(STRING_TYPE);
+    }
+
+    private static boolean isStringConstant(AbstractInsnNode insn) {
+        return insn instanceof LdcInsnNode && ((LdcInsnNode) insn).cst instanceof String;
+    }
+
+    private static boolean isBuilderCall(AbstractInsnNode insn, int opcode, String name) {
+        if (insn == null || insn.getOpcode() != opcode) {
+            return false;
+        }
+        MethodInsnNode methodInsnNode = (MethodInsnNode) insn;
+        return methodInsnNode.owner.equals(BUILDER) && methodInsnNode.name.equals(name);
+    }
+
+    private static boolean leavesStraightLine(AbstractInsnNode insn) {
+        int opcode = insn.getOpcode();
+        return insn instanceof JumpInsnNode || insn instanceof TableSwitchInsnNode
+                || insn instanceof LookupSwitchInsnNode || opcode == Opcodes.ATHROW || opcode == Opcodes.RET
+                || (opcode >= Opcodes.IRETURN && opcode <= Opcodes.RETURN);
+    }
+
+    /**
+     * Stack copies give the builder a new source value, so they are the one
+     * way it could escape without failing the identity check on the frames.
+     * {@code depth} counts the stack values from the builder to the top.
+     */
+    private static boolean copiesBuilder(AbstractInsnNode insn, int depth) {
+        switch (insn.getOpcode()) {
+            case Opcodes.DUP:
+                return depth < 2;
+            case Opcodes.DUP_X1:
+            case Opcodes.DUP_X2:
+            case Opcodes.DUP2:
+            case Opcodes.DUP2_X1:
+            case Opcodes.DUP2_X2:
+            case Opcodes.SWAP:
+                return depth <= 2;
+            default:
+                return false;
+        }
+    }
+
+    private static Set<LabelNode> getJumpTargets(MethodNode methodNode) {
+        Set<LabelNode> targets = new HashSet<>();
+        for (AbstractInsnNode insn : methodNode.instructions) {
+            if (insn instanceof JumpInsnNode) {
+                targets.add(((JumpInsnNode) insn).label);
+            } else if (insn instanceof TableSwitchInsnNode) {
+                targets.add(((TableSwitchInsnNode) insn).dflt);
+                targets.addAll(((TableSwitchInsnNode) insn).labels);
+            } else if (insn instanceof LookupSwitchInsnNode) {
+                targets.add(((LookupSwitchInsnNode) insn).dflt);
+                targets.addAll(((LookupSwitchInsnNode) insn).labels);
+            }
+        }
+        if (methodNode.tryCatchBlocks != null) {
+            for (TryCatchBlockNode tryCatch : methodNode.tryCatchBlocks) {
+                targets.add(tryCatch.handler);
+            }
+        }
+        return targets;
+    }
+
+    /**
+     * @return the chain started by {@code newInsn}, or {@code null} if the
+     * builder is used in any other way or the chain is not straight-line
+     */
+    private static Chain matchChain(InsnList instructions, Frame<SourceValue>[] frames, TypeInsnNode newInsn,
+                                    Set<LabelNode> targets) {
+        Frame<SourceValue> start = frames[instructions.indexOf(newInsn)];
+        AbstractInsnNode dup = newInsn.getNext();
+        if (start == null || dup == null || dup.getOpcode() != Opcodes.DUP) {
+            return null;
+        }
+        // The builder lives at this stack position for the whole chain
+        int base = start.getStackSize();
+        Chain chain = new Chain();
+        chain.removed.add(newInsn);
+        chain.removed.add(dup);
+
+        AbstractInsnNode insn = dup.getNext();
+        if (isStringConstant(insn) && isBuilderCall(insn.getNext(), Opcodes.INVOKESPECIAL, "<init>")
+                && ((MethodInsnNode) insn.getNext()).desc.equals("(Ljava/lang/String;)V")) {
+            chain.recipe.constant((String) ((LdcInsnNode) insn).cst);
+            chain.removed.add(insn);
+            insn = insn.getNext();
+        } else if (!isBuilderCall(insn, Opcodes.INVOKESPECIAL, "<init>") || !((MethodInsnNode) insn).desc.equals("()V")) {
+            return null;
+        }
+        chain.removed.add(insn);
+
+        SourceValue builder = null;
+        for (insn = insn.getNext(); insn != null; insn = insn.getNext()) {
+            Frame<SourceValue> frame = frames[instructions.indexOf(insn)];
+            if (frame == null || frame.getStackSize() <= base) {
+                return null;
+            }
+            if (builder == null) {
+                builder = frame.getStack(base);
+            } else if (frame.getStack(base) != builder) {
+                return null;
+            }
+            if ((insn instanceof LabelNode && targets.contains(insn)) || leavesStraightLine(insn)
+                    || copiesBuilder(insn, frame.getStackSize() - base)) {
+                return null;
+            }
+            if (frame.getStackSize() == base + 1 && isBuilderCall(insn, Opcodes.INVOKEVIRTUAL, "toString")
+                    && ((MethodInsnNode) insn).desc.equals("()Ljava/lang/String;")) {
+                chain.toString = (MethodInsnNode) insn;
+                return chain;
+            }
+            if (frame.getStackSize() != base + 2 || !isBuilderCall(insn, Opcodes.INVOKEVIRTUAL, "append")) {
+                continue;
+            }
+            Type type = APPEND_TYPES.get(((MethodInsnNode) insn).desc);
+            if (type == null) {
+                return null;
+            }
+            AbstractInsnNode value = insn.getPrevious();
+            if (type.equals(STRING_TYPE) && isStringConstant(value)
+                    && frames[instructions.indexOf(value)].getStackSize() == base + 1) {
+                chain.recipe.constant((String) ((LdcInsnNode) value).cst);
+                chain.removed.add(value);
+            } else {
+                chain.recipe.argument(type);
+            }
+            chain.removed.add(insn);
+            // The append's result is the builder from here on
+            builder = null;
+        }
+        return null;
+    }
+
+    private static MethodInsnNode lowerIndy(InvokeDynamicInsnNode indy) {
+        if (!indy.bsm.getOwner().equals("java/lang/invoke/StringConcatFactory")) {
+            return null;
+        }
+        Type[] arguments = Type.getArgumentTypes(indy.desc);
+        for (Type argument : arguments) {
+            if (!isConcatArgument(argument)) {
+                return null;
+            }
+        }
+        Recipe recipe = new Recipe();
+        if (indy.bsm.getName().equals("makeConcat")) {
+            for (Type argument : arguments) {
+                recipe.argument(argument);
+            }
+            return recipe.toMarker();
+        }
+        if (!indy.bsm.getName().equals("makeConcatWithConstants") || indy.bsmArgs.length == 0
+                || !(indy.bsmArgs[0] instanceof String)) {
+            return null;
+        }
+        String pattern = (String) indy.bsmArgs[0];
+        int argument = 0;
+        int constant = 1;
+        for (char c : pattern.toCharArray()) {
+            if (c == '\u0001') {
+                if (argument >= arguments.length) {
+                    return null;
+                }
+                recipe.argument(arguments[argument++]);
+            } else if (c == '\u0002') {
+                if (constant >= indy.bsmArgs.length) {
+                    return null;
+                }
+                recipe.constant(String.valueOf(indy.bsmArgs[constant++]));
+            } else {
+                recipe.constant(String.valueOf(c));
+            }
+        }
+        return argument == arguments.length ? recipe.toMarker() : null;
+    }
+
+    @Override
+    public void process(ClassNode classNode, MethodNode methodNode, Platform platform) {
+        InsnList instructions = methodNode.instructions;
+        List<TypeInsnNode> builders = new ArrayList<>();
+        for (AbstractInsnNode insn : instructions) {
+            if (insn instanceof InvokeDynamicInsnNode) {
+                MethodInsnNode marker = lowerIndy((InvokeDynamicInsnNode) insn);
+                if (marker != null) {
+                    instructions.set(insn, marker);
+                }
+            } else if (insn.getOpcode() == Opcodes.NEW && ((TypeInsnNode) insn).desc.equals(BUILDER)) {
+                builders.add((TypeInsnNode) insn);
+            }
+        }
+        if (builders.isEmpty()) {
+            return;
+        }
+
+        Frame<SourceValue>[] frames;
+        try {
+            frames = new Analyzer<>(new SourceInterpreter()).analyze(classNode.name, methodNode);
+        } catch (AnalyzerException ex) {
+            return;
+        }
+        // Chains are matched on the original code, nested ones included, and
+        // only then rewritten; each removes only its own instructions
+        Set<LabelNode> targets = getJumpTargets(methodNode);
+        List<Chain> chains = new ArrayList<>();
+        for (TypeInsnNode builder : builders) {
+            Chain chain = matchChain(instructions, frames, builder, targets);
+            if (chain != null) {
+                chains.add(chain);
+            }
+        }
+        for (Chain chain : chains) {
+            MethodInsnNode marker = chain.recipe.toMarker();
+            if (marker == null) {
+                continue;
+            }
+            for (AbstractInsnNode insn : chain.removed) {
+                instructions.remove(insn);
+            }
+            instructions.set(chain.toString, marker);
+        }
+    }
+}
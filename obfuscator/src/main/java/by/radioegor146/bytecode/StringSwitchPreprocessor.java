@@ -0,0 +1,233 @@
+package by.radioegor146.bytecode;
+
+import by.radioegor146.Platform;
+import org.objectweb.asm.Opcodes;
+import org.objectweb.asm.tree.*;
+
+import java.util.ArrayList;
+import java.util.HashMap;
+import java.util.HashSet;
+import java.util.List;
+import java.util.Map;
+import java.util.Set;
+
+/**
+ * Replaces the first half of a javac string switch,
+ * <pre>
+ * ALOAD t; INVOKEVIRTUAL String.hashCode; LOOKUPSWITCH/TABLESWITCH
+ * L: ALOAD t; LDC "a"; INVOKEVIRTUAL String.equals; IFEQ next; ICONST_0; ISTORE i; GOTO dflt
+ * ...
+ * </pre>
+ * with {@code ALOAD t; <string switch marker>; ISTORE i; GOTO dflt}, which is
+ * lowered to a native perfect-hash lookup. Every hashCode and equals upcall
+ * of the switch is dropped; the second switch over {@code i} is left as is.
+ */
+public class StringSwitchPreprocessor implements Preprocessor {
+
+    // Keeps the marker name below the constant pool's UTF-8 limit
+    private static final int MAX_NAME_LENGTH = 60000;
+
+    private static boolean isStringMethod(AbstractInsnNode insn, String name, String desc) {
+        if (insn == null || insn.getOpcode() != Opcodes.INVOKEVIRTUAL) {
+            return false;
+        }
+        MethodInsnNode methodInsnNode = (MethodInsnNode) insn;
+        return methodInsnNode.owner.equals("java/lang/String") && methodInsnNode.name.equals(name)
+                && methodInsnNode.desc.equals(desc);
+    }
+
+    private static Integer getIntConstant(AbstractInsnNode insn) {
+        int opcode = insn.getOpcode();
+        if (opcode >= Opcodes.ICONST_M1 && opcode <= Opcodes.ICONST_5) {
+            return opcode - Opcodes.ICONST_0;
+        }
+        if (opcode == Opcodes.BIPUSH || opcode == Opcodes.SIPUSH) {
+            return ((IntInsnNode) insn).operand;
+        }
+        if (opcode == Opcodes.LDC && ((LdcInsnNode) insn).cst instanceof Integer) {
+            return (Integer) ((LdcInsnNode) insn).cst;
+        }
+        return null;
+    }
+
+    private static AbstractInsnNode nextReal(AbstractInsnNode insn) {
+        do {
+            insn = insn.getNext();
+        } while (insn != null && insn.getOpcode() < 0);
+        return insn;
+    }
+
+    private static Set<LabelNode> getPinnedLabels(MethodNode methodNode) {
+        Set<LabelNode> labels = new HashSet<>();
+        if (methodNode.tryCatchBlocks != null) {
+            for (TryCatchBlockNode tryCatch : methodNode.tryCatchBlocks) {
+                labels.add(tryCatch.start);
+                labels.add(tryCatch.end);
+                labels.add(tryCatch.handler);
+            }
+        }
+        if (methodNode.localVariables != null) {
+            for (LocalVariableNode localVariable : methodNode.localVariables) {
+                labels.add(localVariable.start);
+                labels.add(localVariable.end);
+            }
+        }
+        return labels;
+    }
+
+    /**
+     * @return labels in result order, or {@code null} if the code between the
+     * switch and its default label is not exactly a javac case chain
+     */
+    private static List<String> matchCases(MethodNode methodNode, VarInsnNode load, AbstractInsnNode hashSwitch,
+                                           List<Integer> keys, List<LabelNode> targets, LabelNode dflt,
+                                           int[] resultVar) {
+        Set<LabelNode> pinned = getPinnedLabels(methodNode);
+        Set<LabelNode> inside = new HashSet<>();
+        Set<JumpInsnNode> chainJumps = new HashSet<>();
+        Map<Integer, String> cases = new HashMap<>();
+        resultVar[0] = -1;
+
+        AbstractInsnNode insn = hashSwitch.getNext();
+        while (insn != dflt) {
+            if (insn == null) {
+                return null;
+            }
+            if (insn instanceof LabelNode) {
+                if (pinned.contains(insn)) {
+                    return null;
+                }
+                inside.add((LabelNode) insn);
+                insn = insn.getNext();
+                continue;
+            }
+            if (insn.getOpcode() < 0) {
+                insn = insn.getNext();
+                continue;
+            }
+            // ALOAD t; LDC "a"; INVOKEVIRTUAL equals; IFEQ next; <k>; ISTORE i; [GOTO dflt]
+            if (insn.getOpcode() != Opcodes.ALOAD || ((VarInsnNode) insn).var != load.var) {
+                return null;
+            }
+            AbstractInsnNode ldc = nextReal(insn);
+            AbstractInsnNode equals = ldc == null ? null : nextReal(ldc);
+            AbstractInsnNode ifeq = equals == null ? null : nextReal(equals);
+            AbstractInsnNode result = ifeq == null ? null : nextReal(ifeq);
+            AbstractInsnNode store = result == null ? null : nextReal(result);
+            if (store == null || ldc.getOpcode() != Opcodes.LDC || !(((LdcInsnNode) ldc).cst instanceof String)
+                    || !isStringMethod(equals, "equals", "(Ljava/lang/Object;)Z")
+                    || ifeq.getOpcode() != Opcodes.IFEQ || getIntConstant(result) == null
+                    || store.getOpcode() != Opcodes.ISTORE
+                    || (resultVar[0] >= 0 && ((VarInsnNode) store).var != resultVar[0])) {
+                return null;
+            }
+            String value = (String) ((LdcInsnNode) ldc).cst;
+            int index = keys.indexOf(value.hashCode());
+            if (index < 0 || cases.put(getIntConstant(result), value) != null) {
+                return null;
+            }
+            resultVar[0] = ((VarInsnNode) store).var;
+            chainJumps.add((JumpInsnNode) ifeq);
+            insn = nextReal(store);
+            if (insn != null && insn.getOpcode() == Opcodes.GOTO) {
+                chainJumps.add((JumpInsnNode) insn);
+                insn = insn.getNext();
+            } else {
+                insn = store.getNext();
+            }
+        }
+
+        // Chain jumps stay inside the chain, and nothing else jumps into it
+        for (JumpInsnNode jump : chainJumps) {
+            if (jump.label != dflt && !inside.contains(jump.label)) {
+                return null;
+            }
+        }
+        for (LabelNode target : targets) {
+            if (target != dflt && !inside.contains(target)) {
+                return null;
+            }
+        }
+        for (AbstractInsnNode other : methodNode.instructions) {
+            if (other == hashSwitch || chainJumps.contains(other)) {
+                continue;
+            }
+            if (other instanceof JumpInsnNode && inside.contains(((JumpInsnNode) other).label)) {
+                return null;
+            }
+            if (other instanceof TableSwitchInsnNode && (inside.contains(((TableSwitchInsnNode) other).dflt)
+                    || ((TableSwitchInsnNode) other).labels.stream().anyMatch(inside::contains))) {
+                return null;
+            }
+            if (other instanceof LookupSwitchInsnNode && (inside.contains(((LookupSwitchInsnNode) other).dflt)
+                    || ((LookupSwitchInsnNode) other).labels.stream().anyMatch(inside::contains))) {
+                return null;
+            }
+        }
+
+        List<String> ordered = new ArrayList<>();
+        for (int i = 0; i < cases.size(); i++) {
+            String value = cases.get(i);
+            if (value == null) {
+                return null;
+            }
+            ordered.add(value);
+        }
+        return ordered.isEmpty() ? null : ordered;
+    }
+
+    @Override
+    public void process(ClassNode classNode, MethodNode methodNode, Platform platform) {
+        AbstractInsnNode insnNode = methodNode.instructions.getFirst();
+        while (insnNode != null) {
+            AbstractInsnNode hashCode = insnNode.getNext();
+            AbstractInsnNode hashSwitch = hashCode == null ? null : hashCode.getNext();
+            if (insnNode.getOpcode() != Opcodes.ALOAD || !isStringMethod(hashCode, "hashCode", "()I")
+                    || !(hashSwitch instanceof LookupSwitchInsnNode || hashSwitch instanceof TableSwitchInsnNode)) {
+                insnNode = insnNode.getNext();
+                continue;
+            }
+
+            List<Integer> keys = new ArrayList<>();
+            List<LabelNode> targets;
+            LabelNode dflt;
+            if (hashSwitch instanceof LookupSwitchInsnNode) {
+                LookupSwitchInsnNode lookupSwitch = (LookupSwitchInsnNode) hashSwitch;
+                keys.addAll(lookupSwitch.keys);
+                targets = lookupSwitch.labels;
+                dflt = lookupSwitch.dflt;
+            } else {
+                TableSwitchInsnNode tableSwitch = (TableSwitchInsnNode) hashSwitch;
+                for (int key = tableSwitch.min; key <= tableSwitch.max; key++) {
+                    keys.add(key);
+                }
+                targets = tableSwitch.labels;
+                dflt = tableSwitch.dflt;
+            }
+
+            int[] resultVar = new int[1];
+            List<String> cases = matchCases(methodNode, (VarInsnNode) insnNode, hashSwitch, keys, targets, dflt,
+                    resultVar);
+            if (cases == null) {
+                insnNode = insnNode.getNext();
+                continue;
+            }
+            MethodInsnNode marker = (MethodInsnNode) PreprocessorUtils.STRING_SWITCH.apply(cases);
+            if (marker.name.length() >= MAX_NAME_LENGTH) {
+                insnNode = insnNode.getNext();
+                continue;
+            }
+
+            while (hashSwitch.getNext() != dflt) {
+                methodNode.instructions.remove(hashSwitch.getNext());
+            }
+            methodNode.instructions.set(hashCode, marker);
+            InsnList replacement = new InsnList();
+            replacement.add(new VarInsnNode(Opcodes.ISTORE, resultVar[0]));
+            replacement.add(new JumpInsnNode(Opcodes.GOTO, dflt));
+            methodNode.instructions.insert(hashSwitch, replacement);
+            methodNode.instructions.remove(hashSwitch);
+            insnNode = dflt;
+        }
+    }
+}
@@ -1,9 +1,22 @@
 package by.radioegor146.compiletime;
 
 import java.io.File;
-import java.io.FileOutputStream;
 import java.io.IOException;
 import java.io.InputStream;
+import java.net.JarURLConnection;
+import java.net.URL;
+import java.net.URLConnection;
+import java.nio.file.FileAlreadyExistsException;
+import java.nio.file.FileSystems;
+import java.nio.file.Files;
+import java.nio.file.Path;
+import java.nio.file.Paths;
+import java.nio.file.StandardCopyOption;
+import java.nio.file.attribute.PosixFilePermission;
+import java.nio.file.attribute.PosixFilePermissions;
+import java.util.Set;
+import java.util.jar.JarEntry;
+import java.util.zip.CRC32;
 
 public class LoaderUnpack {
     public static native void registerNativesForClass(int index, Class<?> clazz);
@@ -45,6 +58,119 @@ public class LoaderUnpack {
 
         String libFileName = String.format("/%s/%s-%s", LoaderUnpack.class.getName().split("\\.")[0], platformTypeName, osTypeName);
 
+        URL libUrl = LoaderUnpack.class.getResource(libFileName);
+        if (libUrl == null) {
+            throw new UnsatisfiedLinkError(String.format("Failed to open lib file: %s", libFileName));
+        }
+
+        File libFile;
+        try {
+            libFile = findCachedLibrary(libUrl, platformTypeName + "-" + osTypeName);
+        } catch (IOException | SecurityException | UnsupportedOperationException exception) {
+            libFile = null;
+        }
+        if (libFile == null) {
+            libFile = unpackTempLibrary(libUrl);
+        }
+        System.load(libFile.getAbsolutePath());
+    }
+
+    /**
+     * Returns the library from a per-user cache directory, keyed by the CRC and
+     * size recorded in the jar entry, unpacking it there on first use. Repeated
+     * starts load the same file, so nothing is written and processes share its
+     * pages. A new copy is written next to the target and renamed over it, so
+     * concurrent starts never load a partial file.
+     *
+     * @return {@code null} if the library is not in a jar or no safe cache
+     * directory is available
+     */
+    private static File findCachedLibrary(URL libUrl, String name) throws IOException {
+        URLConnection connection = libUrl.openConnection();
+        if (!(connection instanceof JarURLConnection)) {
+            return null;
+        }
+        JarEntry entry = ((JarURLConnection) connection).getJarEntry();
+        long crc = entry.getCrc();
+        long size = entry.getSize();
+        if (crc < 0 || size < 0) {
+            return null;
+        }
+
+        Path cacheDir = getCacheDirectory();
+        if (cacheDir == null) {
+            return null;
+        }
+        Path target = cacheDir.resolve(String.format("%08x-%x-%s", crc, size, name));
+        if (isIntact(target, crc, size)) {
+            return target.toFile();
+        }
+
+        Path temp = Files.createTempFile(cacheDir, "lib", ".tmp");
+        try {
+            try (InputStream inputStream = connection.getInputStream()) {
+                Files.copy(inputStream, temp, StandardCopyOption.REPLACE_EXISTING);
+            }
+            if (!isIntact(temp, crc, size)) {
+                return null;
+            }
+            try {
+                Files.move(temp, target, StandardCopyOption.ATOMIC_MOVE);
+            } catch (IOException exception) {
+                // Another process may have won the race, or holds the target open on Windows
+                if (!isIntact(target, crc, size)) {
+                    throw exception;
+                }
+            }
+            return target.toFile();
+        } finally {
+            Files.deleteIfExists(temp);
+        }
+    }
+
+    private static Path getCacheDirectory() throws IOException {
+        String user = System.getProperty("user.name", "").replaceAll("[^A-Za-z0-9_.-]", "_");
+        Path cacheDir = Paths.get(System.getProperty("java.io.tmpdir"), "jni-cache-" + user);
+        boolean posix = FileSystems.getDefault().supportedFileAttributeViews().contains("posix");
+        if (!Files.isDirectory(cacheDir)) {
+            try {
+                if (posix) {
+                    Files.createDirectory(cacheDir, PosixFilePermissions.asFileAttribute(
+                            PosixFilePermissions.fromString("rwx------")));
+                } else {
+                    Files.createDirectory(cacheDir);
+                }
+            } catch (FileAlreadyExistsException ignored) {
+                // Created concurrently, checked below
+            }
+        }
+        if (posix) {
+            // Anyone else able to write to the directory could plant a library
+            Set<PosixFilePermission> permissions = Files.getPosixFilePermissions(cacheDir);
+            if (!Files.getOwner(cacheDir).getName().equals(System.getProperty("user.name"))
+                    || permissions.contains(PosixFilePermission.GROUP_WRITE)
+                    || permissions.contains(PosixFilePermission.OTHERS_WRITE)) {
+                return null;
+            }
+        }
+        return cacheDir;
+    }
+
+    private static boolean isIntact(Path file, long crc, long size) throws IOException {
+        if (!Files.isRegularFile(file) || Files.size(file) != size) {
+            return false;
+        }
+        CRC32 checksum = new CRC32();
+        byte[] buffer = new byte[65536];
+        try (InputStream inputStream = Files.newInputStream(file)) {
+            for (int read = inputStream.read(buffer); read != -1; read = inputStream.read(buffer)) {
+                checksum.update(buffer, 0, read);
+            }
+        }
+        return checksum.getValue() == crc;
+    }
+
+    private static File unpackTempLibrary(URL libUrl) {
         File libFile;
         try {
             libFile = File.createTempFile("lib", null);
@@ -55,40 +181,11 @@ public class LoaderUnpack {
         } catch (IOException iOException) {
             throw new UnsatisfiedLinkError("Failed to create temp file");
         }
-        byte[] arrayOfByte = new byte[2048];
-        try {
-            InputStream inputStream = LoaderUnpack.class.getResourceAsStream(libFileName);
-            if (inputStream == null) {
-                throw new UnsatisfiedLinkError(String.format("Failed to open lib file: %s", libFileName));
-            }
-            try {
-                FileOutputStream fileOutputStream = new FileOutputStream(libFile);
-                try {
-                    int size;
-                    while ((size = inputStream.read(arrayOfByte)) != -1) {
-                        fileOutputStream.write(arrayOfByte, 0, size);
-                    }
-                    fileOutputStream.close();
-                } catch (Throwable throwable) {
-                    try {
-                        fileOutputStream.close();
-                    } catch (Throwable throwable1) {
-                        throwable.addSuppressed(throwable1);
-                    }
-                    throw throwable;
-                }
-                inputStream.close();
-            } catch (Throwable throwable) {
-                try {
-                    inputStream.close();
-                } catch (Throwable throwable1) {
-                    throwable.addSuppressed(throwable1);
-                }
-                throw throwable;
-            }
+        try (InputStream inputStream = libUrl.openStream()) {
+            Files.copy(inputStream, libFile.toPath(), StandardCopyOption.REPLACE_EXISTING);
         } catch (IOException exception) {
             throw new UnsatisfiedLinkError(String.format("Failed to copy file: %s", exception.getMessage()));
         }
-        System.load(libFile.getAbsolutePath());
+        return libFile;
     }
 }
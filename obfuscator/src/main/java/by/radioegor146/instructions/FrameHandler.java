@@ -5,10 +5,14 @@ import by.radioegor146.MethodProcessor;
 import by.radioegor146.Util;
 import org.objectweb.asm.Opcodes;
 import org.objectweb.asm.Type;
+import org.objectweb.asm.tree.AbstractInsnNode;
 import org.objectweb.asm.tree.FrameNode;
 import org.objectweb.asm.tree.LabelNode;
+import org.objectweb.asm.tree.LineNumberNode;
 
+import java.util.ArrayList;
 import java.util.Arrays;
+import java.util.List;
 import java.util.function.Consumer;
 
 public class FrameHandler implements InstructionTypeHandler<FrameNode> {
@@ -65,30 +69,48 @@ public class FrameHandler implements InstructionTypeHandler<FrameNode> {
                 break;
         }
 
-        if (context.stack.stream().anyMatch(x -> x == 0)) {
-            int currentSp = 0;
-            context.output.append("    ");
-            for (int type : context.stack) {
-                if (type == 0) {
-                    context.output.append("refs.erase(cstack").append(currentSp).append(".l); ");
-                }
-                currentSp += Math.max(1, type);
+        if (!isLoopHeader(context, node)) {
+            return;
+        }
+
+        // Loop header: release every reference not held by a live slot so the
+        // local reference table stays bounded by one iteration's worth.
+        List<String> live = new ArrayList<>();
+        int currentSp = 0;
+        for (int type : context.stack) {
+            if (type == 0) {
+                live.add("cstack" + currentSp + ".l");
             }
-            context.output.append("\n");
+            currentSp += Math.max(1, type);
         }
+        int currentLp = 0;
+        for (int type : context.locals) {
+            if (type == 0) {
+                live.add("clocal" + currentLp + ".l");
+            }
+            currentLp += Math.max(1, type);
+        }
+        live.add("clazz");
+        live.add("classloader");
+        live.add("lookup");
+        context.output.append("#ifdef NATIVE_JVM_REF_METRICS\n");
+        context.output.append("    __ngen_ref_metrics.sample();\n");
+        context.output.append("#endif\n");
+        context.output.append("    { jobject __ngen_live[] = { ").append(String.join(", ", live))
+                .append(" }; utils::clear_refs(env, refs, __ngen_live, ").append(live.size()).append("); }\n");
+    }
 
-        if (context.locals.stream().anyMatch(x -> x == 0)) {
-            int currentLp = 0;
-            context.output.append("    ");
-            for (int type : context.locals) {
-                if (type == 0) {
-                    context.output.append("refs.erase(clocal").append(currentLp).append(".l); ");
+    private static boolean isLoopHeader(MethodContext context, FrameNode node) {
+        for (AbstractInsnNode prev = node.getPrevious(); prev != null; prev = prev.getPrevious()) {
+            if (prev instanceof LabelNode) {
+                if (context.loopHeaders.contains(prev)) {
+                    return true;
                 }
-                currentLp += Math.max(1, type);
+            } else if (!(prev instanceof LineNumberNode)) {
+                return false;
             }
-            context.output.append("\n");
         }
-        context.output.append("    utils::clear_refs(env, refs);\n");
+        return false;
     }
 
     @Override
@@ -1,10 +1,10 @@
 package by.radioegor146.instructions;
 
 import by.radioegor146.MethodContext;
+import by.radioegor146.RandomSource;
 import by.radioegor146.Util;
 import org.objectweb.asm.Opcodes;
 import org.objectweb.asm.tree.InsnNode;
-import java.util.concurrent.ThreadLocalRandom;
 
 public class InsnHandler extends GenericInstructionHandler<InsnNode> {
 
@@ -38,10 +38,10 @@ public class InsnHandler extends GenericInstructionHandler<InsnNode> {
             }
             case Opcodes.IADD: {
                 instructionName = null;
-                long seed = ThreadLocalRandom.current().nextLong();
-                if (ThreadLocalRandom.current().nextBoolean()) {
-                    long junkSeed = ThreadLocalRandom.current().nextLong();
-                    int junkIdx = ThreadLocalRandom.current().nextBoolean() ? 1 : 2;
+                long seed = RandomSource.current().nextLong();
+                if (RandomSource.current().nextBoolean()) {
+                    long junkSeed = RandomSource.current().nextLong();
+                    int junkIdx = RandomSource.current().nextBoolean() ? 1 : 2;
                     context.output.append(String.format(
                             "native_jvm::vm::run_arith_vm(env, native_jvm::vm::OP_JUNK%d, 0, 0, %dLL);%s",
                             junkIdx, junkSeed, props.get("trycatchhandler")));
@@ -54,10 +54,10 @@ public class InsnHandler extends GenericInstructionHandler<InsnNode> {
             }
             case Opcodes.ISUB: {
                 instructionName = null;
-                long seed = ThreadLocalRandom.current().nextLong();
-                if (ThreadLocalRandom.current().nextBoolean()) {
-                    long junkSeed = ThreadLocalRandom.current().nextLong();
-                    int junkIdx = ThreadLocalRandom.current().nextBoolean() ? 1 : 2;
+                long seed = RandomSource.current().nextLong();
+                if (RandomSource.current().nextBoolean()) {
+                    long junkSeed = RandomSource.current().nextLong();
+                    int junkIdx = RandomSource.current().nextBoolean() ? 1 : 2;
                     context.output.append(String.format(
                             "native_jvm::vm::run_arith_vm(env, native_jvm::vm::OP_JUNK%d, 0, 0, %dLL);%s",
                             junkIdx, junkSeed, props.get("trycatchhandler")));
@@ -70,10 +70,10 @@ public class InsnHandler extends GenericInstructionHandler<InsnNode> {
             }
             case Opcodes.IMUL: {
                 instructionName = null;
-                long seed = ThreadLocalRandom.current().nextLong();
-                if (ThreadLocalRandom.current().nextBoolean()) {
-                    long junkSeed = ThreadLocalRandom.current().nextLong();
-                    int junkIdx = ThreadLocalRandom.current().nextBoolean() ? 1 : 2;
+                long seed = RandomSource.current().nextLong();
+                if (RandomSource.current().nextBoolean()) {
+                    long junkSeed = RandomSource.current().nextLong();
+                    int junkIdx = RandomSource.current().nextBoolean() ? 1 : 2;
                     context.output.append(String.format(
                             "native_jvm::vm::run_arith_vm(env, native_jvm::vm::OP_JUNK%d, 0, 0, %dLL);%s",
                             junkIdx, junkSeed, props.get("trycatchhandler")));
@@ -86,10 +86,10 @@ public class InsnHandler extends GenericInstructionHandler<InsnNode> {
             }
             case Opcodes.IDIV: {
                 instructionName = null;
-                long seed = ThreadLocalRandom.current().nextLong();
-                if (ThreadLocalRandom.current().nextBoolean()) {
-                    long junkSeed = ThreadLocalRandom.current().nextLong();
-                    int junkIdx = ThreadLocalRandom.current().nextBoolean() ? 1 : 2;
+                long seed = RandomSource.current().nextLong();
+                if (RandomSource.current().nextBoolean()) {
+                    long junkSeed = RandomSource.current().nextLong();
+                    int junkIdx = RandomSource.current().nextBoolean() ? 1 : 2;
                     context.output.append(String.format(
                             "native_jvm::vm::run_arith_vm(env, native_jvm::vm::OP_JUNK%d, 0, 0, %dLL);%s",
                             junkIdx, junkSeed, props.get("trycatchhandler")));
@@ -102,10 +102,10 @@ public class InsnHandler extends GenericInstructionHandler<InsnNode> {
             }
             case Opcodes.IAND: {
                 instructionName = null;
-                long seed = ThreadLocalRandom.current().nextLong();
-                if (ThreadLocalRandom.current().nextBoolean()) {
-                    long junkSeed = ThreadLocalRandom.current().nextLong();
-                    int junkIdx = ThreadLocalRandom.current().nextBoolean() ? 1 : 2;
+                long seed = RandomSource.current().nextLong();
+                if (RandomSource.current().nextBoolean()) {
+                    long junkSeed = RandomSource.current().nextLong();
+                    int junkIdx = RandomSource.current().nextBoolean() ? 1 : 2;
                     context.output.append(String.format(
                             "native_jvm::vm::run_arith_vm(env, native_jvm::vm::OP_JUNK%d, 0, 0, %dLL);%s",
                             junkIdx, junkSeed, props.get("trycatchhandler")));
@@ -118,10 +118,10 @@ public class InsnHandler extends GenericInstructionHandler<InsnNode> {
             }
             case Opcodes.IOR: {
                 instructionName = null;
-                long seed = ThreadLocalRandom.current().nextLong();
-                if (ThreadLocalRandom.current().nextBoolean()) {
-                    long junkSeed = ThreadLocalRandom.current().nextLong();
-                    int junkIdx = ThreadLocalRandom.current().nextBoolean() ? 1 : 2;
+                long seed = RandomSource.current().nextLong();
+                if (RandomSource.current().nextBoolean()) {
+                    long junkSeed = RandomSource.current().nextLong();
+                    int junkIdx = RandomSource.current().nextBoolean() ? 1 : 2;
                     context.output.append(String.format(
                             "native_jvm::vm::run_arith_vm(env, native_jvm::vm::OP_JUNK%d, 0, 0, %dLL);%s",
                             junkIdx, junkSeed, props.get("trycatchhandler")));
@@ -134,10 +134,10 @@ public class InsnHandler extends GenericInstructionHandler<InsnNode> {
             }
             case Opcodes.IXOR: {
                 instructionName = null;
-                long seed = ThreadLocalRandom.current().nextLong();
-                if (ThreadLocalRandom.current().nextBoolean()) {
-                    long junkSeed = ThreadLocalRandom.current().nextLong();
-                    int junkIdx = ThreadLocalRandom.current().nextBoolean() ? 1 : 2;
+                long seed = RandomSource.current().nextLong();
+                if (RandomSource.current().nextBoolean()) {
+                    long junkSeed = RandomSource.current().nextLong();
+                    int junkIdx = RandomSource.current().nextBoolean() ? 1 : 2;
                     context.output.append(String.format(
                             "native_jvm::vm::run_arith_vm(env, native_jvm::vm::OP_JUNK%d, 0, 0, %dLL);%s",
                             junkIdx, junkSeed, props.get("trycatchhandler")));
@@ -150,7 +150,7 @@ public class InsnHandler extends GenericInstructionHandler<InsnNode> {
             }
             case Opcodes.ISHL: {
                 instructionName = null;
-                long seed = ThreadLocalRandom.current().nextLong();
+                long seed = RandomSource.current().nextLong();
                 context.output.append(String.format(
                         "cstack%s.i = (jint)native_jvm::vm::run_arith_vm(env, native_jvm::vm::OP_SHL, cstack%s.i, cstack%s.i, %dLL);%s",
                         props.get("stackindexm2"), props.get("stackindexm2"), props.get("stackindexm1"), seed,
@@ -159,7 +159,7 @@ public class InsnHandler extends GenericInstructionHandler<InsnNode> {
             }
             case Opcodes.ISHR: {
                 instructionName = null;
-                long seed = ThreadLocalRandom.current().nextLong();
+                long seed = RandomSource.current().nextLong();
                 context.output.append(String.format(
                         "cstack%s.i = (jint)native_jvm::vm::run_arith_vm(env, native_jvm::vm::OP_SHR, cstack%s.i, cstack%s.i, %dLL);%s",
                         props.get("stackindexm2"), props.get("stackindexm2"), props.get("stackindexm1"), seed,
@@ -168,7 +168,7 @@ public class InsnHandler extends GenericInstructionHandler<InsnNode> {
             }
             case Opcodes.IUSHR: {
                 instructionName = null;
-                long seed = ThreadLocalRandom.current().nextLong();
+                long seed = RandomSource.current().nextLong();
                 context.output.append(String.format(
                         "cstack%s.i = (jint)native_jvm::vm::run_arith_vm(env, native_jvm::vm::OP_USHR, cstack%s.i, cstack%s.i, %dLL);%s",
                         props.get("stackindexm2"), props.get("stackindexm2"), props.get("stackindexm1"), seed,
@@ -177,7 +177,7 @@ public class InsnHandler extends GenericInstructionHandler<InsnNode> {
             }
             case Opcodes.I2B: {
                 instructionName = null;
-                long seed = ThreadLocalRandom.current().nextLong();
+                long seed = RandomSource.current().nextLong();
                 context.output.append(String.format(
                         "cstack%s.i = (jint)native_jvm::vm::run_unary_vm(env, native_jvm::vm::OP_I2B, cstack%s.i, %dLL);%s",
                         props.get("stackindexm1"), props.get("stackindexm1"), seed, props.get("trycatchhandler")));
@@ -185,7 +185,7 @@ public class InsnHandler extends GenericInstructionHandler<InsnNode> {
             }
             case Opcodes.I2C: {
                 instructionName = null;
-                long seed = ThreadLocalRandom.current().nextLong();
+                long seed = RandomSource.current().nextLong();
                 context.output.append(String.format(
                         "cstack%s.i = (jint)native_jvm::vm::run_unary_vm(env, native_jvm::vm::OP_I2C, cstack%s.i, %dLL);%s",
                         props.get("stackindexm1"), props.get("stackindexm1"), seed, props.get("trycatchhandler")));
@@ -193,7 +193,7 @@ public class InsnHandler extends GenericInstructionHandler<InsnNode> {
             }
             case Opcodes.I2S: {
                 instructionName = null;
-                long seed = ThreadLocalRandom.current().nextLong();
+                long seed = RandomSource.current().nextLong();
                 context.output.append(String.format(
                         "cstack%s.i = (jint)native_jvm::vm::run_unary_vm(env, native_jvm::vm::OP_I2S, cstack%s.i, %dLL);%s",
                         props.get("stackindexm1"), props.get("stackindexm1"), seed, props.get("trycatchhandler")));
@@ -201,7 +201,7 @@ public class InsnHandler extends GenericInstructionHandler<InsnNode> {
             }
             case Opcodes.I2L: {
                 instructionName = null;
-                long seed = ThreadLocalRandom.current().nextLong();
+                long seed = RandomSource.current().nextLong();
                 context.output.append(String.format(
                         "cstack%s.j = native_jvm::vm::run_unary_vm(env, native_jvm::vm::OP_I2L, cstack%s.i, %dLL);%s",
                         props.get("stackindexm1"), props.get("stackindexm1"), seed, props.get("trycatchhandler")));
@@ -209,7 +209,7 @@ public class InsnHandler extends GenericInstructionHandler<InsnNode> {
             }
             case Opcodes.INEG: {
                 instructionName = null;
-                long seed = ThreadLocalRandom.current().nextLong();
+                long seed = RandomSource.current().nextLong();
                 context.output.append(String.format(
                         "cstack%s.i = (jint)native_jvm::vm::run_unary_vm(env, native_jvm::vm::OP_NEG, cstack%s.i, %dLL);%s",
                         props.get("stackindexm1"), props.get("stackindexm1"), seed, props.get("trycatchhandler")));
@@ -2,11 +2,10 @@ package by.radioegor146.instructions;
 
 import by.radioegor146.MethodContext;
 import by.radioegor146.MethodProcessor;
+import by.radioegor146.RandomSource;
 import org.objectweb.asm.Type;
 import org.objectweb.asm.tree.LdcInsnNode;
 
-import java.util.concurrent.ThreadLocalRandom;
-
 public class LdcHandler extends GenericInstructionHandler<LdcInsnNode> {
 
     public static String getIntString(int value) {
@@ -68,8 +67,8 @@ public class LdcHandler extends GenericInstructionHandler<LdcInsnNode> {
             props.put("cst_ptr", context.getCachedStrings().getPointer(node.cst.toString()));
         } else if (cst instanceof Integer) {
             instructionName += "_INT";
-            int key = ThreadLocalRandom.current().nextInt();
-            int seed = ThreadLocalRandom.current().nextInt();
+            int key = RandomSource.current().nextInt();
+            int seed = RandomSource.current().nextInt();
             int mid = context.methodIndex;
             int cid = context.classIndex;
             int mixed = mix32(key, mid, cid, seed);
@@ -81,8 +80,8 @@ public class LdcHandler extends GenericInstructionHandler<LdcInsnNode> {
             props.put("seed", getIntString(seed));
         } else if (cst instanceof Long) {
             instructionName += "_LONG";
-            long key = ThreadLocalRandom.current().nextLong();
-            int seed = ThreadLocalRandom.current().nextInt();
+            long key = RandomSource.current().nextLong();
+            int seed = RandomSource.current().nextInt();
             int mid = context.methodIndex;
             int cid = context.classIndex;
             long mixed = mix64(key, mid, cid, seed);
@@ -95,8 +94,8 @@ public class LdcHandler extends GenericInstructionHandler<LdcInsnNode> {
         } else if (cst instanceof Float) {
             instructionName += "_FLOAT";
             int bits = Float.floatToRawIntBits((Float) cst);
-            int key = ThreadLocalRandom.current().nextInt();
-            int seed = ThreadLocalRandom.current().nextInt();
+            int key = RandomSource.current().nextInt();
+            int seed = RandomSource.current().nextInt();
             int mid = context.methodIndex;
             int cid = context.classIndex;
             int mixed = mix32(key, mid, cid, seed);
@@ -109,8 +108,8 @@ public class LdcHandler extends GenericInstructionHandler<LdcInsnNode> {
         } else if (cst instanceof Double) {
             instructionName += "_DOUBLE";
             long bits = Double.doubleToRawLongBits((Double) cst);
-            long key = ThreadLocalRandom.current().nextLong();
-            int seed = ThreadLocalRandom.current().nextInt();
+            long key = RandomSource.current().nextLong();
+            int seed = RandomSource.current().nextInt();
             int mid = context.methodIndex;
             int cid = context.classIndex;
             long mixed = mix64(key, mid, cid, seed);
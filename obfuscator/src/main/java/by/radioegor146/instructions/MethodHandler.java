@@ -9,10 +9,48 @@ import org.objectweb.asm.tree.*;
 import java.util.ArrayList;
 import java.util.Arrays;
 import java.util.List;
+import java.util.stream.Collectors;
 import java.util.stream.Stream;
 
 public class MethodHandler extends GenericInstructionHandler<MethodInsnNode> {
 
+    // jvalue member and cast per argument sort, for NewObjectA
+    private static final String[] JVALUE_MEMBERS = {null, "z = (jboolean) ", "c = (jchar) ", "b = (jbyte) ",
+            "s = (jshort) ", "i = ", "f = ", "j = ", "d = ", "l = ", "l = "};
+
+    // utils::concat_kind and jvalue member per argument sort of a lowered
+    // string concatenation; bytes and shorts are widened into .i, which
+    // utils::concat reads for int_value
+    private static final String[] CONCAT_KINDS = {null, "boolean_value", "char_value", "int_value", "int_value",
+            "int_value", "float_value", "long_value", "double_value", null, "string"};
+    private static final String[] CONCAT_MEMBERS = {null, "z = (jboolean) ", "c = (jchar) ", "i = (jint) ",
+            "i = (jint) ", "i = ", "f = ", "j = ", "d = ", "l = ", "l = "};
+
+    // Wrapper class and utils::box_/unbox_ suffix per primitive sort
+    private static final String[] BOX_CLASSES = {null, "java/lang/Boolean", "java/lang/Character", "java/lang/Byte",
+            "java/lang/Short", "java/lang/Integer", "java/lang/Float", "java/lang/Long", "java/lang/Double"};
+    private static final String[] BOX_NAMES = {null, "boolean", "char", "byte", "short", "int", "float", "long",
+            "double"};
+
+    /**
+     * @return sort of the primitive boxed by {@code X.valueOf(x)} or unboxed
+     * by {@code X.xValue()}, or 0 for any other call
+     */
+    private static int getBoxSort(MethodInsnNode node) {
+        for (int sort = Type.BOOLEAN; sort <= Type.DOUBLE; sort++) {
+            if (!node.owner.equals(BOX_CLASSES[sort])) {
+                continue;
+            }
+            String primitive = String.valueOf("ZCBSIFJD".charAt(sort - 1));
+            boolean valueOf = node.getOpcode() == Opcodes.INVOKESTATIC && node.name.equals("valueOf")
+                    && node.desc.equals("(" + primitive + ")L" + node.owner + ";");
+            boolean value = node.getOpcode() == Opcodes.INVOKEVIRTUAL && node.name.equals(BOX_NAMES[sort] + "Value")
+                    && node.desc.equals("()" + primitive);
+            return valueOf || value ? sort : 0;
+        }
+        return 0;
+    }
+
     private static Type simplifyType(Type type) {
         switch (type.getSort()) {
             case Type.OBJECT:
@@ -31,6 +69,7 @@ public class MethodHandler extends GenericInstructionHandler<MethodInsnNode> {
 
     @Override
     protected void process(MethodContext context, MethodInsnNode node) {
+        boolean hiddenTarget = false;
         if (PreprocessorUtils.isLookupLocal(node)) {
             context.output.append("if (lookup == nullptr) { lookup = utils::get_lookup(env, clazz); ")
                     .append(trimmedTryCatchBlock).append(" } cstack").append(context.stackPointer).append(".l = lookup;");
@@ -47,6 +86,97 @@ public class MethodHandler extends GenericInstructionHandler<MethodInsnNode> {
             instructionName = null;
             return;
         }
+        if (PreprocessorUtils.isStringSwitch(node)) {
+            StringSwitchTable table = StringSwitchTable.build(PreprocessorUtils.getStringSwitchCases(node));
+            int valueIndex = context.stackPointer - 1;
+            context.output.append("{ ").append(table.toCpp(context.getStringPool()))
+                    .append(String.format("if (cstack%1$d.l == nullptr) utils::throw_re(env, \"java/lang/NullPointerException\", " +
+                                    "\"String switch npe\", %2$d); else cstack%1$d.i = " +
+                                    "utils::string_switch_index(env, (jstring) cstack%1$d.l, __ngen_switch); } ",
+                            valueIndex, context.line))
+                    .append(trimmedTryCatchBlock);
+            instructionName = null;
+            return;
+        }
+        if (PreprocessorUtils.isEnumSwitch(node)) {
+            int[] map = PreprocessorUtils.getEnumSwitchMap(node);
+            int valueIndex = context.stackPointer - 1;
+            CachedFieldInfo info = new CachedFieldInfo("java/lang/Enum", "ordinal", "I", false);
+            MethodProcessor.ClassCacheAccess classAccess = MethodProcessor.ensureClassHandle(
+                    context, "java/lang/Enum", trimmedTryCatchBlock);
+            context.output.append(classAccess.guard());
+            int fieldId = context.getCachedFields().getId(info);
+            context.output.append(String.format("if (!cfields[%d]) { cfields[%d] = env->GetFieldID(%s, %s, %s); %s  } ",
+                    fieldId, fieldId, classAccess.local(), context.getStringPool().get("ordinal"),
+                    context.getStringPool().get("I"), trimmedTryCatchBlock));
+            context.output.append(String.format("if (cstack%1$d.l == nullptr) utils::throw_re(env, \"java/lang/NullPointerException\", " +
+                            "\"Enum switch npe\", %2$d); else { static const jint __ngen_map[] = { %3$s }; " +
+                            "jint __ngen_ordinal = env->GetIntField(cstack%1$d.l, %4$s); " +
+                            "cstack%1$d.i = __ngen_ordinal >= 0 && __ngen_ordinal < %5$d ? __ngen_map[__ngen_ordinal] : 0; } ",
+                    valueIndex, context.line,
+                    map.length == 0 ? "0" : Arrays.stream(map).mapToObj(String::valueOf).collect(Collectors.joining(", ")),
+                    context.getCachedFields().getPointer(info), map.length))
+                    .append(trimmedTryCatchBlock);
+            instructionName = null;
+            return;
+        }
+        if (PreprocessorUtils.isStringConcat(node)) {
+            List<String> constants = PreprocessorUtils.getStringConcatConstants(node);
+            Type[] args = Type.getArgumentTypes(node.desc);
+            int argsStart = context.stackPointer - Arrays.stream(args).mapToInt(Type::getSize).sum();
+            StringBuilder pieces = new StringBuilder();
+            StringBuilder values = new StringBuilder();
+            int pieceCount = 0;
+            for (int i = 0, index = argsStart; i < constants.size(); i++) {
+                if (!constants.get(i).isEmpty()) {
+                    pieces.append(String.format("{ utils::concat_kind::constant, %s }, ",
+                            context.getStringPool().getTableEntry(constants.get(i))));
+                    pieceCount++;
+                }
+                if (i == args.length) {
+                    break;
+                }
+                int sort = args[i].getSort();
+                pieces.append(String.format("{ utils::concat_kind::%s, {} }, ", CONCAT_KINDS[sort]));
+                pieceCount++;
+                values.append(String.format("__ngen_args[%d].%s%s; ", i, CONCAT_MEMBERS[sort],
+                        context.getSnippet("INVOKE_ARG_" + sort, Util.createMap("index", index))));
+                index += args[i].getSize();
+            }
+            context.output.append("{ ");
+            if (pieceCount > 0) {
+                context.output.append("static const utils::concat_piece __ngen_pieces[] = { ").append(pieces)
+                        .append("}; static std::once_flag __ngen_prepared; std::call_once(__ngen_prepared, [] { ")
+                        .append(String.format("utils::prepare_concat(__ngen_pieces, %d); }); ", pieceCount));
+            }
+            if (args.length > 0) {
+                context.output.append(String.format("jvalue __ngen_args[%d]; ", args.length)).append(values);
+            }
+            context.output.append(String.format("cstack%d.l = utils::concat(env, %s, %d, %s); } refs.insert(cstack%d.l); ",
+                            argsStart, pieceCount > 0 ? "__ngen_pieces" : "nullptr", pieceCount,
+                            args.length > 0 ? "__ngen_args" : "nullptr", argsStart))
+                    .append(trimmedTryCatchBlock);
+            instructionName = null;
+            return;
+        }
+        int boxSort = getBoxSort(node);
+        if (boxSort != 0) {
+            if (node.getOpcode() == Opcodes.INVOKESTATIC) {
+                int valueIndex = context.stackPointer - (boxSort == Type.LONG || boxSort == Type.DOUBLE ? 2 : 1);
+                context.output.append(String.format("cstack%1$d.l = utils::box_%2$s(env, %3$s); refs.insert(cstack%1$d.l); ",
+                        valueIndex, BOX_NAMES[boxSort], context.getSnippet("INVOKE_ARG_" + boxSort,
+                                Util.createMap("index", valueIndex))));
+            } else {
+                int valueIndex = context.stackPointer - 1;
+                context.output.append(String.format("if (cstack%1$d.l == nullptr) utils::throw_re(env, \"java/lang/NullPointerException\", " +
+                                "\"Unboxing npe\", %2$d); else %3$s = utils::unbox_%4$s(env, cstack%1$d.l); ",
+                        valueIndex, context.line, context.getSnippet("INVOKE_ARG_" + boxSort,
+                                Util.createMap("index", valueIndex)), BOX_NAMES[boxSort]));
+            }
+            context.output.append(trimmedTryCatchBlock);
+            instructionName = null;
+            return;
+        }
         if (PreprocessorUtils.isLinkCallSiteMethod(node)) {
             Type returnType = Type.getReturnType(node.desc);
             Type[] args = Type.getArgumentTypes(node.desc);
@@ -87,7 +217,7 @@ public class MethodHandler extends GenericInstructionHandler<MethodInsnNode> {
                             .skip(1)).toArray(Type[]::new)).getDescriptor());
 
             HiddenMethodsPool.HiddenMethod hiddenMethod = context.obfuscator.getHiddenMethodsPool()
-                    .getMethod("invokereverse", methodDesc, method -> {
+                    .getMethod(context.classIndex, "invokereverse", methodDesc, method -> {
                         method.visibleAnnotations = new ArrayList<>();
                         method.visibleAnnotations.add(new AnnotationNode("Ljava/lang/invoke/LambdaForm$Hidden;"));
                         method.visibleAnnotations.add(new AnnotationNode("Ljdk/internal/vm/annotation/Hidden;"));
@@ -111,6 +241,7 @@ public class MethodHandler extends GenericInstructionHandler<MethodInsnNode> {
             node.owner = hiddenMethod.getClassNode().name;
             node.desc = hiddenMethod.getMethodNode().desc;
             node.setOpcode(Opcodes.INVOKESTATIC);
+            hiddenTarget = true;
         }
         if (node.owner.equals("java/lang/invoke/MethodHandle") &&
                 (node.name.equals("invokeExact") || node.name.equals("invoke")) &&
@@ -126,7 +257,7 @@ public class MethodHandler extends GenericInstructionHandler<MethodInsnNode> {
             String mhDesc = simplifyDesc(node.desc);
 
             HiddenMethodsPool.HiddenMethod hiddenMethod = context.obfuscator.getHiddenMethodsPool()
-                    .getMethod("mhinvoke", methodDesc, method -> {
+                    .getMethod(context.classIndex, "mhinvoke", methodDesc, method -> {
                         method.visibleAnnotations = new ArrayList<>();
                         method.visibleAnnotations.add(new AnnotationNode("Ljava/lang/invoke/LambdaForm$Hidden;"));
                         method.visibleAnnotations.add(new AnnotationNode("Ljdk/internal/vm/annotation/Hidden;"));
@@ -146,6 +277,7 @@ public class MethodHandler extends GenericInstructionHandler<MethodInsnNode> {
             node.owner = hiddenMethod.getClassNode().name;
             node.desc = hiddenMethod.getMethodNode().desc;
             node.setOpcode(Opcodes.INVOKESTATIC);
+            hiddenTarget = true;
         }
 
         Type returnType = Type.getReturnType(node.desc);
@@ -188,7 +320,10 @@ public class MethodHandler extends GenericInstructionHandler<MethodInsnNode> {
             props.put("class_ptr", classAccess.local());
         }
 
-        if (isStatic) {
+        // Hidden helpers have no <clinit> and are defined by the class guard, so the
+        // Class.forName round-trip is skipped: the cached jclass/jmethodID pair
+        // below is all a signature-polymorphic call site needs per invocation.
+        if (isStatic && !hiddenTarget) {
             String dotted = node.owner.replace('/', '.');
             context.output.append(String.format("utils::ensure_initialized(env, classloader, %s); %s ",
                     context.getCachedStrings().getPointer(dotted), trimmedTryCatchBlock));
@@ -208,6 +343,26 @@ public class MethodHandler extends GenericInstructionHandler<MethodInsnNode> {
                         context.getStringPool().get(node.desc),
                         trimmedTryCatchBlock));
 
+        if (node.getOpcode() == Opcodes.INVOKESPECIAL && context.fusedConstructors.remove(node)) {
+            // The deferred NEW left a placeholder just below the receiver
+            String newObject = String.format("if (jobject obj = env->NewObjectA(%s, %s, %s)) { cstack%d.l = obj; refs.insert(obj); } %s",
+                    classAccess.local(), context.getCachedMethods().getPointer(methodInfo),
+                    args.length == 0 ? "nullptr" : "__ngen_args", objectStackIndex - 1, trimmedTryCatchBlock);
+            if (args.length == 0) {
+                context.output.append(newObject);
+            } else {
+                context.output.append(String.format("{ jvalue __ngen_args[%d]; ", args.length));
+                for (int i = 0; i < args.length; i++) {
+                    context.output.append(String.format("__ngen_args[%d].%s%s; ", i, JVALUE_MEMBERS[args[i].getSort()],
+                            context.getSnippet("INVOKE_ARG_" + args[i].getSort(),
+                                    Util.createMap("index", argOffsets.get(i)))));
+                }
+                context.output.append(newObject).append(" }");
+            }
+            instructionName = null;
+            return;
+        }
+
         props.put("args", argsBuilder.toString());
 
         // Heuristic marker: if we're in the middle of an enum-switch mapping sequence
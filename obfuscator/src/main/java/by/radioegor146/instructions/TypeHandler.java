@@ -4,7 +4,15 @@ import by.radioegor146.MethodContext;
 import by.radioegor146.MethodProcessor;
 import by.radioegor146.Util;
 import org.objectweb.asm.Opcodes;
+import org.objectweb.asm.Type;
+import org.objectweb.asm.tree.AbstractInsnNode;
+import org.objectweb.asm.tree.LdcInsnNode;
+import org.objectweb.asm.tree.LineNumberNode;
+import org.objectweb.asm.tree.MethodInsnNode;
 import org.objectweb.asm.tree.TypeInsnNode;
+import org.objectweb.asm.tree.VarInsnNode;
+
+import java.util.Arrays;
 
 public class TypeHandler extends GenericInstructionHandler<TypeInsnNode> {
 
@@ -25,6 +33,72 @@ public class TypeHandler extends GenericInstructionHandler<TypeInsnNode> {
                 trimmedTryCatchBlock));
 
         props.put("desc_ptr", context.getCachedClasses().getPointer(node.desc));
+
+        if (node.getOpcode() == Opcodes.NEW) {
+            MethodInsnNode constructor = findFusableConstructor(node);
+            if (constructor != null) {
+                // Allocated together with the constructor call
+                context.fusedConstructors.add(constructor);
+                context.output.append(String.format("cstack%d.l = nullptr;", context.stackPointer));
+                instructionName = null;
+            }
+        }
+    }
+
+    /**
+     * Matches {@code NEW; DUP; <args>; INVOKESPECIAL <init>} where the
+     * arguments are only pushed by loads and constants. Those cannot throw or
+     * run code, so initializing the class at the constructor call instead of
+     * at {@code NEW} is not observable.
+     *
+     * @return the constructor call, or {@code null} if the pattern does not apply
+     */
+    public static MethodInsnNode findFusableConstructor(TypeInsnNode node) {
+        AbstractInsnNode insn = node.getNext();
+        if (insn == null || insn.getOpcode() != Opcodes.DUP) {
+            return null;
+        }
+        int pushed = 0;
+        for (insn = insn.getNext(); insn != null; insn = insn.getNext()) {
+            if (insn instanceof LineNumberNode) {
+                continue;
+            }
+            int size = getPushedSize(insn);
+            if (size == 0) {
+                break;
+            }
+            pushed += size;
+        }
+        if (!(insn instanceof MethodInsnNode) || insn.getOpcode() != Opcodes.INVOKESPECIAL) {
+            return null;
+        }
+        MethodInsnNode constructor = (MethodInsnNode) insn;
+        if (!constructor.name.equals("<init>") || !constructor.owner.equals(node.desc)
+                || Arrays.stream(Type.getArgumentTypes(constructor.desc)).mapToInt(Type::getSize).sum() != pushed) {
+            return null;
+        }
+        return constructor;
+    }
+
+    private static int getPushedSize(AbstractInsnNode insn) {
+        int opcode = insn.getOpcode();
+        if (insn instanceof VarInsnNode) {
+            return opcode == Opcodes.LLOAD || opcode == Opcodes.DLOAD ? 2
+                    : opcode >= Opcodes.ILOAD && opcode <= Opcodes.ALOAD ? 1 : 0;
+        }
+        if (insn instanceof LdcInsnNode) {
+            Object cst = ((LdcInsnNode) insn).cst;
+            if (cst instanceof Long || cst instanceof Double) {
+                return 2;
+            }
+            // Class constants may load a class
+            return cst instanceof Number || cst instanceof String ? 1 : 0;
+        }
+        if (opcode >= Opcodes.ACONST_NULL && opcode <= Opcodes.DCONST_1) {
+            return opcode == Opcodes.LCONST_0 || opcode == Opcodes.LCONST_1
+                    || opcode == Opcodes.DCONST_0 || opcode == Opcodes.DCONST_1 ? 2 : 1;
+        }
+        return opcode == Opcodes.BIPUSH || opcode == Opcodes.SIPUSH ? 1 : 0;
     }
 
     @Override
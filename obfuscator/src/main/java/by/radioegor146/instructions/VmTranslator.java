@@ -146,6 +146,28 @@ public class VmTranslator {
         return lookupSwitches;
     }
 
+    /** Maps a VM pc range to its handler, mirroring native_jvm::vm::ExceptionEntry. */
+    public static class ExceptionTableEntry {
+        public final int startPc;
+        public final int endPc;
+        public final int handlerPc;
+        /** Internal name of the caught class, or {@code null} for catch-all. */
+        public final String catchType;
+
+        public ExceptionTableEntry(int startPc, int endPc, int handlerPc, String catchType) {
+            this.startPc = startPc;
+            this.endPc = endPc;
+            this.handlerPc = handlerPc;
+            this.catchType = catchType;
+        }
+    }
+
+    private final List<ExceptionTableEntry> exceptionTable = new ArrayList<>();
+
+    public List<ExceptionTableEntry> getExceptionTable() {
+        return exceptionTable;
+    }
+
     /** Constants mirroring native_jvm::vm::OpCode. */
     public static class VmOpcodes {
         public static final int OP_PUSH = 0;
@@ -283,6 +305,7 @@ public class VmTranslator {
         public static final int OP_DUP2 = 132;
         public static final int OP_DUP2_X1 = 133;
         public static final int OP_DUP2_X2 = 134;
+        public static final int OP_ATHROW = 135;
         public static final int OP_IREM = 141;
         public static final int OP_LREM = 142;
         public static final int OP_FREM = 143;
@@ -307,6 +330,7 @@ public class VmTranslator {
         tableSwitches.clear();
         lookupSwitches.clear();
         constantPool.clear();
+        exceptionTable.clear();
         Map<LabelNode, Integer> labelIds = new HashMap<>();
         int index = 0;
         for (AbstractInsnNode insn = method.instructions.getFirst(); insn != null; insn = insn.getNext()) {
@@ -316,6 +340,17 @@ public class VmTranslator {
                 index++;
             }
         }
+        // Every translated instruction maps to exactly one VM instruction, so
+        // label ids are VM pcs and the bytecode table carries over in order.
+        if (method.tryCatchBlocks != null) {
+            for (TryCatchBlockNode tcb : method.tryCatchBlocks) {
+                int start = labelIds.get(tcb.start);
+                int end = labelIds.get(tcb.end);
+                if (start < end) {
+                    exceptionTable.add(new ExceptionTableEntry(start, end, labelIds.get(tcb.handler), tcb.type));
+                }
+            }
+        }
 
         List<Instruction> result = new ArrayList<>();
         int invokeIndex = 0;
@@ -737,6 +772,9 @@ public class VmTranslator {
                 case Opcodes.ARETURN:
                     result.add(new Instruction(VmOpcodes.OP_HALT, 0));
                     break;
+                case Opcodes.ATHROW:
+                    result.add(new Instruction(VmOpcodes.OP_ATHROW, 0));
+                    break;
                 case Opcodes.I2B:
                     result.add(new Instruction(VmOpcodes.OP_I2B, 0));
                     break;
@@ -1,5 +1,6 @@
 package by.radioegor146.javaobf;
 
+import by.radioegor146.RandomSource;
 import org.objectweb.asm.Opcodes;
 import org.objectweb.asm.Type;
 import org.objectweb.asm.tree.*;
@@ -105,10 +106,10 @@ public final class JavaControlFlowFlattener implements Opcodes {
         FlattenerImpl(MethodNode mn, String methodId, JavaObfuscationConfig.Strength strength) {
             this.mn = mn;
             String methodId1 = (methodId != null ? methodId : (mn.name + mn.desc));
-            long seed = 0x9E3779B97F4A7C15L
+            // RandomSource is derived from the class bytes when a build seed is set
+            long seed = RandomSource.current().nextLong()
                     ^ (long) methodId1.hashCode()
-                    ^ (((long) mn.access) << 17)
-                    ^ (System.identityHashCode(mn) * 0x632BE59BD9B4E019L);
+                    ^ (((long) mn.access) << 17);
             this.rnd = new Random(seed);
             this.original = mn.instructions;
             // tune by strength
@@ -2,6 +2,8 @@ package by.radioegor146.javaobf;
 
 import by.radioegor146.ClassMethodFilter;
 import by.radioegor146.ClassMethodList;
+import by.radioegor146.RandomSource;
+import by.radioegor146.ReproducibleZipOutputStream;
 import by.radioegor146.Util;
 import org.objectweb.asm.ClassReader;
 import org.objectweb.asm.ClassWriter;
@@ -35,6 +37,17 @@ public class JavaObfuscator {
 
     private static final Logger logger = LoggerFactory.getLogger(JavaObfuscator.class);
 
+    private Long seed;
+
+    /**
+     * When set, the randomness of each class is derived from this value and
+     * the class bytes, and output jar entries carry a fixed timestamp, so
+     * identical input yields an identical jar. {@code null} keeps it random.
+     */
+    public void setSeed(Long seed) {
+        this.seed = seed;
+    }
+
     public Path process(Path inputJarPath,
                         Path outputDir,
                         List<Path> inputLibs,
@@ -56,17 +69,7 @@ public class JavaObfuscator {
         List<Path> libs = new ArrayList<>(inputLibs);
         libs.add(inputJarPath);
 
-        // For Java obfuscation, we use a more permissive approach
-        // Only create whitelist if user explicitly provided one
-        ClassMethodList javaWhiteList = null;
-        if (config.getJavaWhiteList() != null && !config.getJavaWhiteList().isEmpty()) {
-            javaWhiteList = ClassMethodList.parse(config.getJavaWhiteList());
-        }
-
-        ClassMethodFilter filter = new ClassMethodFilter(
-            ClassMethodList.parse(config.getJavaBlackList()),
-            javaWhiteList, // null means no whitelist restriction
-            useAnnotations);
+        ClassMethodFilter filter = createFilter(config, useAnnotations);
         ClassMetadataReader metadataReader = new ClassMetadataReader(libs.stream().map(x -> {
             try {
                 return new JarFile(x.toFile());
@@ -79,7 +82,8 @@ public class JavaObfuscator {
         Files.createDirectories(outputDir);
 
         try (JarFile jar = new JarFile(inputJarPath.toFile());
-             ZipOutputStream out = new ZipOutputStream(Files.newOutputStream(outJar))) {
+             ZipOutputStream out = seed != null ? new ReproducibleZipOutputStream(Files.newOutputStream(outJar))
+                     : new ZipOutputStream(Files.newOutputStream(outJar))) {
             jar.stream().forEach(entry -> {
                 try {
                     if (!entry.getName().endsWith(".class")) {
@@ -94,28 +98,15 @@ public class JavaObfuscator {
                         src = in.readAllBytes();
                     }
 
+                    if (seed != null) {
+                        RandomSource.reseed(RandomSource.deriveSeed(seed, src));
+                    }
+
                     ClassReader cr = new ClassReader(src);
                     ClassNode cn = new ClassNode(Opcodes.ASM7);
                     cr.accept(cn, 0);
 
-                    boolean changed = false;
-                    if (filter.shouldProcess(cn)) {
-                        logger.info("Processing class for Java obfuscation: {}", cn.name);
-                        int methodsProcessed = 0;
-                        for (MethodNode mn : cn.methods) {
-                            if (!filter.shouldProcess(cn, mn)) continue;
-                            if (!JavaControlFlowFlattener.canProcess(mn)) continue;
-                            logger.debug("Advanced flattening method: {}.{}{}", cn.name, mn.name, mn.desc);
-                            JavaControlFlowFlattener.flatten(mn, cn.name + "#" + mn.name + mn.desc, config.getStrength());
-                            methodsProcessed++;
-                            changed = true;
-                        }
-                        if (methodsProcessed > 0) {
-                            logger.info("Applied control flow flattening to {} methods in {}", methodsProcessed, cn.name);
-                        }
-                    } else {
-                        logger.debug("Skipping class: {}", cn.name);
-                    }
+                    boolean changed = obfuscate(cn, filter, config);
 
                     if (useAnnotations && changed) {
                         // Strip annotations used for filtering to avoid leaking intent
@@ -137,10 +128,53 @@ public class JavaObfuscator {
                 out.closeEntry();
             }
         } finally {
+            RandomSource.reset();
             metadataReader.close();
         }
 
         return outJar;
     }
-}
 
+    /**
+     * Builds the class/method filter for Java obfuscation. Only an explicitly
+     * provided whitelist restricts processing.
+     */
+    public static ClassMethodFilter createFilter(JavaObfuscationConfig config, boolean useAnnotations) {
+        ClassMethodList javaWhiteList = null;
+        if (config.getJavaWhiteList() != null && !config.getJavaWhiteList().isEmpty()) {
+            javaWhiteList = ClassMethodList.parse(config.getJavaWhiteList());
+        }
+
+        return new ClassMethodFilter(
+            ClassMethodList.parse(config.getJavaBlackList()),
+            javaWhiteList, // null means no whitelist restriction
+            useAnnotations);
+    }
+
+    /**
+     * Applies Java-layer obfuscation to a parsed class in place, so callers
+     * that already hold the {@link ClassNode} (e.g. the native pipeline) can
+     * fuse both stages without an intermediate jar.
+     *
+     * @return true if any method was changed; the class then needs its frames recomputed
+     */
+    public static boolean obfuscate(ClassNode cn, ClassMethodFilter filter, JavaObfuscationConfig config) {
+        if (!filter.shouldProcess(cn)) {
+            logger.debug("Skipping class: {}", cn.name);
+            return false;
+        }
+        logger.info("Processing class for Java obfuscation: {}", cn.name);
+        int methodsProcessed = 0;
+        for (MethodNode mn : cn.methods) {
+            if (!filter.shouldProcess(cn, mn)) continue;
+            if (!JavaControlFlowFlattener.canProcess(mn)) continue;
+            logger.debug("Advanced flattening method: {}.{}{}", cn.name, mn.name, mn.desc);
+            JavaControlFlowFlattener.flatten(mn, cn.name + "#" + mn.name + mn.desc, config.getStrength());
+            methodsProcessed++;
+        }
+        if (methodsProcessed > 0) {
+            logger.info("Applied control flow flattening to {} methods in {}", methodsProcessed, cn.name);
+        }
+        return methodsProcessed > 0;
+    }
+}
@@ -11,7 +11,7 @@ import java.nio.charset.StandardCharsets;
 import java.nio.file.Files;
 import java.nio.file.Path;
 import java.util.ArrayList;
-import java.util.HashMap;
+import java.util.LinkedHashMap;
 import java.util.List;
 import java.util.Map;
 
@@ -23,12 +23,16 @@ public class ClassSourceBuilder implements AutoCloseable {
     private final BufferedWriter hppWriter;
     private final String className;
     private final String filename;
+    private final int classIndex;
 
     private final StringPool stringPool;
 
     public ClassSourceBuilder(Path cppOutputDir, String className, int classIndex, StringPool stringPool) throws IOException {
         this.className = className;
         this.stringPool = stringPool;
+        this.classIndex = classIndex;
+        // Strings of this class go to its own section of the pool
+        stringPool.beginSection(classIndex);
         filename = String.format("%s_%d", Util.escapeCppNameString(className.replace('/', '_')), classIndex);
 
         cppFile = cppOutputDir.resolve(filename.concat(".cpp"));
@@ -45,7 +49,8 @@ public class ClassSourceBuilder implements AutoCloseable {
         cppWriter.append("\n");
         cppWriter.append("// ").append(Util.escapeCommentString(className)).append("\n");
         cppWriter.append("namespace native_jvm::classes::__ngen_").append(filename).append(" {\n\n");
-        cppWriter.append("    char *string_pool;\n\n");
+        cppWriter.append("    char *string_pool;\n");
+        cppWriter.append("    std::size_t string_section;\n\n");
 
         if (strings > 0) {
             cppWriter.append(String.format("    jstring cstrings[%d];\n", strings));
@@ -85,12 +90,20 @@ public class ClassSourceBuilder implements AutoCloseable {
 
     public void registerMethods(NodeCache<String> strings, NodeCache<String> classes, String nativeMethods, List<HiddenCppMethod> hiddenMethods) throws IOException {
         cppWriter.append("    void __ngen_register_methods(JNIEnv *env, jclass clazz) {\n");
-        cppWriter.append("        string_pool = string_pool::get_pool();\n\n");
-
-        for (Map.Entry<String, Integer> string : strings.getCache().entrySet()) {
-            cppWriter.append("        if (jstring str = env->NewStringUTF(").append(stringPool.get(string.getKey())).append(")) { if (jstring int_str = utils::get_interned(env, str)) { ")
-                    .append(String.format("cstrings[%d] = ", string.getValue()))
-                    .append("(jstring) env->NewGlobalRef(int_str); env->DeleteLocalRef(str); env->DeleteLocalRef(int_str); } }\n");
+        cppWriter.append("        string_pool = string_pool::get_pool();\n");
+        cppWriter.append(String.format("        string_section = string_pool::get_section(%d);\n", classIndex));
+
+        if (!strings.isEmpty()) {
+            // Indexed like cstrings
+            String[] ordered = new String[strings.size()];
+            strings.getCache().forEach((value, id) -> ordered[id] = value);
+            cppWriter.append("        const utils::pooled_string __ngen_strings[] = {\n");
+            for (String value : ordered) {
+                cppWriter.append("            ").append(stringPool.getTableEntry(value)).append(",\n");
+            }
+            cppWriter.append("        };\n");
+            cppWriter.append(String.format("        NATIVE_JVM_TRACE_ADD(strings, %d);\n", ordered.length));
+            cppWriter.append(String.format("        utils::resolve_strings(env, __ngen_strings, %d, cstrings);\n", ordered.length));
         }
 
         if (!classes.isEmpty()) {
@@ -101,6 +114,7 @@ public class ClassSourceBuilder implements AutoCloseable {
             cppWriter.append("        JNINativeMethod __ngen_methods[] = {\n");
             cppWriter.append(nativeMethods);
             cppWriter.append("        };\n\n");
+            cppWriter.append("        NATIVE_JVM_TRACE_ADD(natives, sizeof(__ngen_methods) / sizeof(__ngen_methods[0]));\n");
             cppWriter.append("        if (clazz) env->RegisterNatives(clazz, __ngen_methods, sizeof(__ngen_methods) / sizeof(__ngen_methods[0]));\n");
             cppWriter.append("        if (env->ExceptionCheck()) { fprintf(stderr, \"Exception occured while registering native_jvm for %s\\n\", ")
                     .append(stringPool.get(className.replace('/', '.')))
@@ -109,14 +123,15 @@ public class ClassSourceBuilder implements AutoCloseable {
         }
 
         if (!hiddenMethods.isEmpty()) {
-            HashMap<ClassNode, List<HiddenCppMethod>> sortedHiddenMethods = new HashMap<>();
+            Map<ClassNode, List<HiddenCppMethod>> sortedHiddenMethods = new LinkedHashMap<>();
             for (HiddenCppMethod method : hiddenMethods) {
                 sortedHiddenMethods.computeIfAbsent(method.getHiddenMethod().getClassNode(), unused -> new ArrayList<>()).add(method);
             }
 
             for (ClassNode hiddenClazz : sortedHiddenMethods.keySet()) {
                 cppWriter.append("        {\n");
-                cppWriter.append("            jclass hidden_class = env->FindClass(").append(stringPool.get(hiddenClazz.name)).append(");\n");
+                cppWriter.append(String.format("            jclass hidden_class = utils::define_hidden_class(env, %d);\n",
+                        sortedHiddenMethods.get(hiddenClazz).get(0).getHiddenMethod().getClassIndex()));
                 cppWriter.append("            JNINativeMethod __ngen_hidden_methods[] = {\n");
                 for (HiddenCppMethod method : sortedHiddenMethods.get(hiddenClazz)) {
                     cppWriter.append(String.format("                { %s, %s, (void *)&%s },\n",
@@ -125,6 +140,8 @@ public class ClassSourceBuilder implements AutoCloseable {
                             method.getCppName()));
                 }
                 cppWriter.append("            };\n");
+                cppWriter.append("            NATIVE_JVM_TRACE_ADD(lookups, 1);\n");
+                cppWriter.append("            NATIVE_JVM_TRACE_ADD(natives, sizeof(__ngen_hidden_methods) / sizeof(__ngen_hidden_methods[0]));\n");
                 cppWriter.append("            if (hidden_class) env->RegisterNatives(hidden_class, __ngen_hidden_methods, sizeof(__ngen_hidden_methods) / sizeof(__ngen_hidden_methods[0]));\n");
                 cppWriter.append("            if (env->ExceptionCheck()) { fprintf(stderr, \"Exception occured while registering native_jvm for %s\\n\", ")
                         .append(stringPool.get(hiddenClazz.name.replace('/', '.')))
@@ -6,10 +6,13 @@ public class MainSourceBuilder {
 
     private final StringBuilder includes;
     private final StringBuilder registerMethods;
+    private final StringBuilder hiddenClasses;
+    private int hiddenClassCount;
 
     public MainSourceBuilder() {
         includes = new StringBuilder();
         registerMethods = new StringBuilder();
+        hiddenClasses = new StringBuilder();
     }
 
     public void addHeader(String hppFilename) {
@@ -22,17 +25,27 @@ public class MainSourceBuilder {
                 classId, escapedClassName));
     }
 
-    public void registerDefine(String stringPooledClassName, String classFileName) {
-        registerMethods.append(String.format(
-                "        env->DeleteLocalRef(env->DefineClass(%s, nullptr, native_jvm::data::__ngen_%s::get_class_data(), native_jvm::data::__ngen_%s::get_class_data_length()));\n",
-                stringPooledClassName,
-                classFileName,
-                classFileName
-        ));
+    /**
+     * Lists the hidden class of class {@code index}; indexes without one are
+     * left empty, so hidden classes must be registered in increasing order.
+     */
+    public void registerHiddenClass(int index, String classFileName) {
+        for (; hiddenClassCount < index; hiddenClassCount++) {
+            hiddenClasses.append("                { nullptr, 0, 0ULL },\n");
+        }
+        hiddenClasses.append(String.format("                native_jvm::data::__ngen_%s::get_class_data(),\n", classFileName));
+        hiddenClassCount++;
     }
 
     public String build(String nativeDir, int classCount) {
         String template = Util.readResource("sources/native_jvm_output.cpp");
+        if (hiddenClassCount > 0) {
+            // Hidden classes are only listed here; utils::define_hidden_class defines each on first use
+            registerMethods.append("            const utils::hidden_class_data hidden_classes[] = {\n")
+                    .append(hiddenClasses)
+                    .append("            };\n")
+                    .append(String.format("            utils::set_hidden_classes(hidden_classes, %d);\n", hiddenClassCount));
+        }
         return Util.dynamicFormat(template, Util.createMap(
                 "register_code", registerMethods,
                 "includes", includes,
@@ -1,12 +1,20 @@
 package by.radioegor146.source;
 
+import by.radioegor146.RandomSource;
 import by.radioegor146.Util;
 
 import java.security.SecureRandom;
 import java.util.*;
 import java.util.stream.Collectors;
 import java.util.stream.IntStream;
+import java.util.stream.Stream;
 
+/**
+ * Encrypted string constants of the generated library. Strings are laid out in
+ * one section per class, and the generated code addresses them relative to
+ * its section, so the C++ of a class does not change when strings are added
+ * to or removed from another one.
+ */
 public class StringPool {
 
     private static class Entry {
@@ -15,47 +23,106 @@ public class StringPool {
         byte[] key;
         byte[] nonce;
         int seed;
+        boolean utf16;
 
-        Entry(long offset, int length, byte[] key, byte[] nonce, int seed) {
+        Entry(long offset, int length, byte[] key, byte[] nonce, int seed, boolean utf16) {
             this.offset = offset;
             this.length = length;
             this.key = key;
             this.nonce = nonce;
             this.seed = seed;
+            this.utf16 = utf16;
         }
     }
 
-    private long length;
-    private final Map<String, Entry> pool;
+    private static class Section {
+        long length;
+        final Map<String, Entry> pool = new LinkedHashMap<>();
+        final Map<String, Entry> utf16Pool = new LinkedHashMap<>();
+    }
+
+    private final SortedMap<Integer, Section> sections;
+    private int currentSection;
+    private Map<String, Entry> pool;
+    private Map<String, Entry> utf16Pool;
 
     private final SecureRandom random;
+    private Long seed;
 
     public StringPool() {
-        this.length = 0;
-        this.pool = new HashMap<>();
+        this.sections = new TreeMap<>();
         this.random = new SecureRandom();
+        beginSection(0);
+    }
+
+    /**
+     * Adds the following strings to the section of class {@code index}. A
+     * string used by several classes is stored once per section.
+     */
+    public void beginSection(int index) {
+        currentSection = index;
+        Section section = sections.computeIfAbsent(index, unused -> new Section());
+        pool = section.pool;
+        utf16Pool = section.utf16Pool;
+    }
+
+    /**
+     * Derives key material from the given build seed and the string itself
+     * instead of {@link SecureRandom}, so a string always encrypts the same way.
+     */
+    public void setSeed(Long seed) {
+        this.seed = seed;
     }
 
     public String get(String value) {
-        Entry entry = pool.get(value);
-        if (entry == null) {
-            byte[] bytes = getModifiedUtf8Bytes(value);
-            byte[] key = new byte[32];
-            byte[] nonce = new byte[12];
-            random.nextBytes(key);
-            random.nextBytes(nonce);
-            int seed = random.nextInt();
-            entry = new Entry(length, bytes.length + 1, key, nonce, seed);
-            pool.put(value, entry);
-            length += entry.length;
-        }
+        Entry entry = getEntry(value, false);
         return String.format(
-                "(string_pool::decrypt_string(string_pool::decode_key(%s, %d), string_pool::decode_nonce(%s, %d), %d, %dLL, %d), (char *)(string_pool + %dLL))",
+                "(string_pool::decrypt_string(string_pool::decode_key(%s, %d), string_pool::decode_nonce(%s, %d), %d, string_section + %dLL, %d), (char *)(string_pool + string_section + %dLL))",
                 formatArray(entry.key, entry.seed), entry.seed,
                 formatArray(entry.nonce, entry.seed), entry.seed,
                 entry.seed, entry.offset, entry.length, entry.offset);
     }
 
+    /**
+     * @return initializer of a {@code utils::pooled_string} for {@code value},
+     * resolved in bulk by {@code utils::resolve_strings}. The entry is stored as
+     * null-terminated UTF-16LE, separately from {@link #get(String)}, so the
+     * runtime can pass it to {@code NewString} without a modified UTF-8 decode
+     */
+    public String getTableEntry(String value) {
+        Entry entry = getEntry(value, true);
+        return String.format("{ %s, %s, %dU, %dU, %dLL, %d }",
+                formatArray(entry.key, entry.seed), formatArray(entry.nonce, entry.seed),
+                Integer.toUnsignedLong(entry.seed), currentSection, entry.offset, entry.length);
+    }
+
+    private Entry getEntry(String value, boolean utf16) {
+        Map<String, Entry> entries = utf16 ? utf16Pool : pool;
+        Entry entry = entries.get(value);
+        if (entry == null) {
+            byte[] bytes = getPlainBytes(value, utf16);
+            byte[] key = new byte[32];
+            byte[] nonce = new byte[12];
+            int seed;
+            if (this.seed != null) {
+                byte[] material = new byte[key.length + nonce.length + Integer.BYTES];
+                RandomSource.deriveBytes(this.seed, utf16 ? "utf16:" + value : value, material);
+                System.arraycopy(material, 0, key, 0, key.length);
+                System.arraycopy(material, key.length, nonce, 0, nonce.length);
+                seed = Util.byteArrayToInt(Arrays.copyOfRange(material, key.length + nonce.length, material.length));
+            } else {
+                random.nextBytes(key);
+                random.nextBytes(nonce);
+                seed = random.nextInt();
+            }
+            Section section = sections.get(currentSection);
+            entry = new Entry(section.length, bytes.length, key, nonce, seed, utf16);
+            entries.put(value, entry);
+            section.length += entry.length;
+        }
+        return entry;
+    }
+
     public long getOffset(String value) {
         return pool.get(value).offset;
     }
@@ -64,6 +131,27 @@ public class StringPool {
         return pool.get(value).length;
     }
 
+    public long getTotalLength() {
+        return sections.values().stream().mapToLong(section -> section.length).sum();
+    }
+
+    public int getStringCount() {
+        return sections.values().stream().mapToInt(section -> section.pool.size() + section.utf16Pool.size()).sum();
+    }
+
+    private static byte[] getPlainBytes(String value, boolean utf16) {
+        if (!utf16) {
+            byte[] bytes = getModifiedUtf8Bytes(value);
+            return Arrays.copyOf(bytes, bytes.length + 1);
+        }
+        byte[] bytes = new byte[(value.length() + 1) * 2];
+        for (int i = 0; i < value.length(); i++) {
+            bytes[i * 2] = (byte) value.charAt(i);
+            bytes[i * 2 + 1] = (byte) (value.charAt(i) >>> 8);
+        }
+        return bytes;
+    }
+
     private static byte[] getModifiedUtf8Bytes(String str) {
         int strlen = str.length();
         int utflen = 0;
@@ -113,18 +201,24 @@ public class StringPool {
 
     public String build() {
         List<Byte> encryptedBytes = new ArrayList<>();
-        pool.entrySet().stream()
-                .sorted(Comparator.comparingLong(e -> e.getValue().offset))
-                .forEach(e -> {
-                    String string = e.getKey();
-                    Entry entry = e.getValue();
-                    byte[] bytes = getModifiedUtf8Bytes(string);
-                    byte[] plain = Arrays.copyOf(bytes, bytes.length + 1);
-                    byte[] encrypted = ChaCha20.crypt(entry.key, entry.nonce, 0, plain);
-                    for (byte b : encrypted) {
-                        encryptedBytes.add(b);
-                    }
-                });
+        // Start of every section up to the last one, including unused indexes
+        long[] bases = new long[sections.lastKey() + 1];
+        int next = 0;
+        for (Map.Entry<Integer, Section> section : sections.entrySet()) {
+            while (next <= section.getKey()) {
+                bases[next++] = encryptedBytes.size();
+            }
+            Stream.concat(section.getValue().pool.entrySet().stream(), section.getValue().utf16Pool.entrySet().stream())
+                    .sorted(Comparator.comparingLong(e -> e.getValue().offset))
+                    .forEach(e -> {
+                        Entry entry = e.getValue();
+                        byte[] plain = getPlainBytes(e.getKey(), entry.utf16);
+                        byte[] encrypted = ChaCha20.crypt(entry.key, entry.nonce, 0, plain);
+                        for (byte b : encrypted) {
+                            encryptedBytes.add(b);
+                        }
+                    });
+        }
 
         byte[] encrypted = new byte[encryptedBytes.size()];
         for (int i = 0; i < encryptedBytes.size(); i++) {
@@ -139,7 +233,9 @@ public class StringPool {
         String template = Util.readResource("sources/string_pool.cpp");
         return Util.dynamicFormat(template, Util.createMap(
                 "size", Math.max(1, encrypted.length) + "LL",
-                "value", poolArray
+                "value", poolArray,
+                "section_count", bases.length,
+                "sections", Arrays.stream(bases).mapToObj(base -> base + "U").collect(Collectors.joining(", "))
         ));
     }
 
@@ -15,11 +15,12 @@ public class ClInitSpecialMethodProcessor implements SpecialMethodProcessor {
         // redirection on newer JVMs (e.g., enum classes and synthetic switch-map holders).
         if (shouldKeepOriginalClinit(context)) {
             context.skipNative = true;
+            context.fallbackReason = "fragile <clinit> kept in bytecode";
             return null;
         }
         String name = String.format("special_clinit_%d_%d", context.classIndex, context.methodIndex);
 
-        context.proxyMethod = context.obfuscator.getHiddenMethodsPool().getMethod(name, "(Ljava/lang/Class;)V", methodNode -> {
+        context.proxyMethod = context.obfuscator.getHiddenMethodsPool().getMethod(context.classIndex, name, "(Ljava/lang/Class;)V", methodNode -> {
             methodNode.signature = context.method.signature;
             methodNode.access = Opcodes.ACC_NATIVE | Opcodes.ACC_PUBLIC | Opcodes.ACC_STATIC | Opcodes.ACC_SYNTHETIC | Opcodes.ACC_BRIDGE;
             methodNode.visibleAnnotations = new ArrayList<>();
@@ -22,7 +22,7 @@ public class DefaultSpecialMethodProcessor implements SpecialMethodProcessor {
 
             String methodName = String.format("interfacestatic_%d_%d", context.classIndex, context.methodIndex);
             context.proxyMethod = context.obfuscator.getHiddenMethodsPool()
-                    .getMethod(methodName, resultDesc, methodNode -> {
+                    .getMethod(context.classIndex, methodName, resultDesc, methodNode -> {
                         methodNode.signature = context.method.signature;
                         methodNode.access = Opcodes.ACC_NATIVE | Opcodes.ACC_PUBLIC | Opcodes.ACC_STATIC | Opcodes.ACC_SYNTHETIC | Opcodes.ACC_BRIDGE;
                         methodNode.visibleAnnotations = new ArrayList<>();
@@ -1,6 +1,7 @@
 package by.radioegor146.ui;
 
 import by.radioegor146.NativeObfuscator;
+import by.radioegor146.ObfuscationReport;
 import by.radioegor146.Platform;
 import by.radioegor146.javaobf.JavaObfuscationConfig;
 
@@ -40,6 +41,7 @@ public class ObfuscatorFrame extends JFrame {
     private static final String CARD_SETTINGS = "settings";
     private static final String CARD_JAVA_OBF = "java_obf";
     private static final String CARD_RUN = "run";
+    private static final String CARD_REPORT = "report";
 
     // Shared controls (across cards)
     private final JTextField jarField = new JTextField();
@@ -68,6 +70,8 @@ public class ObfuscatorFrame extends JFrame {
     private final JButton runButton = new JButton("▶ Run Obfuscation");
     private final JTextArea logArea = new JTextArea();
     private final JProgressBar progressBar = new JProgressBar();
+    private final ReportTableModel reportModel = new ReportTableModel();
+    private final JLabel reportSummary = new JLabel("Run an obfuscation to see per-method costs.");
 
     private final JList<String> leftNav;
     private final JPanel rightCards;
@@ -114,6 +118,7 @@ public class ObfuscatorFrame extends JFrame {
         rightCards.add(buildSettingsCard(), CARD_SETTINGS);
         rightCards.add(buildJavaObfCard(), CARD_JAVA_OBF);
         rightCards.add(buildRunCard(), CARD_RUN);
+        rightCards.add(buildReportCard(), CARD_REPORT);
         rightCards.setMinimumSize(new Dimension(520, 400));
 
         // Layout using JSplitPane for resize friendliness
@@ -207,6 +212,7 @@ public class ObfuscatorFrame extends JFrame {
         model.addElement("⚙️ Native Settings");
         model.addElement("☕ Java Obfuscation");
         model.addElement("🚀 Run & Logs");
+        model.addElement("📊 Report");
 
         final JList<String> list = new JList<>(model);
         list.setSelectionMode(ListSelectionModel.SINGLE_SELECTION);
@@ -221,6 +227,7 @@ public class ObfuscatorFrame extends JFrame {
                     case 1: showCard(CARD_SETTINGS); break;
                     case 2: showCard(CARD_JAVA_OBF); break;
                     case 3: showCard(CARD_RUN); break;
+                    case 4: showCard(CARD_REPORT); break;
                     default: break;
                 }
             }
@@ -514,6 +521,35 @@ public class ObfuscatorFrame extends JFrame {
         return card;
     }
 
+    private JPanel buildReportCard() {
+        JPanel card = new JPanel(new BorderLayout());
+        card.setBorder(new EmptyBorder(4, 0, 0, 0));
+
+        reportSummary.setBorder(new EmptyBorder(4, 4, 8, 4));
+
+        JTable table = new JTable(reportModel);
+        table.setAutoCreateRowSorter(true);
+        table.setFillsViewportHeight(true);
+        JScrollPane tableScroll = new JScrollPane(table);
+        tableScroll.setBorder(new TitledBorder("📊 Per-method cost (click a column to sort)"));
+
+        card.add(reportSummary, BorderLayout.NORTH);
+        card.add(tableScroll, BorderLayout.CENTER);
+        return card;
+    }
+
+    private void showReport(ObfuscationReport report) {
+        reportModel.setReport(report);
+        if (report == null) {
+            reportSummary.setText("No report: native obfuscation was disabled.");
+            return;
+        }
+        reportSummary.setText(String.format("%d classes · %d native · %d virtualized · %d skipped · ~%d JNI calls · %d bytes C++ · %d bytes strings",
+                report.getClasses(), report.count(ObfuscationReport.Mode.NATIVE),
+                report.count(ObfuscationReport.Mode.VIRTUALIZED), report.count(ObfuscationReport.Mode.SKIPPED),
+                report.getJniCalls(), report.getCppBytes(), report.getStringPoolBytes()));
+    }
+
     // ------------------------ Row Builders with alignment ------------------------
 
     private JPanel createPathRowPanel(String labelText, JTextField field, final Runnable browseAction, String hintText) {
@@ -784,6 +820,8 @@ public class ObfuscatorFrame extends JFrame {
         appendLog("🚀 Starting obfuscation...\n");
 
         SwingWorker<Integer, String> worker = new SwingWorker<Integer, String>() {
+            private ObfuscationReport report;
+
             @Override protected Integer doInBackground() throws Exception {
                 List<Path> libs = new ArrayList<Path>();
                 String libsDir = libsDirField.getText().trim();
@@ -855,6 +893,10 @@ public class ObfuscatorFrame extends JFrame {
                         enableVirtualization, enableJit, flattenControlFlow,
                         enableJavaObfuscation, javaObfStrength,
                         javaBlackList, javaWhiteList, enableNativeObfuscation);
+                if (enableNativeObfuscation) {
+                    report = obfuscator.getReport();
+                    publish("📊 Report written to " + dir.resolve(ObfuscationReport.FILE_NAME));
+                }
 
                 if (enableNativeObfuscation && plainName == null && packageBox.isSelected()) {
                     Path cppDir = Paths.get(outDir, "cpp");
@@ -876,6 +918,7 @@ public class ObfuscatorFrame extends JFrame {
             @Override protected void done() {
                 try {
                     get();
+                    showReport(report);
                     appendLog("✅ Done. Output at: " + outDir + "\n");
                     JOptionPane.showMessageDialog(ObfuscatorFrame.this, "✅ Obfuscation completed successfully!", "✨ Success", JOptionPane.INFORMATION_MESSAGE);
                 } catch (ExecutionException ex) {
@@ -1001,6 +1044,9 @@ public class ObfuscatorFrame extends JFrame {
         java.net.URI uri = java.net.URI.create("jar:" + jarPath.toUri());
         java.util.Map<String, String> env = new java.util.HashMap<>();
         env.put("create", "false");
+        // Stored, so the loader reads the library without inflating it
+        env.put("noCompression", "true");
+        env.put("compressionMethod", "STORED");
         try (java.nio.file.FileSystem fs = java.nio.file.FileSystems.newFileSystem(uri, env)) {
             Path inside = fs.getPath("/" + entryPath);
             if (inside.getParent() != null) Files.createDirectories(inside.getParent());
@@ -0,0 +1,69 @@
+package by.radioegor146.ui;
+
+import by.radioegor146.ObfuscationReport;
+
+import javax.swing.table.AbstractTableModel;
+import java.util.ArrayList;
+import java.util.List;
+import java.util.Locale;
+
+/**
+ * Table model over {@link ObfuscationReport} method entries. Column classes are
+ * numeric where it matters so the row sorter orders them by value.
+ */
+public class ReportTableModel extends AbstractTableModel {
+
+    private static final String[] COLUMNS = {
+            "Class", "Method", "Mode", "Flattened", "Instructions", "JNI calls", "JNI / insn", "C++ bytes", "Functions",
+            "Fallback"
+    };
+    private static final Class<?>[] TYPES = {
+            String.class, String.class, String.class, Boolean.class, Integer.class, Integer.class, Double.class,
+            Integer.class, Integer.class, String.class
+    };
+
+    private List<ObfuscationReport.MethodEntry> rows = new ArrayList<>();
+
+    public void setReport(ObfuscationReport report) {
+        rows = report == null ? new ArrayList<>() : new ArrayList<>(report.getMethods());
+        fireTableDataChanged();
+    }
+
+    @Override
+    public int getRowCount() {
+        return rows.size();
+    }
+
+    @Override
+    public int getColumnCount() {
+        return COLUMNS.length;
+    }
+
+    @Override
+    public String getColumnName(int column) {
+        return COLUMNS[column];
+    }
+
+    @Override
+    public Class<?> getColumnClass(int column) {
+        return TYPES[column];
+    }
+
+    @Override
+    public Object getValueAt(int row, int column) {
+        ObfuscationReport.MethodEntry entry = rows.get(row);
+        switch (column) {
+            case 0: return entry.getClassName();
+            case 1: return entry.getMethodName() + entry.getDesc();
+            case 2: return entry.getMode().name().toLowerCase(Locale.ROOT);
+            case 3: return entry.isFlattened();
+            case 4: return entry.getInstructions();
+            case 5: return entry.getJniCalls();
+            case 6: return Math.round(entry.getJniPerBytecode() * 1000) / 1000.0;
+            case 7: return entry.getCppBytes();
+            case 8: return entry.getFunctions();
+            case 9: return entry.getFallbackReason() == null ? "" : entry.getFallbackReason();
+            default: return null;
+        }
+    }
+}
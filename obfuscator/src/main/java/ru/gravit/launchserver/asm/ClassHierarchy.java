@@ -0,0 +1,213 @@
+package ru.gravit.launchserver.asm;
+
+import java.io.IOException;
+import java.util.Arrays;
+import java.util.HashMap;
+import java.util.HashSet;
+import java.util.Map;
+import java.util.Set;
+import java.util.concurrent.ConcurrentHashMap;
+import org.objectweb.asm.ClassReader;
+
+/**
+ * Class hierarchy index shared by all class writers of one run. Each class
+ * header is read from the class path at most once and stored as integer ids
+ * (super class, interfaces, access flags); common super class queries are
+ * memoised per unordered pair. Safe for concurrent use.
+ */
+public class ClassHierarchy {
+
+    private static final String OBJECT = "java/lang/Object";
+    private static final int NONE = -1;
+    private static final int[] NO_INTERFACES = new int[0];
+
+    /**
+     * Column storage. A slot is fully written before its id is published in
+     * {@link #ids}, and growth copies into a new table, so readers that got an
+     * id from {@link #ids} never need the lock.
+     */
+    private static final class Table {
+        final String[] names;
+        final int[] superIds;
+        final int[] access;
+        final int[][] interfaces;
+
+        Table(int capacity) {
+            names = new String[capacity];
+            superIds = new int[capacity];
+            access = new int[capacity];
+            interfaces = new int[capacity][];
+        }
+
+        Table grow() {
+            Table table = new Table(names.length * 2);
+            System.arraycopy(names, 0, table.names, 0, names.length);
+            System.arraycopy(superIds, 0, table.superIds, 0, superIds.length);
+            System.arraycopy(access, 0, table.access, 0, access.length);
+            System.arraycopy(interfaces, 0, table.interfaces, 0, interfaces.length);
+            return table;
+        }
+    }
+
+    private final ClassMetadataReader reader;
+    private final Map<String, Integer> ids = new ConcurrentHashMap<>();
+    private final Map<Long, String> commonSuperClasses = new ConcurrentHashMap<>();
+
+    // Guarded by lock
+    private final Map<String, Integer> slots = new HashMap<>();
+    private final Set<String> resolving = new HashSet<>();
+    private final Object lock = new Object();
+    private volatile Table table = new Table(256);
+
+    public ClassHierarchy(ClassMetadataReader reader) {
+        this.reader = reader;
+    }
+
+    /**
+     * @return the index of {@code type}, reading its header on first use
+     */
+    public int getId(String type) {
+        Integer id = ids.get(type);
+        if (id != null) {
+            return id;
+        }
+        synchronized (lock) {
+            return resolve(type);
+        }
+    }
+
+    private int resolve(String type) {
+        Integer published = ids.get(type);
+        if (published != null) {
+            return published;
+        }
+        int id = slot(type);
+        if (!resolving.add(type)) {
+            // Cyclic hierarchy in broken input: cut the chain here
+            return id;
+        }
+        int superId = NONE;
+        int access = 0;
+        int[] interfaces = NO_INTERFACES;
+        if (!type.equals(OBJECT)) {
+            String superName = OBJECT;
+            try {
+                ClassReader classReader = new ClassReader(reader.getClassData(type));
+                access = classReader.getAccess();
+                if (classReader.getSuperName() != null) {
+                    superName = classReader.getSuperName();
+                }
+                String[] names = classReader.getInterfaces();
+                if (names.length > 0) {
+                    interfaces = new int[names.length];
+                    for (int i = 0; i < names.length; i++) {
+                        interfaces[i] = slot(names[i]);
+                    }
+                }
+            } catch (IOException | ClassNotFoundException ignored) {
+                // Types missing from the class path are treated as direct Object subclasses
+            }
+            superId = resolve(superName);
+        }
+        Table current = table;
+        current.superIds[id] = superId;
+        current.access[id] = access;
+        current.interfaces[id] = interfaces;
+        resolving.remove(type);
+        ids.put(type, id);
+        return id;
+    }
+
+    /**
+     * Allocates the slot for {@code type} without reading it. Interface slots
+     * are filled in lazily when first queried.
+     */
+    private int slot(String type) {
+        Integer id = slots.get(type);
+        if (id != null) {
+            return id;
+        }
+        id = slots.size();
+        Table current = table;
+        if (id == current.names.length) {
+            current = current.grow();
+        }
+        current.names[id] = type;
+        current.superIds[id] = NONE;
+        table = current;
+        slots.put(type, id);
+        return id;
+    }
+
+    public String getName(int id) {
+        return table.names[id];
+    }
+
+    // Resolving a type may grow the table, so the ids below are resolved
+    // before the table is read
+
+    /**
+     * @return the super class id, or {@code -1} for {@code java/lang/Object}
+     */
+    public int getSuperId(int id) {
+        int resolved = getId(getName(id));
+        return table.superIds[resolved];
+    }
+
+    public int getAccess(int id) {
+        int resolved = getId(getName(id));
+        return table.access[resolved];
+    }
+
+    public int[] getInterfaceIds(int id) {
+        int resolved = getId(getName(id));
+        return table.interfaces[resolved].clone();
+    }
+
+    public String getSuperClass(String type) {
+        int resolved = getId(type);
+        int superId = table.superIds[resolved];
+        return superId == NONE ? null : getName(superId);
+    }
+
+    /**
+     * Deepest common class in the super class chains of both types, as
+     * expected by {@link org.objectweb.asm.ClassWriter#getCommonSuperClass}.
+     */
+    public String getCommonSuperClass(String type1, String type2) {
+        int id1 = getId(type1);
+        int id2 = getId(type2);
+        if (id1 == id2) {
+            return type1;
+        }
+        long key = id1 < id2 ? ((long) id1 << 32) | id2 : ((long) id2 << 32) | id1;
+        String cached = commonSuperClasses.get(key);
+        if (cached != null) {
+            return cached;
+        }
+        String result = computeCommonSuperClass(id1, id2);
+        commonSuperClasses.putIfAbsent(key, result);
+        return result;
+    }
+
+    private String computeCommonSuperClass(int id1, int id2) {
+        Table current = table;
+        int depth = 0;
+        int[] chain = new int[16];
+        for (int id = id1; id != NONE && depth <= current.names.length; id = current.superIds[id]) {
+            if (depth == chain.length) {
+                chain = Arrays.copyOf(chain, depth * 2);
+            }
+            chain[depth++] = id;
+        }
+        int steps = 0;
+        for (int id = id2; id != NONE && steps++ <= current.names.length; id = current.superIds[id]) {
+            for (int i = 0; i < depth; i++) {
+                if (chain[i] == id) {
+                    return current.names[id];
+                }
+            }
+        }
+        return OBJECT;
+    }
+}
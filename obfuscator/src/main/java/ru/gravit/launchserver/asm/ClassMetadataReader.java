@@ -29,11 +29,19 @@ public class ClassMetadataReader {
     }
 
     private final List<JarFile> classPath;
+    private final ClassHierarchy hierarchy = new ClassHierarchy(this);
 
     public ClassMetadataReader(List<JarFile> classPath) {
         this.classPath = classPath;
     }
 
+    /**
+     * @return the memoised hierarchy index over this class path
+     */
+    public ClassHierarchy getHierarchy() {
+        return hierarchy;
+    }
+
     public List<JarFile> getCp() {
         return Collections.unmodifiableList(classPath);
     }
@@ -73,14 +81,7 @@ public class ClassMetadataReader {
     }
 
     public String getSuperClass(String type) {
-        if (type.equals("java/lang/Object")) {
-            return null;
-        }
-        try {
-            return getSuperClassASM(type);
-        } catch (IOException | ClassNotFoundException e) {
-            return "java/lang/Object";
-        }
+        return hierarchy.getSuperClass(type);
     }
 
     protected String getSuperClassASM(String type) throws IOException, ClassNotFoundException {
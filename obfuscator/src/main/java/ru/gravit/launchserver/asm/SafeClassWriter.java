@@ -1,6 +1,5 @@
 package ru.gravit.launchserver.asm;
 
-import java.util.ArrayList;
 import org.objectweb.asm.ClassReader;
 import org.objectweb.asm.ClassWriter;
 
@@ -20,18 +19,7 @@ public class SafeClassWriter extends ClassWriter {
 
     @Override
     protected String getCommonSuperClass(String type1, String type2) {
-        ArrayList<String> superClasses1 = classMetadataReader.getSuperClasses(type1);
-        ArrayList<String> superClasses2 = classMetadataReader.getSuperClasses(type2);
-        int size = Math.min(superClasses1.size(), superClasses2.size());
-        int i = 0;
-        while (i < size && superClasses1.get(i).equals(superClasses2.get(i))) {
-            i++;
-        }
-        if (i == 0) {
-            return "java/lang/Object";
-        } else {
-            return superClasses1.get(i - 1);
-        }
+        return classMetadataReader.getHierarchy().getCommonSuperClass(type1, type2);
     }
 
 }
@@ -10,6 +10,7 @@
 #include <string>
 #include <cstring>
 #include <cmath>
+#include <memory>
 
 // NOLINTBEGIN - obfuscated control flow by design
 namespace native_jvm::vm {
@@ -24,9 +25,34 @@ static thread_local std::unordered_map<const Instruction*, JitCompiled> jit_cach
 static thread_local std::unordered_map<const Instruction*, size_t> exec_counts{};
 static constexpr size_t HOT_THRESHOLD = 10;
 
+// The interpreter decodes the program a window of NATIVE_JVM_VM_WINDOW
+// instructions at a time into a scratch buffer on its own stack. The window
+// is wiped and decoded again when control leaves it, or after it has served
+// NATIVE_JVM_VM_WINDOW_USES dispatches, which bounds how long plaintext lives.
+#ifndef NATIVE_JVM_VM_WINDOW
+#define NATIVE_JVM_VM_WINDOW 32
+#endif
+#ifndef NATIVE_JVM_VM_WINDOW_USES
+#define NATIVE_JVM_VM_WINDOW_USES 4096
+#endif
+static_assert(NATIVE_JVM_VM_WINDOW > 0, "NATIVE_JVM_VM_WINDOW must be positive");
+
+// Decode state at the start of each window of a program, so a window can be
+// decoded wherever a branch lands. Rebuilt when the program is re-keyed.
+// Programs that fit in one window, like run_arith_vm's, need no entry.
+struct WindowStates {
+    uint64_t key;
+    uint64_t seed;
+    size_t length;
+    std::vector<uint64_t> starts;
+};
+static thread_local std::unordered_map<const Instruction*, WindowStates> window_states{};
+
 static thread_local std::unordered_map<std::string, jweak> class_cache{};
 static thread_local size_t class_lookup_calls = 0;
 
+static void forget_method_shapes();
+
 static jclass get_cached_class(JNIEnv* env, const char* name) {
     auto it = class_cache.find(name);
     if (it != class_cache.end()) {
@@ -36,6 +62,7 @@ static jclass get_cached_class(JNIEnv* env, const char* name) {
         }
         env->DeleteWeakGlobalRef(it->second);
         class_cache.erase(it);
+        forget_method_shapes();
     }
     jclass clazz = env->FindClass(name);
     ++class_lookup_calls;
@@ -52,13 +79,14 @@ void clear_class_cache(JNIEnv* env) {
     }
     class_cache.clear();
     class_lookup_calls = 0;
+    forget_method_shapes();
 }
 
 size_t get_class_cache_calls() {
     return class_lookup_calls;
 }
 
-static void parse_method_sig(const char* sig, std::vector<char>& args, char& ret) {
+static void parse_method_sig(const char* sig, std::string& args, char& ret) {
     args.clear();
     const char* p = sig;
     if (*p == '(') ++p;
@@ -85,6 +113,117 @@ static void parse_method_sig(const char* sig, std::vector<char>& args, char& ret
     ret = *p;
 }
 
+// Parsed signature shape and resolved method id for a MethodRef.  Entries are
+// keyed by the string pool pointers of the reference, which stay stable for
+// the lifetime of the library, so steady-state calls skip both the signature
+// walk and GetMethodID.
+struct MethodShape {
+    std::string arg_types;
+    char ret = 'V';
+    jmethodID mid = nullptr;
+};
+
+struct MethodShapeKey {
+    const char* class_name;
+    const char* method_name;
+    const char* method_sig;
+    bool is_static;
+
+    bool operator==(const MethodShapeKey& other) const {
+        return class_name == other.class_name && method_name == other.method_name &&
+               method_sig == other.method_sig && is_static == other.is_static;
+    }
+};
+
+struct MethodShapeKeyHash {
+    size_t operator()(const MethodShapeKey& key) const {
+        size_t h = std::hash<const void*>{}(key.class_name);
+        h = h * 31 + std::hash<const void*>{}(key.method_name);
+        h = h * 31 + std::hash<const void*>{}(key.method_sig);
+        return h * 2 + (key.is_static ? 1 : 0);
+    }
+};
+
+static thread_local std::unordered_map<MethodShapeKey, MethodShape, MethodShapeKeyHash> method_shapes{};
+
+// Method ids die with their class, so drop them whenever a cached class is
+// found unloaded or the cache is cleared.
+static void forget_method_shapes() {
+    method_shapes.clear();
+}
+
+// Per-thread bump allocator for call scratch data.  Each invoke_method opens
+// an ArenaScope that hands out jvalue slots and rewinds on exit, so nested
+// calls (VM -> Java -> VM) stack naturally and no heap allocation happens
+// unless a single frame needs more than ARENA_SLOTS arguments.
+static constexpr size_t ARENA_SLOTS = 1024;
+
+struct ArgArena {
+    std::array<jvalue, ARENA_SLOTS> slots;
+    size_t top = 0;
+};
+
+static thread_local ArgArena arg_arena{};
+
+class ArenaScope {
+public:
+    ArenaScope() : mark(arg_arena.top) {}
+    ~ArenaScope() { arg_arena.top = mark; }
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+
+    jvalue* alloc(size_t count) {
+        if (count == 0) return nullptr;
+        if (ARENA_SLOTS - arg_arena.top >= count) {
+            jvalue* result = arg_arena.slots.data() + arg_arena.top;
+            arg_arena.top += count;
+            return result;
+        }
+        overflow.reset(new jvalue[count]);
+        return overflow.get();
+    }
+
+private:
+    size_t mark;
+    std::unique_ptr<jvalue[]> overflow;
+};
+
+// Decode state saved lazily by init_key when it runs underneath an outgoing
+// call.  Most callees never re-enter the VM, so invoke_method only pays for a
+// snapshot when a nested virtualized method actually replaces the key.
+struct VmStateSnapshot {
+    size_t depth;
+    uint64_t KEY;
+    std::array<uint8_t, OP_COUNT> op_map;
+    std::array<uint8_t, OP_COUNT> op_map2;
+    std::array<uint8_t, OP_COUNT> inv_op_map2;
+    std::array<OpCode, OP_COUNT> inv_op_map;
+    bool vm_state_initialized;
+};
+
+static thread_local size_t invoke_depth = 0;
+static thread_local std::vector<VmStateSnapshot> saved_states{};
+
+static void save_state_for_nested_call() {
+    if (invoke_depth == 0) return;
+    if (!saved_states.empty() && saved_states.back().depth == invoke_depth) return;
+    saved_states.push_back({invoke_depth, KEY, op_map, op_map2, inv_op_map2, inv_op_map, vm_state_initialized});
+}
+
+static void restore_state_after_call() {
+    if (!saved_states.empty() && saved_states.back().depth == invoke_depth) {
+        const VmStateSnapshot& snapshot = saved_states.back();
+        KEY = snapshot.KEY;
+        op_map = snapshot.op_map;
+        op_map2 = snapshot.op_map2;
+        inv_op_map2 = snapshot.inv_op_map2;
+        inv_op_map = snapshot.inv_op_map;
+        vm_state_initialized = snapshot.vm_state_initialized;
+        saved_states.pop_back();
+    }
+    --invoke_depth;
+}
+
 static void invoke_method(JNIEnv* env, OpCode op, MethodRef* ref,
                           int64_t* stack, size_t& sp) {
     if (!ref) {
@@ -98,15 +237,21 @@ static void invoke_method(JNIEnv* env, OpCode op, MethodRef* ref,
         env->ThrowNew(env->FindClass("java/lang/RuntimeException"), error_msg);
         return;
     }
-    std::vector<char> arg_types;
-    char ret;
-    parse_method_sig(ref->method_sig, arg_types, ret);
-    size_t num = arg_types.size();
-    if (sp < num + ((op == OP_INVOKESTATIC || op == OP_INVOKEDYNAMIC) ? 0 : 1)) {
+    bool is_static = op == OP_INVOKESTATIC || op == OP_INVOKEDYNAMIC;
+    const MethodShapeKey key{ref->class_name, ref->method_name, ref->method_sig, is_static};
+    MethodShape& shape = method_shapes[key];
+    if (!shape.mid) {
+        parse_method_sig(ref->method_sig, shape.arg_types, shape.ret);
+    }
+    const char* arg_types = shape.arg_types.data();
+    char ret = shape.ret;
+    size_t num = shape.arg_types.size();
+    if (sp < num + (is_static ? 0 : 1)) {
         sp = 0;
         return;
     }
-    std::vector<jvalue> jargs(num);
+    ArenaScope scratch;
+    jvalue* jargs = scratch.alloc(num);
     for (size_t i = 0; i < num; ++i) {
         char t = arg_types[num - 1 - i];
         switch (t) {
@@ -136,7 +281,7 @@ static void invoke_method(JNIEnv* env, OpCode op, MethodRef* ref,
         }
     }
     jobject obj = nullptr;
-    if (op != OP_INVOKESTATIC && op != OP_INVOKEDYNAMIC) {
+    if (!is_static) {
         obj = reinterpret_cast<jobject>(stack[--sp]);
         if (!obj) {
             env->ThrowNew(env->FindClass("java/lang/NullPointerException"), "null");
@@ -147,71 +292,70 @@ static void invoke_method(JNIEnv* env, OpCode op, MethodRef* ref,
     if (!clazz) {
         return;
     }
-    jmethodID mid;
-    if (op == OP_INVOKESTATIC || op == OP_INVOKEDYNAMIC) {
-        mid = env->GetStaticMethodID(clazz, ref->method_name, ref->method_sig);
-    } else {
-        mid = env->GetMethodID(clazz, ref->method_name, ref->method_sig);
-    }
+    // get_cached_class drops every shape when it finds a class unloaded, and
+    // FindClass may run initializers that re-enter the VM, so `shape` can be
+    // gone by now; only the locals copied from it above are still valid.
+    auto cached = method_shapes.find(key);
+    jmethodID mid = cached != method_shapes.end() ? cached->second.mid : nullptr;
     if (!mid) {
-        env->DeleteLocalRef(clazz);
-        return;
+        if (is_static) {
+            mid = env->GetStaticMethodID(clazz, ref->method_name, ref->method_sig);
+        } else {
+            mid = env->GetMethodID(clazz, ref->method_name, ref->method_sig);
+        }
+        if (!mid) {
+            env->DeleteLocalRef(clazz);
+            return;
+        }
+        if (cached == method_shapes.end()) {
+            cached = method_shapes.emplace(key, MethodShape{}).first;
+            parse_method_sig(ref->method_sig, cached->second.arg_types, cached->second.ret);
+        }
+        cached->second.mid = mid;
     }
-    // Save VM decode state to survive nested obfuscated calls that reinitialize it
-    struct VmStateSnapshot {
-        uint64_t KEY;
-        std::array<uint8_t, OP_COUNT> op_map;
-        std::array<uint8_t, OP_COUNT> op_map2;
-        std::array<uint8_t, OP_COUNT> inv_op_map2;
-        std::array<OpCode, OP_COUNT> inv_op_map;
-        bool vm_state_initialized;
-    } snapshot{};
-    snapshot.KEY = KEY;
-    snapshot.op_map = op_map;
-    snapshot.op_map2 = op_map2;
-    snapshot.inv_op_map2 = inv_op_map2;
-    snapshot.inv_op_map = inv_op_map;
-    snapshot.vm_state_initialized = vm_state_initialized;
+    // Nested obfuscated calls may reinitialize the decode state; init_key
+    // snapshots it for this depth and restore_state_after_call puts it back.
+    ++invoke_depth;
 
     switch (ret) {
         case 'V':
-            if (op == OP_INVOKESTATIC || op == OP_INVOKEDYNAMIC)
-                env->CallStaticVoidMethodA(clazz, mid, jargs.data());
+            if (is_static)
+                env->CallStaticVoidMethodA(clazz, mid, jargs);
             else if (op == OP_INVOKESPECIAL)
-                env->CallNonvirtualVoidMethodA(obj, clazz, mid, jargs.data());
+                env->CallNonvirtualVoidMethodA(obj, clazz, mid, jargs);
             else
-                env->CallVoidMethodA(obj, mid, jargs.data());
+                env->CallVoidMethodA(obj, mid, jargs);
             break;
         case 'Z': case 'B': case 'C': case 'S': case 'I': {
             jint r;
-            if (op == OP_INVOKESTATIC || op == OP_INVOKEDYNAMIC)
-                r = env->CallStaticIntMethodA(clazz, mid, jargs.data());
+            if (is_static)
+                r = env->CallStaticIntMethodA(clazz, mid, jargs);
             else if (op == OP_INVOKESPECIAL)
-                r = env->CallNonvirtualIntMethodA(obj, clazz, mid, jargs.data());
+                r = env->CallNonvirtualIntMethodA(obj, clazz, mid, jargs);
             else
-                r = env->CallIntMethodA(obj, mid, jargs.data());
+                r = env->CallIntMethodA(obj, mid, jargs);
             stack[sp++] = static_cast<int64_t>(r);
             break;
         }
         case 'J': {
             jlong r;
-            if (op == OP_INVOKESTATIC || op == OP_INVOKEDYNAMIC)
-                r = env->CallStaticLongMethodA(clazz, mid, jargs.data());
+            if (is_static)
+                r = env->CallStaticLongMethodA(clazz, mid, jargs);
             else if (op == OP_INVOKESPECIAL)
-                r = env->CallNonvirtualLongMethodA(obj, clazz, mid, jargs.data());
+                r = env->CallNonvirtualLongMethodA(obj, clazz, mid, jargs);
             else
-                r = env->CallLongMethodA(obj, mid, jargs.data());
+                r = env->CallLongMethodA(obj, mid, jargs);
             stack[sp++] = static_cast<int64_t>(r);
             break;
         }
         case 'F': {
             jfloat r;
-            if (op == OP_INVOKESTATIC || op == OP_INVOKEDYNAMIC)
-                r = env->CallStaticFloatMethodA(clazz, mid, jargs.data());
+            if (is_static)
+                r = env->CallStaticFloatMethodA(clazz, mid, jargs);
             else if (op == OP_INVOKESPECIAL)
-                r = env->CallNonvirtualFloatMethodA(obj, clazz, mid, jargs.data());
+                r = env->CallNonvirtualFloatMethodA(obj, clazz, mid, jargs);
             else
-                r = env->CallFloatMethodA(obj, mid, jargs.data());
+                r = env->CallFloatMethodA(obj, mid, jargs);
             int32_t bits;
             std::memcpy(&bits, &r, sizeof(float));
             stack[sp++] = static_cast<int64_t>(bits);
@@ -219,12 +363,12 @@ static void invoke_method(JNIEnv* env, OpCode op, MethodRef* ref,
         }
         case 'D': {
             jdouble r;
-            if (op == OP_INVOKESTATIC || op == OP_INVOKEDYNAMIC)
-                r = env->CallStaticDoubleMethodA(clazz, mid, jargs.data());
+            if (is_static)
+                r = env->CallStaticDoubleMethodA(clazz, mid, jargs);
             else if (op == OP_INVOKESPECIAL)
-                r = env->CallNonvirtualDoubleMethodA(obj, clazz, mid, jargs.data());
+                r = env->CallNonvirtualDoubleMethodA(obj, clazz, mid, jargs);
             else
-                r = env->CallDoubleMethodA(obj, mid, jargs.data());
+                r = env->CallDoubleMethodA(obj, mid, jargs);
             int64_t bits;
             std::memcpy(&bits, &r, sizeof(double));
             stack[sp++] = bits;
@@ -232,28 +376,23 @@ static void invoke_method(JNIEnv* env, OpCode op, MethodRef* ref,
         }
         default: {
             jobject r;
-            if (op == OP_INVOKESTATIC || op == OP_INVOKEDYNAMIC)
-                r = env->CallStaticObjectMethodA(clazz, mid, jargs.data());
+            if (is_static)
+                r = env->CallStaticObjectMethodA(clazz, mid, jargs);
             else if (op == OP_INVOKESPECIAL)
-                r = env->CallNonvirtualObjectMethodA(obj, clazz, mid, jargs.data());
+                r = env->CallNonvirtualObjectMethodA(obj, clazz, mid, jargs);
             else
-                r = env->CallObjectMethodA(obj, mid, jargs.data());
+                r = env->CallObjectMethodA(obj, mid, jargs);
             stack[sp++] = reinterpret_cast<int64_t>(r);
             break;
         }
     }
 
-    // Restore VM decode state after potential nested obfuscated calls
-    KEY = snapshot.KEY;
-    op_map = snapshot.op_map;
-    op_map2 = snapshot.op_map2;
-    inv_op_map2 = snapshot.inv_op_map2;
-    inv_op_map = snapshot.inv_op_map;
-    vm_state_initialized = snapshot.vm_state_initialized;
+    restore_state_after_call();
     env->DeleteLocalRef(clazz);
 }
 
-void init_key(uint64_t seed) {
+NATIVE_JVM_COLD void init_key(uint64_t seed) {
+    save_state_for_nested_call();
     std::random_device rd;
     std::mt19937_64 gen(rd() ^ seed);
     KEY = gen();
@@ -282,6 +421,21 @@ void ensure_init(uint64_t seed) {
     }
 }
 
+// state is the decode state of the instruction's pc, as evolved by encode_program
+static inline DecodedInstruction decode(const Instruction& ins, uint64_t state) {
+    if (ins.nonce == 0) {
+        // Plain instructions (not encrypted) - used by generated VM code
+        return {static_cast<OpCode>(ins.op), ins.operand};
+    }
+    // Encrypted instructions - normal path
+    uint64_t mix = state ^ ins.nonce;
+    // XOR promotes to int; cast back to uint8_t before converting to OpCode
+    uint8_t mapped = static_cast<uint8_t>(ins.op ^ static_cast<uint8_t>(mix));
+    mapped ^= static_cast<uint8_t>(ins.nonce);
+    mapped = inv_op_map2[mapped];
+    return {inv_op_map[mapped], ins.operand ^ static_cast<int64_t>(mix * 0x9E3779B97F4A7C15ULL)};
+}
+
 void decode_for_jit(const Instruction* code, size_t length, uint64_t seed,
                     std::vector<DecodedInstruction>& out) {
     ensure_init(seed);
@@ -290,26 +444,56 @@ void decode_for_jit(const Instruction* code, size_t length, uint64_t seed,
     uint64_t state = KEY ^ seed;
     for (size_t pc = 0; pc < length; ++pc) {
         state = (state + KEY) ^ (KEY >> 3);
-        OpCode op;
-        int64_t operand;
+        out.push_back(decode(code[pc], state));
+    }
+}
 
-        if (code[pc].nonce == 0) {
-            // Plain instructions (not encrypted) - used by generated VM code
-            op = static_cast<OpCode>(code[pc].op);
-            operand = code[pc].operand;
-        } else {
-            // Encrypted instructions - normal path
-            uint64_t mix = state ^ code[pc].nonce;
-            uint8_t mapped = static_cast<uint8_t>(code[pc].op ^ static_cast<uint8_t>(mix));
-            mapped ^= static_cast<uint8_t>(code[pc].nonce);
-            mapped = inv_op_map2[mapped];
-            op = inv_op_map[mapped];
-            operand = code[pc].operand ^ static_cast<int64_t>(mix * 0x9E3779B97F4A7C15ULL);
+static const uint64_t* get_window_states(const Instruction* code, size_t length, uint64_t seed) {
+    if (length <= NATIVE_JVM_VM_WINDOW) {
+        return nullptr;
+    }
+    WindowStates& states = window_states[code];
+    if (states.starts.empty() || states.key != KEY || states.seed != seed || states.length != length) {
+        states.key = KEY;
+        states.seed = seed;
+        states.length = length;
+        states.starts.clear();
+        uint64_t state = KEY ^ seed;
+        for (size_t pc = 0; pc < length; ++pc) {
+            if (pc % NATIVE_JVM_VM_WINDOW == 0) {
+                states.starts.push_back(state);
+            }
+            state = (state + KEY) ^ (KEY >> 3);
         }
-        out.push_back({op, operand});
     }
+    return states.starts.data();
 }
 
+// Decodes the window holding pc into window, wiping what it held before
+NATIVE_JVM_HOT static void decode_window(const Instruction* code, size_t length, size_t pc, uint64_t seed,
+                                         const uint64_t* starts, DecodedInstruction* window,
+                                         size_t& window_start, size_t& window_end) {
+    std::memset(window, 0, sizeof(DecodedInstruction) * NATIVE_JVM_VM_WINDOW);
+    window_start = pc - pc % NATIVE_JVM_VM_WINDOW;
+    window_end = std::min(length, window_start + NATIVE_JVM_VM_WINDOW);
+    uint64_t state = starts ? starts[pc / NATIVE_JVM_VM_WINDOW] : KEY ^ seed;
+    for (size_t i = window_start; i < window_end; ++i) {
+        state = (state + KEY) ^ (KEY >> 3);
+        window[i - window_start] = decode(code[i], state);
+    }
+}
+
+// Wipes the decoded window however the interpreter returns
+struct WindowScrub {
+    DecodedInstruction* window;
+    ~WindowScrub() {
+        volatile unsigned char* bytes = reinterpret_cast<volatile unsigned char*>(window);
+        for (size_t i = 0; i < sizeof(DecodedInstruction) * NATIVE_JVM_VM_WINDOW; ++i) {
+            bytes[i] = 0;
+        }
+    }
+};
+
 Instruction encode(OpCode op, int64_t operand, uint64_t key, uint64_t nonce) {
     uint8_t mapped = op_map[static_cast<uint8_t>(op)];
     mapped = op_map2[mapped];
@@ -322,14 +506,15 @@ Instruction encode(OpCode op, int64_t operand, uint64_t key, uint64_t nonce) {
     };
 }
 
-int64_t execute(JNIEnv* env, const Instruction* code, size_t length,
-                int64_t* locals, size_t locals_length, uint64_t seed,
-                const ConstantPoolEntry* constant_pool, size_t constant_pool_size,
-                const MethodRef* method_refs, size_t method_refs_size,
-                const FieldRef* field_refs, size_t field_refs_size,
-                const MultiArrayInfo* multi_refs, size_t multi_refs_size,
-                const TableSwitch* table_refs, size_t table_refs_size,
-                const LookupSwitch* lookup_refs, size_t lookup_refs_size) {
+NATIVE_JVM_HOT int64_t execute(JNIEnv* env, const Instruction* code, size_t length,
+                               int64_t* locals, size_t locals_length, uint64_t seed,
+                               const ConstantPoolEntry* constant_pool, size_t constant_pool_size,
+                               const MethodRef* method_refs, size_t method_refs_size,
+                               const FieldRef* field_refs, size_t field_refs_size,
+                               const MultiArrayInfo* multi_refs, size_t multi_refs_size,
+                               const TableSwitch* table_refs, size_t table_refs_size,
+                               const LookupSwitch* lookup_refs, size_t lookup_refs_size,
+                               const ExceptionEntry* exception_table, size_t exception_table_size) {
     int64_t stack[256];
     size_t sp = 0;
     size_t pc = 0;
@@ -337,6 +522,13 @@ int64_t execute(JNIEnv* env, const Instruction* code, size_t length,
     uint64_t state = KEY ^ seed;
     OpCode op = OP_NOP;
     uint64_t mask = 0;
+    static thread_local uint64_t chaos = 0;
+    const uint64_t* window_starts = get_window_states(code, length, seed);
+    DecodedInstruction window[NATIVE_JVM_VM_WINDOW];
+    WindowScrub window_scrub{window};
+    size_t window_start = 0;
+    size_t window_end = 0;
+    size_t window_uses = 0;
 
     goto dispatch; // start of the threaded interpreter
 
@@ -344,32 +536,22 @@ int64_t execute(JNIEnv* env, const Instruction* code, size_t length,
 dispatch:
     state = (state + KEY) ^ (KEY >> 3); // evolve state
     if (pc >= length) goto halt;
-    // XOR promotes to int; cast back to uint8_t before converting to OpCode
-    {
-        if (code[pc].nonce == 0) {
-            // Plain instructions (not encrypted) - used by generated VM code
-            op = static_cast<OpCode>(code[pc].op);
-            tmp = code[pc].operand;
+    if (pc < window_start || pc >= window_end || window_uses >= NATIVE_JVM_VM_WINDOW_USES) {
+        decode_window(code, length, pc, seed, window_starts, window, window_start, window_end);
+        window_uses = 0;
+        mask = state ^ KEY ^ chaos;
+        if ((mask & 1ULL) == 0) {
+            chaos ^= mask + pc;
+            op_map[0] ^= static_cast<uint8_t>(chaos);
+            op_map[0] ^= static_cast<uint8_t>(chaos); // undo to keep semantics
         } else {
-            // Encrypted instructions - normal path
-            uint64_t mix = state ^ code[pc].nonce;
-            uint8_t mapped = static_cast<uint8_t>(code[pc].op ^ static_cast<uint8_t>(mix));
-            mapped ^= static_cast<uint8_t>(code[pc].nonce);
-            mapped = inv_op_map2[mapped];
-            op = inv_op_map[mapped];
-            tmp = code[pc].operand ^ static_cast<int64_t>(mix * 0x9E3779B97F4A7C15ULL);
+            chaos += mask ^ pc;
         }
     }
+    op = window[pc - window_start].op;
+    tmp = window[pc - window_start].operand;
+    ++window_uses;
     ++pc;
-    static thread_local uint64_t chaos = 0;
-    mask = state ^ KEY ^ chaos;
-    if ((mask & 1ULL) == 0) {
-        chaos ^= mask + pc;
-        op_map[0] ^= static_cast<uint8_t>(chaos);
-        op_map[0] ^= static_cast<uint8_t>(chaos); // undo to keep semantics
-    } else {
-        chaos += mask ^ pc;
-    }
     switch (op) {
         case OP_PUSH:  goto do_push;
         case OP_ADD:   goto do_add;
@@ -594,7 +776,7 @@ do_div:
         int64_t b = stack[sp - 1];
         if (b == 0) {
             env->ThrowNew(env->FindClass("java/lang/ArithmeticException"), "/ by zero");
-            goto halt;
+            goto handle_exception;
         }
         stack[sp - 2] /= b;
         --sp;
@@ -840,7 +1022,7 @@ do_athrow:
         }
         --sp; // Pop exception object from stack
     }
-    goto halt; // Exception throwing terminates execution
+    goto handle_exception;
 
 do_try_start:
     // Setup exception handling context
@@ -1373,7 +1555,7 @@ do_aaload:
         stack[sp++] = reinterpret_cast<int64_t>(val);
         env->DeleteLocalRef(val);
     }
-    goto dispatch;
+    goto check_exception;
 
 do_aastore:
     if (sp >= 3) {
@@ -1382,7 +1564,7 @@ do_aastore:
         jobjectArray arr = reinterpret_cast<jobjectArray>(stack[--sp]);
         env->SetObjectArrayElement(arr, index, value);
     }
-    goto dispatch;
+    goto check_exception;
 
 do_iaload:
     if (sp >= 2) {
@@ -1392,7 +1574,7 @@ do_iaload:
         env->GetIntArrayRegion(arr, index, 1, &val);
         stack[sp++] = val;
     }
-    goto dispatch;
+    goto check_exception;
 
 do_laload:
     if (sp >= 2) {
@@ -1402,7 +1584,7 @@ do_laload:
         env->GetLongArrayRegion(arr, index, 1, &val);
         stack[sp++] = val;
     }
-    goto dispatch;
+    goto check_exception;
 
 do_faload:
     if (sp >= 2) {
@@ -1415,7 +1597,7 @@ do_faload:
         std::memcpy(&bits, &val, sizeof(float));
         stack[sp++] = static_cast<int64_t>(bits);
     }
-    goto dispatch;
+    goto check_exception;
 
 do_daload:
     if (sp >= 2) {
@@ -1428,7 +1610,7 @@ do_daload:
         std::memcpy(&bits, &val, sizeof(double));
         stack[sp++] = bits;
     }
-    goto dispatch;
+    goto check_exception;
 
 do_baload:
     if (sp >= 2) {
@@ -1438,7 +1620,7 @@ do_baload:
         env->GetByteArrayRegion(arr, index, 1, &val);
         stack[sp++] = val;
     }
-    goto dispatch;
+    goto check_exception;
 
 do_caload:
     if (sp >= 2) {
@@ -1448,7 +1630,7 @@ do_caload:
         env->GetCharArrayRegion(arr, index, 1, &val);
         stack[sp++] = val;
     }
-    goto dispatch;
+    goto check_exception;
 
 do_saload:
     if (sp >= 2) {
@@ -1458,7 +1640,7 @@ do_saload:
         env->GetShortArrayRegion(arr, index, 1, &val);
         stack[sp++] = val;
     }
-    goto dispatch;
+    goto check_exception;
 
 do_iastore:
     if (sp >= 3) {
@@ -1467,7 +1649,7 @@ do_iastore:
         jintArray arr = reinterpret_cast<jintArray>(stack[--sp]);
         env->SetIntArrayRegion(arr, index, 1, &value);
     }
-    goto dispatch;
+    goto check_exception;
 
 do_lastore:
     if (sp >= 3) {
@@ -1476,7 +1658,7 @@ do_lastore:
         jlongArray arr = reinterpret_cast<jlongArray>(stack[--sp]);
         env->SetLongArrayRegion(arr, index, 1, &value);
     }
-    goto dispatch;
+    goto check_exception;
 
 do_fastore:
     if (sp >= 3) {
@@ -1488,7 +1670,7 @@ do_fastore:
         jfloatArray arr = reinterpret_cast<jfloatArray>(stack[--sp]);
         env->SetFloatArrayRegion(arr, index, 1, &value);
     }
-    goto dispatch;
+    goto check_exception;
 
 do_dastore:
     if (sp >= 3) {
@@ -1500,7 +1682,7 @@ do_dastore:
         jdoubleArray arr = reinterpret_cast<jdoubleArray>(stack[--sp]);
         env->SetDoubleArrayRegion(arr, index, 1, &value);
     }
-    goto dispatch;
+    goto check_exception;
 
 do_bastore:
     if (sp >= 3) {
@@ -1509,7 +1691,7 @@ do_bastore:
         jbyteArray arr = reinterpret_cast<jbyteArray>(stack[--sp]);
         env->SetByteArrayRegion(arr, index, 1, &value);
     }
-    goto dispatch;
+    goto check_exception;
 
 do_castore:
     if (sp >= 3) {
@@ -1518,7 +1700,7 @@ do_castore:
         jcharArray arr = reinterpret_cast<jcharArray>(stack[--sp]);
         env->SetCharArrayRegion(arr, index, 1, &value);
     }
-    goto dispatch;
+    goto check_exception;
 
 do_sastore:
     if (sp >= 3) {
@@ -1527,7 +1709,7 @@ do_sastore:
         jshortArray arr = reinterpret_cast<jshortArray>(stack[--sp]);
         env->SetShortArrayRegion(arr, index, 1, &value);
     }
-    goto dispatch;
+    goto check_exception;
 
 do_new:
     if (sp < 256) {
@@ -1539,7 +1721,7 @@ do_new:
             env->DeleteLocalRef(clazz);
         }
     }
-    goto dispatch;
+    goto check_exception;
 
 do_anewarray:
     if (sp >= 1) {
@@ -1553,7 +1735,7 @@ do_anewarray:
         }
         stack[sp++] = reinterpret_cast<int64_t>(arr);
     }
-    goto dispatch;
+    goto check_exception;
 
 do_newarray:
     if (sp >= 1) {
@@ -1572,7 +1754,7 @@ do_newarray:
         }
         stack[sp++] = reinterpret_cast<int64_t>(arr);
     }
-    goto dispatch;
+    goto check_exception;
 
 do_multianewarray:
     {
@@ -1591,7 +1773,7 @@ do_multianewarray:
         }
         stack[sp++] = reinterpret_cast<int64_t>(arr);
     }
-    goto dispatch;
+    goto check_exception;
 
 do_checkcast:
     if (sp >= 1) {
@@ -1608,7 +1790,7 @@ do_checkcast:
             }
         }
     }
-    goto dispatch;
+    goto check_exception;
 
 do_instanceof:
     if (sp >= 1) {
@@ -1619,7 +1801,7 @@ do_instanceof:
         if (clazz) env->DeleteLocalRef(clazz);
         stack[sp++] = res ? 1 : 0;
     }
-    goto dispatch;
+    goto check_exception;
 
 do_getstatic:
     if (sp < 256) {
@@ -1663,7 +1845,7 @@ do_getstatic:
             env->DeleteLocalRef(clazz);
         }
     }
-    goto dispatch;
+    goto check_exception;
 
 do_putstatic:
     if (sp >= 1) {
@@ -1711,7 +1893,7 @@ do_putstatic:
             --sp;
         }
     }
-    goto dispatch;
+    goto check_exception;
 
 do_getfield:
     if (sp >= 1 && sp < 256) {
@@ -1719,7 +1901,7 @@ do_getfield:
         jobject obj = reinterpret_cast<jobject>(stack[--sp]);
         if (!obj) {
             env->ThrowNew(env->FindClass("java/lang/NullPointerException"), "null");
-            goto halt;
+            goto handle_exception;
         }
         jclass clazz = get_cached_class(env, ref->class_name);
         if (clazz) {
@@ -1760,7 +1942,7 @@ do_getfield:
             env->DeleteLocalRef(clazz);
         }
     }
-    goto dispatch;
+    goto check_exception;
 
 do_putfield:
     if (sp >= 2) {
@@ -1769,7 +1951,7 @@ do_putfield:
         jobject obj = reinterpret_cast<jobject>(stack[--sp]);
         if (!obj) {
             env->ThrowNew(env->FindClass("java/lang/NullPointerException"), "null");
-            goto halt;
+            goto handle_exception;
         }
         jclass clazz = get_cached_class(env, ref->class_name);
         if (clazz) {
@@ -1810,7 +1992,7 @@ do_putfield:
     } else {
         sp = 0;
     }
-    goto dispatch;
+    goto check_exception;
 
 do_invokestatic:
     if (method_refs && static_cast<size_t>(tmp) < method_refs_size) {
@@ -1822,7 +2004,7 @@ do_invokestatic:
         env->ThrowNew(env->FindClass("java/lang/RuntimeException"), debug_msg);
         goto halt;
     }
-    goto dispatch;
+    goto check_exception;
 
 do_invokevirtual:
     if (method_refs && static_cast<size_t>(tmp) < method_refs_size) {
@@ -1834,7 +2016,7 @@ do_invokevirtual:
         env->ThrowNew(env->FindClass("java/lang/RuntimeException"), debug_msg);
         goto halt;
     }
-    goto dispatch;
+    goto check_exception;
 
 do_invokespecial:
     if (method_refs && static_cast<size_t>(tmp) < method_refs_size) {
@@ -1846,7 +2028,7 @@ do_invokespecial:
         env->ThrowNew(env->FindClass("java/lang/RuntimeException"), debug_msg);
         goto halt;
     }
-    goto dispatch;
+    goto check_exception;
 
 do_invokeinterface:
     if (method_refs && static_cast<size_t>(tmp) < method_refs_size) {
@@ -1858,7 +2040,7 @@ do_invokeinterface:
         env->ThrowNew(env->FindClass("java/lang/RuntimeException"), debug_msg);
         goto halt;
     }
-    goto dispatch;
+    goto check_exception;
 
 do_invokedynamic:
     if (method_refs && static_cast<size_t>(tmp) < method_refs_size) {
@@ -1870,7 +2052,7 @@ do_invokedynamic:
         env->ThrowNew(env->FindClass("java/lang/RuntimeException"), debug_msg);
         goto halt;
     }
-    goto dispatch;
+    goto check_exception;
 
 do_ldc:
     // Load constant from constant pool (1-word constants: int, float, string, class)
@@ -1988,7 +2170,7 @@ do_ldc:
                 goto halt;
         }
     }
-    goto dispatch;
+    goto check_exception;
 
 do_ldc2_w:
     // Load 2-word constant from constant pool (long, double, MethodHandle, MethodType)
@@ -2094,7 +2276,7 @@ do_ldc2_w:
                 goto halt;
         }
     }
-    goto dispatch;
+    goto check_exception;
 
 // Dummy branch used only to confuse decompilers
 junk:
@@ -2103,12 +2285,49 @@ junk:
     state ^= KEY << 7;
     goto dispatch;
 
+// Every instruction that calls into JNI leaves through here, so pure
+// stack and arithmetic code never pays for the exception table.
+check_exception:
+    if (exception_table_size != 0 && env->ExceptionCheck()) goto handle_exception;
+    goto dispatch;
+
+// Unwinds to the first handler covering the faulting instruction.  The
+// operand stack is discarded and the exception pushed, as on the JVM.
+handle_exception:
+    if (exception_table_size == 0) goto halt;
+    {
+        jthrowable exception = env->ExceptionOccurred();
+        if (exception == nullptr) goto halt;
+        env->ExceptionClear();
+        size_t fault = pc - 1;
+        for (size_t i = 0; i < exception_table_size; ++i) {
+            const ExceptionEntry& entry = exception_table[i];
+            if (fault < entry.start || fault >= entry.end) continue;
+            if (entry.catch_class != nullptr) {
+                jclass clazz = get_cached_class(env, entry.catch_class);
+                if (clazz == nullptr) {
+                    env->ExceptionClear();
+                    continue;
+                }
+                jboolean matches = env->IsInstanceOf(exception, clazz);
+                env->DeleteLocalRef(clazz);
+                if (!matches) continue;
+            }
+            sp = 0;
+            stack[sp++] = reinterpret_cast<int64_t>(exception);
+            pc = entry.handler;
+            goto dispatch;
+        }
+        env->Throw(exception);
+    }
+    goto halt;
+
 // Exit point
 halt:
     return (sp > 0) ? stack[sp - 1] : 0;
 }
 
-void encode_program(Instruction* code, size_t length, uint64_t seed) {
+NATIVE_JVM_COLD void encode_program(Instruction* code, size_t length, uint64_t seed) {
     ensure_init(seed);
     uint64_t state = KEY ^ seed;
     std::mt19937_64 rng(KEY ^ (seed << 1));
@@ -2119,15 +2338,70 @@ void encode_program(Instruction* code, size_t length, uint64_t seed) {
     }
 }
 
-int64_t execute_jit(JNIEnv* env, const Instruction* code, size_t length,
-                    int64_t* locals, size_t locals_length, uint64_t seed,
-                    const ConstantPoolEntry* constant_pool, size_t constant_pool_size,
-                    const MethodRef* method_refs, size_t method_refs_size,
-                    const FieldRef* field_refs, size_t field_refs_size,
-                    const MultiArrayInfo* multi_refs, size_t multi_refs_size,
-                    const TableSwitch* table_refs, size_t table_refs_size,
-                    const LookupSwitch* lookup_refs, size_t lookup_refs_size) {
+struct ProgramKey {
+    uint64_t KEY;
+    std::array<uint8_t, OP_COUNT> op_map;
+    std::array<uint8_t, OP_COUNT> op_map2;
+    std::array<uint8_t, OP_COUNT> inv_op_map2;
+    std::array<OpCode, OP_COUNT> inv_op_map;
+};
+
+NATIVE_JVM_COLD void prepare_method(MethodDescriptor& method, Instruction* code) {
+    init_key(method.seed);
+    encode_program(code, method.length, method.seed);
+    // Lives as long as the descriptor, which is a function-local static
+    method.key = new ProgramKey{KEY, op_map, op_map2, inv_op_map2, inv_op_map};
+}
+
+NATIVE_JVM_HOT int64_t execute(JNIEnv* env, const MethodDescriptor& method, int64_t* locals) {
+    // Same contract as init_key: a nested call gets the caller's state back
+    save_state_for_nested_call();
+    const ProgramKey& key = *method.key;
+    KEY = key.KEY;
+    op_map = key.op_map;
+    op_map2 = key.op_map2;
+    inv_op_map2 = key.inv_op_map2;
+    inv_op_map = key.inv_op_map;
+    vm_state_initialized = true;
+    if (method.jit) {
+        return execute_jit(env, method.code, method.length, locals, method.locals_length, method.seed,
+                           method.constant_pool, method.constant_pool_size,
+                           method.method_refs, method.method_refs_size,
+                           method.field_refs, method.field_refs_size,
+                           method.multi_refs, method.multi_refs_size,
+                           nullptr, 0, nullptr, 0,
+                           method.exception_table, method.exception_table_size);
+    }
+    return execute(env, method.code, method.length, locals, method.locals_length, method.seed,
+                   method.constant_pool, method.constant_pool_size,
+                   method.method_refs, method.method_refs_size,
+                   method.field_refs, method.field_refs_size,
+                   method.multi_refs, method.multi_refs_size,
+                   nullptr, 0, nullptr, 0,
+                   method.exception_table, method.exception_table_size);
+}
+
+NATIVE_JVM_HOT int64_t execute_jit(JNIEnv* env, const Instruction* code, size_t length,
+                                   int64_t* locals, size_t locals_length, uint64_t seed,
+                                   const ConstantPoolEntry* constant_pool, size_t constant_pool_size,
+                                   const MethodRef* method_refs, size_t method_refs_size,
+                                   const FieldRef* field_refs, size_t field_refs_size,
+                                   const MultiArrayInfo* multi_refs, size_t multi_refs_size,
+                                   const TableSwitch* table_refs, size_t table_refs_size,
+                                   const LookupSwitch* lookup_refs, size_t lookup_refs_size,
+                                   const ExceptionEntry* exception_table, size_t exception_table_size) {
     ensure_init(seed);
+    if (exception_table_size != 0) {
+        // Compiled programs do not unwind; keep them on the interpreter
+        return execute(env, code, length, locals, locals_length, seed,
+                       constant_pool, constant_pool_size,
+                       method_refs, method_refs_size,
+                       field_refs, field_refs_size,
+                       multi_refs, multi_refs_size,
+                       table_refs, table_refs_size,
+                       lookup_refs, lookup_refs_size,
+                       exception_table, exception_table_size);
+    }
     auto it = jit_cache.find(code);
     if (it != jit_cache.end()) {
         if (it->second.func != nullptr) {
@@ -2167,7 +2441,7 @@ static int64_t execute_variant(JNIEnv* env, const Instruction* code, size_t leng
     return execute(env, code, length, locals, locals_length, seed, nullptr, 0, nullptr, 0, nullptr, 0, nullptr, 0, nullptr, 0, nullptr, 0);
 }
 
-int64_t run_arith_vm(JNIEnv* env, OpCode op, int64_t lhs, int64_t rhs, uint64_t seed) {
+NATIVE_JVM_HOT int64_t run_arith_vm(JNIEnv* env, OpCode op, int64_t lhs, int64_t rhs, uint64_t seed) {
     ensure_init(seed);
     std::vector<Instruction> program;
     program.reserve(16);
@@ -2209,7 +2483,118 @@ int64_t run_arith_vm(JNIEnv* env, OpCode op, int64_t lhs, int64_t rhs, uint64_t
     }
 }
 
-int64_t run_unary_vm(JNIEnv* env, OpCode op, int64_t value, uint64_t seed) {
+// Runs a program of OP_LOAD, OP_PUSH, junk and two-operand arithmetic
+// instructions over count lanes at once: each instruction is decoded once
+// and applied to every lane in a plain loop the compiler can vectorise.
+// OP_LOAD k reads inputs[k]. Returns false, with an exception pending when
+// env is set, on a zero divisor.
+static bool execute_batch(JNIEnv* env, const Instruction* code, size_t length, uint64_t seed,
+                          const int64_t* const* inputs, size_t input_count, int64_t* out, size_t count) {
+    constexpr size_t max_depth = 4;
+    std::vector<int64_t> lanes(max_depth * count);
+    size_t sp = 0;
+    auto slot = [&](size_t index) { return lanes.data() + index * count; };
+    auto binary = [&](auto apply) {
+        if (sp < 2) return;
+        int64_t* __restrict a = slot(sp - 2);
+        const int64_t* __restrict b = slot(sp - 1);
+        for (size_t i = 0; i < count; ++i) a[i] = apply(a[i], b[i]);
+        --sp;
+    };
+
+    uint64_t state = KEY ^ seed;
+    for (size_t pc = 0; pc < length; ++pc) {
+        state = (state + KEY) ^ (KEY >> 3);
+        DecodedInstruction ins = decode(code[pc], state);
+        switch (ins.op) {
+        case OP_PUSH:
+            if (sp < max_depth) std::fill_n(slot(sp++), count, ins.operand);
+            break;
+        case OP_LOAD:
+            if (sp < max_depth && ins.operand >= 0 && static_cast<size_t>(ins.operand) < input_count) {
+                std::copy_n(inputs[ins.operand], count, slot(sp++));
+            }
+            break;
+        case OP_ADD:  binary([](int64_t a, int64_t b) { return a + b; }); break;
+        case OP_SUB:  binary([](int64_t a, int64_t b) { return a - b; }); break;
+        case OP_MUL:  binary([](int64_t a, int64_t b) { return a * b; }); break;
+        case OP_AND:  binary([](int64_t a, int64_t b) { return a & b; }); break;
+        case OP_OR:   binary([](int64_t a, int64_t b) { return a | b; }); break;
+        case OP_XOR:  binary([](int64_t a, int64_t b) { return a ^ b; }); break;
+        case OP_SHL:  binary([](int64_t a, int64_t b) { return a << b; }); break;
+        case OP_SHR:  binary([](int64_t a, int64_t b) { return a >> b; }); break;
+        case OP_USHR:
+            binary([](int64_t a, int64_t b) { return static_cast<int64_t>(static_cast<uint64_t>(a) >> b); });
+            break;
+        case OP_DIV:
+            if (sp >= 2 && std::find(slot(sp - 1), slot(sp - 1) + count, 0) != slot(sp - 1) + count) {
+                if (env != nullptr) {
+                    env->ThrowNew(env->FindClass("java/lang/ArithmeticException"), "/ by zero");
+                }
+                return false;
+            }
+            binary([](int64_t a, int64_t b) { return a / b; });
+            break;
+        case OP_HALT:
+            if (sp > 0) {
+                std::copy_n(slot(sp - 1), count, out);
+            } else {
+                std::fill_n(out, count, 0);
+            }
+            return true;
+        default:
+            // Junk only touches the interpreter's temp register
+            break;
+        }
+    }
+    std::fill_n(out, count, 0);
+    return true;
+}
+
+NATIVE_JVM_HOT void run_arith_vm_batch(JNIEnv* env, OpCode op, const int64_t* lhs, const int64_t* rhs,
+                                       int64_t* out, size_t count, uint64_t seed) {
+    if (count == 0) {
+        return;
+    }
+    ensure_init(seed);
+    std::vector<Instruction> program;
+    program.reserve(16);
+    uint64_t state = KEY ^ seed;
+    std::mt19937_64 rng(KEY ^ (seed << 1));
+
+    auto emit = [&](OpCode opcode, int64_t operand) {
+        state = (state + KEY) ^ (KEY >> 3);
+        uint64_t nonce = rng() ^ state;
+        program.push_back(encode(opcode, operand, state, nonce));
+    };
+
+    auto emit_junk = [&]() {
+        std::uniform_int_distribution<int> count_dist(0, 3);
+        std::uniform_int_distribution<int> choice_dist(0, 2);
+        int junk_count = count_dist(rng);
+        for (int i = 0; i < junk_count; ++i) {
+            int choice = choice_dist(rng);
+            OpCode junk = choice == 0 ? OP_JUNK1 : (choice == 1 ? OP_JUNK2 : OP_NOP);
+            emit(junk, 0);
+        }
+    };
+
+    // Same shape as run_arith_vm's program, with the operands read per lane
+    emit_junk();
+    emit(OP_LOAD, 0);
+    emit_junk();
+    emit(OP_LOAD, 1);
+    emit_junk();
+    emit(op, 0);
+    emit_junk();
+    emit(OP_HALT, 0);
+
+    const int64_t* inputs[] = {lhs, rhs};
+    execute_batch(env, program.data(), program.size(), seed, inputs, 2, out, count);
+    std::memset(program.data(), 0, program.size() * sizeof(Instruction));
+}
+
+NATIVE_JVM_HOT int64_t run_unary_vm(JNIEnv* env, OpCode op, int64_t value, uint64_t seed) {
     ensure_init(seed);
     std::vector<Instruction> program;
     program.reserve(8);
@@ -228,6 +228,16 @@ struct LookupSwitch {
     size_t default_target;
 };
 
+// One row of a program's exception table.  Rows are searched in order
+// for the first one whose [start, end) range covers the faulting pc and
+// whose catch class matches; nullptr catches everything.
+struct ExceptionEntry {
+    size_t start;
+    size_t end;
+    size_t handler;
+    const char* catch_class;
+};
+
 // Helper that produces an encoded instruction using the global key.
 Instruction encode(OpCode op, int64_t operand, uint64_t key, uint64_t nonce);
 
@@ -240,7 +250,10 @@ void init_key(uint64_t seed);
 // decoding of every instruction.  The return value is the top of the
 // stack after the program halts which allows host code to retrieve
 // computed values. Locals should point to an array of initial local
-// variables for OP_LOAD/OP_STORE instructions.
+// variables for OP_LOAD/OP_STORE instructions.  The exception table is
+// only consulted once a JNI-calling instruction leaves an exception
+// pending; without a matching row the exception stays pending and the
+// program halts.
 int64_t execute(JNIEnv* env, const Instruction* code, size_t length,
                 int64_t* locals, size_t locals_length, uint64_t seed,
                 const ConstantPoolEntry* constant_pool = nullptr, size_t constant_pool_size = 0,
@@ -248,10 +261,12 @@ int64_t execute(JNIEnv* env, const Instruction* code, size_t length,
                 const FieldRef* field_refs = nullptr, size_t field_refs_size = 0,
                 const MultiArrayInfo* multi_refs = nullptr, size_t multi_refs_size = 0,
                 const TableSwitch* table_refs = nullptr, size_t table_refs_size = 0,
-                const LookupSwitch* lookup_refs = nullptr, size_t lookup_refs_size = 0);
+                const LookupSwitch* lookup_refs = nullptr, size_t lookup_refs_size = 0,
+                const ExceptionEntry* exception_table = nullptr, size_t exception_table_size = 0);
 
 // JIT-enabled variant that caches translated machine code for hot sequences
-// and executes them directly. Falls back to the interpreter for cold code.
+// and executes them directly. Falls back to the interpreter for cold code
+// and for programs with an exception table.
 int64_t execute_jit(JNIEnv* env, const Instruction* code, size_t length,
                     int64_t* locals, size_t locals_length, uint64_t seed,
                     const ConstantPoolEntry* constant_pool = nullptr, size_t constant_pool_size = 0,
@@ -259,19 +274,61 @@ int64_t execute_jit(JNIEnv* env, const Instruction* code, size_t length,
                     const FieldRef* field_refs = nullptr, size_t field_refs_size = 0,
                     const MultiArrayInfo* multi_refs = nullptr, size_t multi_refs_size = 0,
                     const TableSwitch* table_refs = nullptr, size_t table_refs_size = 0,
-                    const LookupSwitch* lookup_refs = nullptr, size_t lookup_refs_size = 0);
+                    const LookupSwitch* lookup_refs = nullptr, size_t lookup_refs_size = 0,
+                    const ExceptionEntry* exception_table = nullptr, size_t exception_table_size = 0);
 
 // Encodes a program in-place using the internal key so that it can be
 // executed by the VM.  The seed should be the same value passed to
 // execute.
 void encode_program(Instruction* code, size_t length, uint64_t seed);
 
+// Decode key and opcode maps a program was encoded with.
+struct ProgramKey;
+
+// Everything a virtualized method needs besides its arguments.  Generated
+// wrappers build one per method on first call, with the reference tables
+// decrypted once, so each call only fills the locals.
+struct MethodDescriptor {
+    const Instruction* code;
+    size_t length;
+    size_t locals_length;
+    uint64_t seed;
+    const ConstantPoolEntry* constant_pool;
+    size_t constant_pool_size;
+    const MethodRef* method_refs;
+    size_t method_refs_size;
+    const FieldRef* field_refs;
+    size_t field_refs_size;
+    const MultiArrayInfo* multi_refs;
+    size_t multi_refs_size;
+    const ExceptionEntry* exception_table;
+    size_t exception_table_size;
+    bool jit;
+    const ProgramKey* key;
+};
+
+// Encodes code (which method.code must point to) under a fresh key that is
+// kept in the descriptor.  Called once per descriptor.
+void prepare_method(MethodDescriptor& method, Instruction* code);
+
+// Runs a prepared method: installs its key for the current thread and
+// dispatches to execute or execute_jit.
+int64_t execute(JNIEnv* env, const MethodDescriptor& method, int64_t* locals);
+
 // Helper utility used by the obfuscator to perform simple arithmetic
 // through the VM.  It encodes a tiny program that evaluates
 //    result = lhs (op) rhs
 // for one of the arithmetic operations and returns the computed value.
 int64_t run_arith_vm(JNIEnv* env, OpCode op, int64_t lhs, int64_t rhs, uint64_t seed);
 
+// Batch form of run_arith_vm: out[i] = lhs[i] (op) rhs[i] for count lanes.
+// The program is built and encoded once per call and each instruction is
+// decoded once for all lanes, instead of once per value.  On a zero
+// divisor an ArithmeticException is thrown through env (when set) and out
+// is left unspecified.
+void run_arith_vm_batch(JNIEnv* env, OpCode op, const int64_t* lhs, const int64_t* rhs,
+                        int64_t* out, size_t count, uint64_t seed);
+
 // Executes a unary operation (conversion or negation) through the VM.
 int64_t run_unary_vm(JNIEnv* env, OpCode op, int64_t value, uint64_t seed);
 
@@ -1,5 +1,21 @@
 #include "native_jvm.hpp"
+#include "string_pool.hpp"
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <unordered_map>
+#include <vector>
+
+#if defined(NATIVE_JVM_HUGE_PAGES) && defined(__linux__)
+#include <link.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#ifndef MADV_COLLAPSE
+#define MADV_COLLAPSE 25
+#endif
+#endif
 
 namespace native_jvm::utils {
 
@@ -73,99 +89,117 @@ namespace native_jvm::utils {
         return result;
     }
 
+    // JNI lookups made while bootstrapping, counted for the startup trace
+    static jclass find_class(JNIEnv *env, const char *name) {
+        NATIVE_JVM_TRACE_ADD(lookups, 1);
+        return env->FindClass(name);
+    }
+
+    static jmethodID get_method_id(JNIEnv *env, jclass clazz, const char *name, const char *sig) {
+        NATIVE_JVM_TRACE_ADD(lookups, 1);
+        return env->GetMethodID(clazz, name, sig);
+    }
+
+#ifdef USE_HOTSPOT
+    static jmethodID get_static_method_id(JNIEnv *env, jclass clazz, const char *name, const char *sig) {
+        NATIVE_JVM_TRACE_ADD(lookups, 1);
+        return env->GetStaticMethodID(clazz, name, sig);
+    }
+#endif
+
     void init_utils(JNIEnv *env) {
-        jclass clazz = env->FindClass("[Z");
+        jclass clazz = find_class(env, "[Z");
         if (env->ExceptionCheck())
             return;
         boolean_array_class = (jclass) env->NewGlobalRef(clazz);
         env->DeleteLocalRef(clazz);
 
-        jclass string_clazz = env->FindClass("java/lang/String");
+        jclass string_clazz = find_class(env, "java/lang/String");
         if (env->ExceptionCheck())
             return;
-        string_intern_method = env->GetMethodID(string_clazz, "intern", "()Ljava/lang/String;");
+        string_intern_method = get_method_id(env, string_clazz, "intern", "()Ljava/lang/String;");
         if (env->ExceptionCheck())
             return;
         env->DeleteLocalRef(string_clazz);
 
-        jclass _class_class = env->FindClass("java/lang/Class");
+        jclass _class_class = find_class(env, "java/lang/Class");
         if (env->ExceptionCheck())
             return;
         class_class = (jclass) env->NewGlobalRef(_class_class);
         env->DeleteLocalRef(_class_class);
 
-        get_classloader_method = env->GetMethodID(class_class, "getClassLoader", "()Ljava/lang/ClassLoader;");
+        get_classloader_method = get_method_id(env, class_class, "getClassLoader", "()Ljava/lang/ClassLoader;");
         if (env->ExceptionCheck())
             return;
 
-        jclass _object_class = env->FindClass("java/lang/Object");
+        jclass _object_class = find_class(env, "java/lang/Object");
         if (env->ExceptionCheck())
             return;
         object_class = (jclass) env->NewGlobalRef(_object_class);
         env->DeleteLocalRef(_object_class);
 
-        get_class_method = env->GetMethodID(object_class, "getClass", "()Ljava/lang/Class;");
+        get_class_method = get_method_id(env, object_class, "getClass", "()Ljava/lang/Class;");
         if (env->ExceptionCheck())
             return;
 
-        jclass _classloader_class = env->FindClass("java/lang/ClassLoader");
+        jclass _classloader_class = find_class(env, "java/lang/ClassLoader");
         if (env->ExceptionCheck())
             return;
         classloader_class = (jclass) env->NewGlobalRef(_classloader_class);
         env->DeleteLocalRef(_classloader_class);
 
-        load_class_method = env->GetMethodID(classloader_class, "loadClass", "(Ljava/lang/String;)Ljava/lang/Class;");
+        load_class_method = get_method_id(env, classloader_class, "loadClass", "(Ljava/lang/String;)Ljava/lang/Class;");
         if (env->ExceptionCheck())
             return;
 
-        jclass _no_class_def_found_class = env->FindClass("java/lang/NoClassDefFoundError");
+        jclass _no_class_def_found_class = find_class(env, "java/lang/NoClassDefFoundError");
         if (env->ExceptionCheck())
             return;
         no_class_def_found_class = (jclass) env->NewGlobalRef(_no_class_def_found_class);
         env->DeleteLocalRef(_no_class_def_found_class);
 
-        ncdf_init_method = env->GetMethodID(no_class_def_found_class, "<init>", "(Ljava/lang/String;)V");
+        ncdf_init_method = get_method_id(env, no_class_def_found_class, "<init>", "(Ljava/lang/String;)V");
         if (env->ExceptionCheck())
             return;
 
-        jclass _throwable_class = env->FindClass("java/lang/Throwable");
+        jclass _throwable_class = find_class(env, "java/lang/Throwable");
         if (env->ExceptionCheck())
             return;
         throwable_class = (jclass) env->NewGlobalRef(_throwable_class);
         env->DeleteLocalRef(_throwable_class);
 
-        get_message_method = env->GetMethodID(throwable_class, "getMessage", "()Ljava/lang/String;");
+        get_message_method = get_method_id(env, throwable_class, "getMessage", "()Ljava/lang/String;");
         if (env->ExceptionCheck())
             return;
 
-        init_cause_method = env->GetMethodID(throwable_class, "initCause",
+        init_cause_method = get_method_id(env, throwable_class, "initCause",
                                             "(Ljava/lang/Throwable;)Ljava/lang/Throwable;");
         if (env->ExceptionCheck())
             return;
 
-        jclass _methodhandles_lookup_class = env->FindClass("java/lang/invoke/MethodHandles$Lookup");
+        jclass _methodhandles_lookup_class = find_class(env, "java/lang/invoke/MethodHandles$Lookup");
         if (env->ExceptionCheck())
             return;
         methodhandles_lookup_class = (jclass) env->NewGlobalRef(_methodhandles_lookup_class);
         env->DeleteLocalRef(_methodhandles_lookup_class);
 
-        lookup_init_method = env->GetMethodID(methodhandles_lookup_class, "<init>", "(Ljava/lang/Class;)V");
+        lookup_init_method = get_method_id(env, methodhandles_lookup_class, "<init>", "(Ljava/lang/Class;)V");
         if (env->ExceptionCheck())
             return;
 
 #ifdef USE_HOTSPOT
-        jclass _methodhandle_natives_class = env->FindClass("java/lang/invoke/MethodHandleNatives");
+        jclass _methodhandle_natives_class = find_class(env, "java/lang/invoke/MethodHandleNatives");
         if (env->ExceptionCheck())
             return;
         methodhandle_natives_class = (jclass) env->NewGlobalRef(_methodhandle_natives_class);
         env->DeleteLocalRef(_methodhandle_natives_class);
 
-        link_call_site_method = env->GetStaticMethodID(methodhandle_natives_class, "linkCallSite",
+        link_call_site_method = get_static_method_id(env, methodhandle_natives_class, "linkCallSite",
             "(Ljava/lang/Object;Ljava/lang/Object;Ljava/lang/Object;Ljava/lang/Object;Ljava/lang/Object;[Ljava/lang/Object;)Ljava/lang/invoke/MemberName;");
         is_jvm11_link_call_site = false;
         if (env->ExceptionCheck()) {
             env->ExceptionClear();
-            link_call_site_method = env->GetStaticMethodID(methodhandle_natives_class, "linkCallSite",
+            link_call_site_method = get_static_method_id(env, methodhandle_natives_class, "linkCallSite",
                 "(Ljava/lang/Object;ILjava/lang/Object;Ljava/lang/Object;Ljava/lang/Object;Ljava/lang/Object;[Ljava/lang/Object;)Ljava/lang/invoke/MemberName;");
             is_jvm11_link_call_site = true;
             if (env->ExceptionCheck())
@@ -413,15 +447,221 @@ namespace native_jvm::utils {
         return lookup;
     }
 
-    void clear_refs(JNIEnv *env, std::unordered_set<jobject> &refs) {
-        // Avoid eagerly deleting local refs that might still be referenced via
-        // cstack slots. Let the JVM clear locals at the end of the native call.
-        // This prevents accidental invalidation of receiver/argument objects
-        // used by subsequent INVOKEVIRTUAL calls in the generated state machine.
-        (void)env;
-        refs.clear();
+    void clear_refs(JNIEnv *env, std::unordered_set<jobject> &refs, const jobject *live, size_t live_count) {
+        // Called at loop headers only. Anything in refs that is not held by a
+        // live stack/local slot (per the verifier frame) is dead for the rest of
+        // the iteration. Constant pool strings/classes are global or weak refs
+        // and may flow through ALOAD into refs, so only true local refs are freed.
+        for (auto it = refs.begin(); it != refs.end();) {
+            jobject ref = *it;
+            bool is_live = ref == nullptr;
+            for (size_t i = 0; i < live_count && !is_live; i++) {
+                is_live = live[i] == ref;
+            }
+            if (is_live) {
+                ++it;
+                continue;
+            }
+            if (env->GetObjectRefType(ref) == JNILocalRefType) {
+                env->DeleteLocalRef(ref);
+            }
+            it = refs.erase(it);
+        }
+    }
+
+#ifdef NATIVE_JVM_REF_METRICS
+    static std::mutex ref_metrics_mtx;
+
+    static std::unordered_map<std::string, size_t> &ref_metrics_peaks() {
+        static std::unordered_map<std::string, size_t> peaks;
+        return peaks;
     }
 
+    static struct ref_metrics_reporter {
+        ~ref_metrics_reporter() {
+            std::lock_guard<std::mutex> lock(ref_metrics_mtx);
+            for (const auto &entry : ref_metrics_peaks()) {
+                fprintf(stderr, "[native_jvm] peak local refs %zu: %s\n", entry.second, entry.first.c_str());
+            }
+        }
+    } ref_metrics_reporter_instance;
+
+    ref_metrics_scope::~ref_metrics_scope() {
+        sample();
+        std::lock_guard<std::mutex> lock(ref_metrics_mtx);
+        size_t &current = ref_metrics_peaks()[method];
+        if (peak > current) {
+            current = peak;
+        }
+    }
+#endif
+
+#ifdef NATIVE_JVM_STARTUP_TRACE
+    static std::mutex startup_trace_mtx;
+    static thread_local size_t trace_counters[(size_t) trace_counter::count];
+
+    // steady_clock is CLOCK_MONOTONIC on Linux, the clock behind System.nanoTime
+    static int64_t trace_now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    static void write_trace_event(const char *phase, jint class_id, int64_t start, int64_t end,
+                                  const size_t *counters) {
+        std::lock_guard<std::mutex> lock(startup_trace_mtx);
+        static FILE *output = nullptr;
+        if (output == nullptr) {
+            const char *path = std::getenv("NATIVE_JVM_STARTUP_TRACE");
+            if (path != nullptr && *path != '\0') {
+                output = fopen(path, "w");
+            }
+            if (output == nullptr) {
+                output = stderr;
+            }
+        }
+        fprintf(output, "{\"phase\":\"%s\"", phase);
+        if (class_id >= 0) {
+            fprintf(output, ",\"class\":%d", (int) class_id);
+        }
+        fprintf(output, ",\"start_ns\":%lld,\"duration_ns\":%lld,\"lookups\":%zu,\"strings\":%zu,\"natives\":%zu}\n",
+                (long long) start, (long long) (end - start),
+                counters[(size_t) trace_counter::lookups],
+                counters[(size_t) trace_counter::strings],
+                counters[(size_t) trace_counter::natives]);
+        fflush(output);
+    }
+
+    // Records when the dynamic linker ran the library initialisers, before JNI_OnLoad
+    static struct startup_trace_loaded {
+        startup_trace_loaded() {
+            size_t none[(size_t) trace_counter::count] = {};
+            int64_t now = trace_now();
+            write_trace_event("library_loaded", -1, now, now, none);
+        }
+    } startup_trace_loaded_instance;
+
+    void trace_add(trace_counter counter, size_t amount) {
+        trace_counters[(size_t) counter] += amount;
+    }
+
+    startup_trace_scope::startup_trace_scope(const char *phase, jint class_id)
+        : phase(phase), class_id(class_id), start(trace_now()) {
+        std::copy(trace_counters, trace_counters + (size_t) trace_counter::count, counters);
+    }
+
+    startup_trace_scope::~startup_trace_scope() {
+        int64_t end = trace_now();
+        for (size_t i = 0; i < (size_t) trace_counter::count; i++) {
+            counters[i] = trace_counters[i] - counters[i];
+        }
+        write_trace_event(phase, class_id, start, end, counters);
+    }
+#endif
+
+#ifdef NATIVE_JVM_HUGE_PAGES
+#ifdef __linux__
+    static constexpr uintptr_t huge_page_size = 2 * 1024 * 1024;
+
+    struct text_segment {
+        uintptr_t start;
+        uintptr_t end;
+        // Start of the next segment; the dynamic linker reserves the space
+        // between the two, so it is ours to replace
+        uintptr_t limit;
+    };
+
+    static int find_text_segment(dl_phdr_info *info, size_t, void *data) {
+        uintptr_t self = reinterpret_cast<uintptr_t>(&find_text_segment);
+        text_segment *segment = static_cast<text_segment *>(data);
+        for (ElfW(Half) i = 0; i < info->dlpi_phnum; i++) {
+            const ElfW(Phdr) &header = info->dlpi_phdr[i];
+            uintptr_t start = info->dlpi_addr + header.p_vaddr;
+            if (header.p_type == PT_LOAD && (header.p_flags & PF_X) != 0
+                    && self >= start && self < start + header.p_memsz) {
+                segment->start = start;
+                segment->end = start + header.p_memsz;
+            }
+        }
+        if (segment->start == 0) {
+            return 0;
+        }
+        segment->limit = segment->end;
+        for (ElfW(Half) i = 0; i < info->dlpi_phnum; i++) {
+            const ElfW(Phdr) &header = info->dlpi_phdr[i];
+            uintptr_t start = info->dlpi_addr + header.p_vaddr;
+            if (header.p_type == PT_LOAD && start >= segment->end
+                    && (segment->limit == segment->end || start < segment->limit)) {
+                segment->limit = start;
+            }
+        }
+        return 1;
+    }
+
+    static bool huge_pages_available() {
+        FILE *file = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+        if (file == nullptr) {
+            return false;
+        }
+        char mode[128] = {};
+        size_t read = fread(mode, 1, sizeof(mode) - 1, file);
+        fclose(file);
+        return read > 0 && strstr(mode, "[never]") == nullptr;
+    }
+
+    bool remap_text_huge_pages() {
+        text_segment segment = {};
+        if (!huge_pages_available() || !dl_iterate_phdr(find_text_segment, &segment)) {
+            return false;
+        }
+        uintptr_t page_size = (uintptr_t) sysconf(_SC_PAGESIZE);
+        uintptr_t start = (segment.start + huge_page_size - 1) & ~(huge_page_size - 1);
+        uintptr_t mapped_end = (segment.end + page_size - 1) & ~(page_size - 1);
+        // Covers the tail up to the next huge page when the gap before the
+        // next segment allows it; otherwise the tail keeps its small pages
+        uintptr_t end = (mapped_end + huge_page_size - 1) & ~(huge_page_size - 1);
+        if (end > (segment.limit & ~(page_size - 1))) {
+            end = mapped_end & ~(huge_page_size - 1);
+        }
+        if (start >= end) {
+            return false;
+        }
+
+        // The copy starts on a huge page too, so mremap moves whole huge pages
+        size_t length = end - start;
+        void *raw = mmap(nullptr, length + huge_page_size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (raw == MAP_FAILED) {
+            return false;
+        }
+        uintptr_t raw_start = reinterpret_cast<uintptr_t>(raw);
+        uintptr_t copy_start = (raw_start + huge_page_size - 1) & ~(huge_page_size - 1);
+        if (copy_start > raw_start) {
+            munmap(raw, copy_start - raw_start);
+        }
+        munmap(reinterpret_cast<void *>(copy_start + length), raw_start + huge_page_size - copy_start);
+        void *copy = reinterpret_cast<void *>(copy_start);
+
+        madvise(copy, length, MADV_HUGEPAGE);
+        memcpy(copy, reinterpret_cast<const void *>(start), std::min(end, mapped_end) - start);
+        // This function is in the range being replaced: the swap is a single
+        // syscall and the code it returns to is byte for byte the same
+        if (mprotect(copy, length, PROT_READ | PROT_EXEC) != 0
+                || mremap(copy, length, length, MREMAP_MAYMOVE | MREMAP_FIXED,
+                          reinterpret_cast<void *>(start)) == MAP_FAILED) {
+            munmap(copy, length);
+            return false;
+        }
+        // Collapses whatever the fault path left in small pages, on Linux 6.1+
+        madvise(reinterpret_cast<void *>(start), length, MADV_COLLAPSE);
+        return true;
+    }
+#else
+    bool remap_text_huge_pages() {
+        return false;
+    }
+#endif
+#endif
+
     jstring get_interned(JNIEnv *env, jstring value) {
         jstring result = (jstring) env->CallObjectMethod(value, string_intern_method);
         if (env->ExceptionCheck())
@@ -429,6 +669,644 @@ namespace native_jvm::utils {
         return result;
     }
 
+    static inline size_t pool_offset(const pooled_string &text) {
+        return string_pool::get_section(text.section) + text.offset;
+    }
+
+    void resolve_strings(JNIEnv *env, const pooled_string *table, size_t count, jstring *out) {
+        // Bounds the local frame for classes with very many constants
+        const size_t batch = 256;
+        const unsigned char *pool = reinterpret_cast<const unsigned char *>(string_pool::get_pool());
+        std::vector<jchar> chars;
+        for (size_t start = 0; start < count; start += batch) {
+            size_t end = std::min(count, start + batch);
+            if (env->PushLocalFrame((jint) (2 * (end - start))) != 0) {
+                return;
+            }
+            for (size_t i = start; i < end; i++) {
+                const pooled_string &entry = table[i];
+                size_t offset = pool_offset(entry);
+                string_pool::decrypt_string(string_pool::decode_key(entry.key, entry.seed),
+                                            string_pool::decode_nonce(entry.nonce, entry.seed),
+                                            entry.seed, offset, entry.length);
+                // UTF-16LE with a null terminator; the pool offset may be odd
+                size_t length = entry.length / 2 - 1;
+                chars.resize(length);
+                for (size_t j = 0; j < length; j++) {
+                    chars[j] = (jchar) (pool[offset + 2 * j] | (pool[offset + 2 * j + 1] << 8));
+                }
+                jstring str = env->NewString(chars.data(), (jsize) length);
+                if (str == nullptr) {
+                    env->ExceptionClear();
+                    continue;
+                }
+                jstring interned = (jstring) env->CallObjectMethod(str, string_intern_method);
+                if (env->ExceptionCheck() || interned == nullptr) {
+                    env->ExceptionClear();
+                    continue;
+                }
+                out[i] = (jstring) env->NewGlobalRef(interned);
+            }
+            env->PopLocalFrame(nullptr);
+        }
+    }
+
+    static uint32_t fmix32(uint32_t h) {
+        h ^= h >> 16;
+        h *= 0x85EBCA6BU;
+        h ^= h >> 13;
+        h *= 0xC2B2AE35U;
+        h ^= h >> 16;
+        return h;
+    }
+
+    void prepare_string_switch(const string_switch &table) {
+        for (size_t i = 0; i < table.count; i++) {
+            const pooled_string &text = table.cases[i].text;
+            string_pool::decrypt_string(string_pool::decode_key(text.key, text.seed),
+                                        string_pool::decode_nonce(text.nonce, text.seed),
+                                        text.seed, pool_offset(text), text.length);
+        }
+    }
+
+    jint string_switch_index(JNIEnv *env, jstring value, const string_switch &table) {
+        jsize length = env->GetStringLength(value);
+        jchar small[64];
+        std::unique_ptr<jchar[]> large;
+        jchar *chars = small;
+        if (length > 64) {
+            large.reset(new jchar[length]);
+            chars = large.get();
+        }
+        env->GetStringRegion(value, 0, length, chars);
+        if (env->ExceptionCheck()) {
+            return -1;
+        }
+        uint32_t hash = 0;
+        for (jsize i = 0; i < length; i++) {
+            hash = 31 * hash + chars[i];
+        }
+        uint32_t displacement = table.displacements[fmix32(hash) & table.bucket_mask];
+        jint index = table.slots[fmix32(hash ^ (displacement * 0x9E3779B9U)) & table.slot_mask];
+        const unsigned char *pool = reinterpret_cast<const unsigned char *>(string_pool::get_pool());
+        for (; index >= 0 && (size_t) index < table.count && table.cases[index].hash == (jint) hash; index++) {
+            const pooled_string &text = table.cases[index].text;
+            if (text.length / 2 - 1 != (size_t) length) {
+                continue;
+            }
+            const unsigned char *bytes = pool + pool_offset(text);
+            jsize i = 0;
+            while (i < length && chars[i] == (jchar) (bytes[2 * i] | (bytes[2 * i + 1] << 8))) {
+                i++;
+            }
+            if (i == length) {
+                return table.cases[index].result;
+            }
+        }
+        return -1;
+    }
+
+    // Class, IDs and cached instances of one wrapper class, fetched on first use.
+    struct box_cache {
+        const char *class_name;
+        const char *value_of_sig;
+        const char *value_sig;
+        // Range that valueOf is required to cache (JLS 5.1.7), empty if none
+        jint low;
+        jint high;
+        std::atomic<bool> ready{false};
+        std::mutex lock{};
+        jclass clazz = nullptr;
+        jmethodID value_of = nullptr;
+        jfieldID value = nullptr;
+        jobject cached[256] = {};
+    };
+
+    static box_cache boolean_box { "java/lang/Boolean", "(Z)Ljava/lang/Boolean;", "Z", 0, 1 };
+    static box_cache byte_box { "java/lang/Byte", "(B)Ljava/lang/Byte;", "B", -128, 127 };
+    static box_cache char_box { "java/lang/Character", "(C)Ljava/lang/Character;", "C", 0, 127 };
+    static box_cache short_box { "java/lang/Short", "(S)Ljava/lang/Short;", "S", -128, 127 };
+    static box_cache int_box { "java/lang/Integer", "(I)Ljava/lang/Integer;", "I", -128, 127 };
+    static box_cache long_box { "java/lang/Long", "(J)Ljava/lang/Long;", "J", -128, 127 };
+    static box_cache float_box { "java/lang/Float", "(F)Ljava/lang/Float;", "F", 0, -1 };
+    static box_cache double_box { "java/lang/Double", "(D)Ljava/lang/Double;", "D", 0, -1 };
+
+    static jvalue box_argument(char type, jint value) {
+        jvalue arg;
+        switch (type) {
+            case 'Z': arg.z = (jboolean) value; break;
+            case 'B': arg.b = (jbyte) value; break;
+            case 'C': arg.c = (jchar) value; break;
+            case 'S': arg.s = (jshort) value; break;
+            case 'J': arg.j = value; break;
+            default: arg.i = value; break;
+        }
+        return arg;
+    }
+
+    // The cached range is filled by calling valueOf itself, so the global refs
+    // point at the JDK's own cache entries and boxes keep their identity.
+    static bool prepare_box_cache(JNIEnv *env, box_cache &cache) {
+        if (cache.ready.load(std::memory_order_acquire)) {
+            return true;
+        }
+        std::lock_guard<std::mutex> guard(cache.lock);
+        if (cache.ready.load(std::memory_order_relaxed)) {
+            return true;
+        }
+        jclass clazz = env->FindClass(cache.class_name);
+        if (clazz == nullptr) {
+            return false;
+        }
+        jmethodID value_of = env->GetStaticMethodID(clazz, "valueOf", cache.value_of_sig);
+        jfieldID value = value_of != nullptr ? env->GetFieldID(clazz, "value", cache.value_sig) : nullptr;
+        if (value == nullptr) {
+            env->DeleteLocalRef(clazz);
+            return false;
+        }
+        for (jint i = cache.low; i <= cache.high; i++) {
+            jvalue arg = box_argument(cache.value_sig[0], i);
+            jobject boxed = env->CallStaticObjectMethodA(clazz, value_of, &arg);
+            if (env->ExceptionCheck()) {
+                env->DeleteLocalRef(clazz);
+                return false;
+            }
+            if (cache.cached[i - cache.low] == nullptr) {
+                cache.cached[i - cache.low] = env->NewGlobalRef(boxed);
+            }
+            env->DeleteLocalRef(boxed);
+        }
+        cache.clazz = (jclass) env->NewGlobalRef(clazz);
+        cache.value_of = value_of;
+        cache.value = value;
+        env->DeleteLocalRef(clazz);
+        cache.ready.store(true, std::memory_order_release);
+        return true;
+    }
+
+    static jobject box(JNIEnv *env, box_cache &cache, jlong key, jvalue value) {
+        if (!prepare_box_cache(env, cache)) {
+            return nullptr;
+        }
+        if (key >= cache.low && key <= cache.high) {
+            return cache.cached[key - cache.low];
+        }
+        return env->CallStaticObjectMethodA(cache.clazz, cache.value_of, &value);
+    }
+
+    jobject box_boolean(JNIEnv *env, jboolean value) {
+        jvalue arg;
+        arg.z = value;
+        return box(env, boolean_box, value ? 1 : 0, arg);
+    }
+
+    jobject box_byte(JNIEnv *env, jbyte value) {
+        jvalue arg;
+        arg.b = value;
+        return box(env, byte_box, value, arg);
+    }
+
+    jobject box_char(JNIEnv *env, jchar value) {
+        jvalue arg;
+        arg.c = value;
+        return box(env, char_box, value, arg);
+    }
+
+    jobject box_short(JNIEnv *env, jshort value) {
+        jvalue arg;
+        arg.s = value;
+        return box(env, short_box, value, arg);
+    }
+
+    jobject box_int(JNIEnv *env, jint value) {
+        jvalue arg;
+        arg.i = value;
+        return box(env, int_box, value, arg);
+    }
+
+    jobject box_long(JNIEnv *env, jlong value) {
+        jvalue arg;
+        arg.j = value;
+        return box(env, long_box, value, arg);
+    }
+
+    jobject box_float(JNIEnv *env, jfloat value) {
+        jvalue arg;
+        arg.f = value;
+        return box(env, float_box, 0, arg);
+    }
+
+    jobject box_double(JNIEnv *env, jdouble value) {
+        jvalue arg;
+        arg.d = value;
+        return box(env, double_box, 0, arg);
+    }
+
+    jboolean unbox_boolean(JNIEnv *env, jobject value) {
+        return prepare_box_cache(env, boolean_box) ? env->GetBooleanField(value, boolean_box.value) : JNI_FALSE;
+    }
+
+    jbyte unbox_byte(JNIEnv *env, jobject value) {
+        return prepare_box_cache(env, byte_box) ? env->GetByteField(value, byte_box.value) : 0;
+    }
+
+    jchar unbox_char(JNIEnv *env, jobject value) {
+        return prepare_box_cache(env, char_box) ? env->GetCharField(value, char_box.value) : 0;
+    }
+
+    jshort unbox_short(JNIEnv *env, jobject value) {
+        return prepare_box_cache(env, short_box) ? env->GetShortField(value, short_box.value) : 0;
+    }
+
+    jint unbox_int(JNIEnv *env, jobject value) {
+        return prepare_box_cache(env, int_box) ? env->GetIntField(value, int_box.value) : 0;
+    }
+
+    jlong unbox_long(JNIEnv *env, jobject value) {
+        return prepare_box_cache(env, long_box) ? env->GetLongField(value, long_box.value) : 0;
+    }
+
+    jfloat unbox_float(JNIEnv *env, jobject value) {
+        return prepare_box_cache(env, float_box) ? env->GetFloatField(value, float_box.value) : 0;
+    }
+
+    jdouble unbox_double(JNIEnv *env, jobject value) {
+        return prepare_box_cache(env, double_box) ? env->GetDoubleField(value, double_box.value) : 0;
+    }
+
+    void prepare_concat(const concat_piece *pieces, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            if (pieces[i].kind != concat_kind::constant) {
+                continue;
+            }
+            const pooled_string &text = pieces[i].text;
+            string_pool::decrypt_string(string_pool::decode_key(text.key, text.seed),
+                                        string_pool::decode_nonce(text.nonce, text.seed),
+                                        text.seed, pool_offset(text), text.length);
+        }
+    }
+
+    // String.valueOf(float/double), and whether the JVM's Double.toString
+    // gives the shortest digits that round-trip, fetched on first use.
+    struct decimal_cache {
+        std::atomic<bool> ready{false};
+        std::mutex lock{};
+        jclass string_class = nullptr;
+        jmethodID value_of_float = nullptr;
+        jmethodID value_of_double = nullptr;
+        bool shortest = false;
+    };
+
+    static decimal_cache decimals;
+
+    // JDK 19 made Double.toString pick the shortest decimal (JDK-4511638);
+    // before that 2.0E23 printed as 2.0000000000000002E23.
+    static bool prepare_decimal_cache(JNIEnv *env) {
+        if (decimals.ready.load(std::memory_order_acquire)) {
+            return true;
+        }
+        std::lock_guard<std::mutex> guard(decimals.lock);
+        if (decimals.ready.load(std::memory_order_relaxed)) {
+            return true;
+        }
+        jclass string_class = env->FindClass("java/lang/String");
+        if (string_class == nullptr) {
+            return false;
+        }
+        jmethodID value_of_float = env->GetStaticMethodID(string_class, "valueOf", "(F)Ljava/lang/String;");
+        jmethodID value_of_double = value_of_float != nullptr
+                ? env->GetStaticMethodID(string_class, "valueOf", "(D)Ljava/lang/String;") : nullptr;
+        jstring probe = value_of_double != nullptr
+                ? (jstring) env->CallStaticObjectMethod(string_class, value_of_double, 2.0E23) : nullptr;
+        if (probe == nullptr) {
+            env->DeleteLocalRef(string_class);
+            return false;
+        }
+        const jchar expected[] = { '2', '.', '0', 'E', '2', '3' };
+        jchar actual[6] = {};
+        bool shortest = env->GetStringLength(probe) == 6;
+        if (shortest) {
+            env->GetStringRegion(probe, 0, 6, actual);
+            shortest = std::equal(expected, expected + 6, actual);
+        }
+        env->DeleteLocalRef(probe);
+        decimals.string_class = (jclass) env->NewGlobalRef(string_class);
+        decimals.value_of_float = value_of_float;
+        decimals.value_of_double = value_of_double;
+        decimals.shortest = shortest;
+        env->DeleteLocalRef(string_class);
+        decimals.ready.store(true, std::memory_order_release);
+        return true;
+    }
+
+    static bool parses_back(const char *text, float value) {
+        return std::strtof(text, nullptr) == value;
+    }
+
+    static bool parses_back(const char *text, double value) {
+        return std::strtod(text, nullptr) == value;
+    }
+
+    // Whether the decimal digits * 10^(exponent - count + 1) parses back to
+    // value. The text has no decimal point, which would follow the locale.
+    template <typename T>
+    static bool parses_back(const char *digits, int count, int exponent, T value) {
+        char text[40];
+        snprintf(text, sizeof(text), "%.*se%d", count, digits, exponent - count + 1);
+        return parses_back(text, value);
+    }
+
+    // Moves count digits to the next decimal of the same length above
+    // (direction 1) or below (direction -1).
+    static void step_digits(char *digits, int count, int &exponent, int direction) {
+        int i = count - 1;
+        if (direction > 0) {
+            for (; i >= 0 && digits[i] == '9'; i--) {
+                digits[i] = '0';
+            }
+            if (i >= 0) {
+                digits[i]++;
+            } else {
+                digits[0] = '1';
+                exponent++;
+            }
+            return;
+        }
+        for (; digits[i] == '0'; i--) {
+            digits[i] = '9';
+        }
+        digits[i]--;
+        if (digits[0] == '0') {
+            // 10..0 steps down to 9..9 one decade lower
+            std::memmove(digits, digits + 1, count - 1);
+            digits[count - 1] = '9';
+            exponent--;
+        }
+    }
+
+    // Writes the count digit decimal closest to a positive finite value that
+    // parses back to it, and returns false if there is none. The closest one
+    // on either side of value is the correctly rounded decimal or one of its
+    // neighbours; its neighbour away from value never parses back when it
+    // does not, and snprintf breaks ties to the even digit like Java.
+    template <typename T>
+    static bool closest_digits(T value, int count, char *digits, int &exponent) {
+        char text[40];
+        snprintf(text, sizeof(text), "%.*e", count - 1, (double) value);
+        const char *c = text;
+        int length = 0;
+        for (; *c != '\0' && *c != 'e'; c++) {
+            if (*c >= '0' && *c <= '9') {
+                digits[length++] = *c;
+            }
+        }
+        exponent = *c == 'e' ? std::atoi(c + 1) : 0;
+        if (parses_back(digits, count, exponent, value)) {
+            return true;
+        }
+        for (int direction = 1; direction >= -1; direction -= 2) {
+            char neighbour[24];
+            int neighbour_exponent = exponent;
+            std::memcpy(neighbour, digits, count);
+            step_digits(neighbour, count, neighbour_exponent, direction);
+            if (parses_back(neighbour, count, neighbour_exponent, value)) {
+                std::memcpy(digits, neighbour, count);
+                exponent = neighbour_exponent;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Writes the digits Double.toString picks since JDK 19: the shortest
+    // decimals that parse back to a positive finite value, at least two, and
+    // of those the closest to it. Returns the decimal exponent of the first.
+    // A length that has such a decimal is followed by longer ones that do,
+    // so it is found by binary search.
+    template <typename T>
+    static int shortest_digits(T value, int max_digits, char *digits, int &count) {
+        int exponent = 0;
+        int low = 1;
+        int high = max_digits;
+        while (low < high) {
+            int middle = (low + high) / 2;
+            if (closest_digits(value, middle, digits, exponent)) {
+                high = middle;
+            } else {
+                low = middle + 1;
+            }
+        }
+        count = std::max(low, 2);
+        closest_digits(value, count, digits, exponent);
+        while (count > 1 && digits[count - 1] == '0') {
+            count--;
+        }
+        return exponent;
+    }
+
+    static void append_ascii(std::vector<jchar> &out, const char *text) {
+        for (; *text != '\0'; text++) {
+            out.push_back((jchar) *text);
+        }
+    }
+
+    static void append_integer(std::vector<jchar> &out, jlong value) {
+        char text[24];
+        int length = 0;
+        uint64_t magnitude = value < 0 ? 0 - (uint64_t) value : (uint64_t) value;
+        do {
+            text[length++] = (char) ('0' + magnitude % 10);
+            magnitude /= 10;
+        } while (magnitude != 0);
+        if (value < 0) {
+            out.push_back('-');
+        }
+        while (length > 0) {
+            out.push_back((jchar) text[--length]);
+        }
+    }
+
+    // Lays the digits out like Double.toString: plain for magnitudes in
+    // [1e-3, 1e7), computerized scientific notation otherwise, and always
+    // with a digit after the point.
+    template <typename T>
+    static void append_decimal(std::vector<jchar> &out, T value, int max_digits) {
+        if (std::isnan(value)) {
+            append_ascii(out, "NaN");
+            return;
+        }
+        if (std::signbit(value)) {
+            out.push_back('-');
+            value = -value;
+        }
+        if (std::isinf(value)) {
+            append_ascii(out, "Infinity");
+            return;
+        }
+        if (value == 0) {
+            append_ascii(out, "0.0");
+            return;
+        }
+        char digits[24];
+        int count = 0;
+        int exponent = shortest_digits(value, max_digits, digits, count);
+        if (exponent >= -3 && exponent < 7) {
+            if (exponent < 0) {
+                append_ascii(out, "0.");
+                for (int i = -1; i > exponent; i--) {
+                    out.push_back('0');
+                }
+                for (int i = 0; i < count; i++) {
+                    out.push_back((jchar) digits[i]);
+                }
+                return;
+            }
+            for (int i = 0; i <= exponent; i++) {
+                out.push_back(i < count ? (jchar) digits[i] : (jchar) '0');
+            }
+            out.push_back('.');
+            if (count <= exponent + 1) {
+                out.push_back('0');
+            }
+            for (int i = exponent + 1; i < count; i++) {
+                out.push_back((jchar) digits[i]);
+            }
+            return;
+        }
+        out.push_back((jchar) digits[0]);
+        out.push_back('.');
+        if (count == 1) {
+            out.push_back('0');
+        }
+        for (int i = 1; i < count; i++) {
+            out.push_back((jchar) digits[i]);
+        }
+        out.push_back('E');
+        append_integer(out, exponent);
+    }
+
+    static bool append_string(JNIEnv *env, std::vector<jchar> &out, jstring value) {
+        if (value == nullptr) {
+            append_ascii(out, "null");
+            return true;
+        }
+        jsize length = env->GetStringLength(value);
+        size_t start = out.size();
+        out.resize(start + length);
+        env->GetStringRegion(value, 0, length, out.data() + start);
+        return !env->ExceptionCheck();
+    }
+
+    // Old JVMs only: formats through String.valueOf so the digits match
+    static bool append_value_of(JNIEnv *env, std::vector<jchar> &out, jmethodID value_of, jvalue value) {
+        jstring text = (jstring) env->CallStaticObjectMethodA(decimals.string_class, value_of, &value);
+        if (env->ExceptionCheck()) {
+            return false;
+        }
+        bool appended = append_string(env, out, text);
+        env->DeleteLocalRef(text);
+        return appended;
+    }
+
+    jstring concat(JNIEnv *env, const concat_piece *pieces, size_t count, const jvalue *args) {
+        std::vector<jchar> out;
+        out.reserve(64);
+        const unsigned char *pool = reinterpret_cast<const unsigned char *>(string_pool::get_pool());
+        size_t arg = 0;
+        for (size_t i = 0; i < count; i++) {
+            const concat_piece &piece = pieces[i];
+            switch (piece.kind) {
+                case concat_kind::constant: {
+                    const unsigned char *bytes = pool + pool_offset(piece.text);
+                    for (size_t j = 0; j + 1 < piece.text.length / 2; j++) {
+                        out.push_back((jchar) (bytes[2 * j] | (bytes[2 * j + 1] << 8)));
+                    }
+                    continue;
+                }
+                case concat_kind::string:
+                    if (!append_string(env, out, (jstring) args[arg].l)) {
+                        return nullptr;
+                    }
+                    break;
+                case concat_kind::int_value:
+                    append_integer(out, args[arg].i);
+                    break;
+                case concat_kind::long_value:
+                    append_integer(out, args[arg].j);
+                    break;
+                case concat_kind::boolean_value:
+                    append_ascii(out, args[arg].z ? "true" : "false");
+                    break;
+                case concat_kind::char_value:
+                    out.push_back(args[arg].c);
+                    break;
+                case concat_kind::float_value:
+                case concat_kind::double_value: {
+                    bool is_float = piece.kind == concat_kind::float_value;
+                    if (!prepare_decimal_cache(env)) {
+                        return nullptr;
+                    }
+                    if (!decimals.shortest) {
+                        if (!append_value_of(env, out, is_float ? decimals.value_of_float
+                                                                : decimals.value_of_double, args[arg])) {
+                            return nullptr;
+                        }
+                    } else if (is_float) {
+                        append_decimal(out, args[arg].f, 9);
+                    } else {
+                        append_decimal(out, args[arg].d, 17);
+                    }
+                    break;
+                }
+            }
+            arg++;
+        }
+        return env->NewString(out.data(), (jsize) out.size());
+    }
+
+    static std::vector<hidden_class_data> hidden_classes;
+    static std::unique_ptr<std::atomic<jclass>[]> hidden_class_refs;
+    static std::mutex hidden_classes_mtx;
+
+    void set_hidden_classes(const hidden_class_data *classes, size_t count) {
+        hidden_classes.assign(classes, classes + count);
+        hidden_class_refs.reset(new std::atomic<jclass>[count]());
+    }
+
+    jclass define_hidden_class(JNIEnv *env, jint index) {
+        if (index < 0 || (size_t) index >= hidden_classes.size() || hidden_classes[index].data == nullptr) {
+            return nullptr;
+        }
+        jclass defined = hidden_class_refs[index].load(std::memory_order_acquire);
+        if (defined == nullptr) {
+            std::lock_guard<std::mutex> guard(hidden_classes_mtx);
+            defined = hidden_class_refs[index].load(std::memory_order_relaxed);
+            if (defined == nullptr) {
+                NATIVE_JVM_TRACE_SCOPE("define_hidden_class", index);
+                const hidden_class_data &hidden = hidden_classes[index];
+                std::unique_ptr<jbyte[]> bytes(new jbyte[hidden.length]);
+                uint64_t key = hidden.key;
+                for (jsize i = 0; i < hidden.length; i++) {
+                    key = key * 6364136223846793005ULL + 1442695040888963407ULL;
+                    bytes[i] = (jbyte) (hidden.data[i] ^ (unsigned char) (key ^ (key >> 29)));
+                }
+                // The name is taken from the class bytes
+                jclass clazz = env->DefineClass(nullptr, nullptr, bytes.get(), hidden.length);
+                volatile jbyte *scratch = bytes.get();
+                for (jsize i = 0; i < hidden.length; i++) {
+                    scratch[i] = 0;
+                }
+                if (clazz == nullptr) {
+                    return nullptr;
+                }
+                defined = (jclass) env->NewGlobalRef(clazz);
+                env->DeleteLocalRef(clazz);
+                hidden_class_refs[index].store(defined, std::memory_order_release);
+            }
+        }
+        return (jclass) env->NewLocalRef(defined);
+    }
+
     void ensure_initialized(JNIEnv *env, jobject classloader, const char *class_name_dot) {
         // Use Class.forName(name, true, loader) to trigger class initialization.
         jclass class_class = env->FindClass("java/lang/Class");
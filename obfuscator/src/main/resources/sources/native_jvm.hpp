@@ -12,19 +12,31 @@
 #include <mutex>
 #include <initializer_list>
 #include <cstdint>
+#include <memory>
 
 #ifndef NATIVE_JVM_HPP_GUARD
 
 #define NATIVE_JVM_HPP_GUARD
 
+// GCC and Clang put hot functions in .text.hot and cold ones in
+// .text.unlikely, which the default linker scripts keep together, so the
+// helpers every transpiled call goes through share as few pages as possible.
+#if defined(__GNUC__) || defined(__clang__)
+#define NATIVE_JVM_HOT __attribute__((hot))
+#define NATIVE_JVM_COLD __attribute__((cold))
+#else
+#define NATIVE_JVM_HOT
+#define NATIVE_JVM_COLD
+#endif
+
 namespace native_jvm::utils {
 
-    void init_utils(JNIEnv *env);
+    NATIVE_JVM_COLD void init_utils(JNIEnv *env);
 
-    void debug_print_stack_state(JNIEnv *env, const char *context, int object_index, int return_index, int line);
-    void debug_print_int(JNIEnv *env, const char *context, jint value, int line);
+    NATIVE_JVM_COLD void debug_print_stack_state(JNIEnv *env, const char *context, int object_index, int return_index, int line);
+    NATIVE_JVM_COLD void debug_print_int(JNIEnv *env, const char *context, jint value, int line);
 
-    void throw_re(JNIEnv *env, const char *exception_class, const char *error, int line);
+    NATIVE_JVM_COLD void throw_re(JNIEnv *env, const char *exception_class, const char *error, int line);
 
     jobjectArray create_multidim_array(JNIEnv *env, jobject classloader, jint count, jint required_count,
         const char *class_name, int line, std::initializer_list<jint> sizes, int dim_index = 0);
@@ -80,7 +92,7 @@ namespace native_jvm::utils {
     }
 
 #ifdef USE_HOTSPOT
-    jobject link_call_site(JNIEnv *env, jobject caller_obj, jobject bootstrap_method_obj,
+    NATIVE_JVM_COLD jobject link_call_site(JNIEnv *env, jobject caller_obj, jobject bootstrap_method_obj,
             jobject name_obj, jobject type_obj, jobject static_arguments, jobject appendix_result);
 #endif
 
@@ -95,10 +107,187 @@ namespace native_jvm::utils {
     void bastore(JNIEnv *env, jarray array, jint index, jint value);
     jbyte baload(JNIEnv *env, jarray array, jint index);
 
-    void clear_refs(JNIEnv *env, std::unordered_set<jobject> &refs);
+    // Deletes every local ref in refs that is not one of the live slots.
+    NATIVE_JVM_HOT void clear_refs(JNIEnv *env, std::unordered_set<jobject> &refs, const jobject *live, size_t live_count);
+
+#ifdef NATIVE_JVM_REF_METRICS
+    // Tracks the peak size of a transpiled method's refs set. Peaks are
+    // aggregated per method and printed to stderr when the library unloads.
+    class ref_metrics_scope {
+    public:
+        ref_metrics_scope(const char *method, const std::unordered_set<jobject> &refs) : method(method), refs(refs) {}
+        ~ref_metrics_scope();
+
+        void sample() {
+            if (refs.size() > peak) {
+                peak = refs.size();
+            }
+        }
+
+    private:
+        const char *method;
+        const std::unordered_set<jobject> &refs;
+        size_t peak = 0;
+    };
+#endif
+
+#ifdef NATIVE_JVM_STARTUP_TRACE
+    enum class trace_counter { lookups, strings, natives, count };
+
+    // Counts JNI work done by the current thread, attributed to the
+    // enclosing startup_trace_scope.
+    void trace_add(trace_counter counter, size_t amount);
+
+    // Times one bootstrap phase with a monotonic clock. Each phase is written
+    // as a JSON line, with the JNI work done inside it, to the file named by
+    // the NATIVE_JVM_STARTUP_TRACE environment variable, or stderr.
+    class startup_trace_scope {
+    public:
+        explicit startup_trace_scope(const char *phase, jint class_id = -1);
+        ~startup_trace_scope();
+
+    private:
+        const char *phase;
+        jint class_id;
+        int64_t start;
+        size_t counters[(size_t) trace_counter::count];
+    };
+
+#define NATIVE_JVM_TRACE_SCOPE(...) native_jvm::utils::startup_trace_scope __ngen_trace_scope(__VA_ARGS__)
+#define NATIVE_JVM_TRACE_ADD(counter, amount) native_jvm::utils::trace_add(native_jvm::utils::trace_counter::counter, amount)
+#else
+#define NATIVE_JVM_TRACE_SCOPE(...) ((void) 0)
+#define NATIVE_JVM_TRACE_ADD(counter, amount) ((void) 0)
+#endif
+
+#ifdef NATIVE_JVM_HUGE_PAGES
+    // Copies the library's executable segment onto transparent huge pages and
+    // swaps the copy in for the file mapping, so hot code needs fewer i-TLB
+    // entries. Returns false with the mapping untouched where the platform,
+    // kernel or THP settings do not allow it. Runs before any other native
+    // code of the library, as nothing may execute it during the swap.
+    NATIVE_JVM_COLD bool remap_text_huge_pages();
+#endif
+
+    // Stores a constant array initializer emitted by ConstantArrayFill. data
+    // holds the element bits masked with an LCG keystream seeded with key.
+    template <typename T, typename A, typename B>
+    void fill_array(JNIEnv *env, A array, const B *data, jsize start, jsize count, uint64_t key,
+                    void (JNIEnv::*set)(A, jsize, jsize, const T *)) {
+        static_assert(sizeof(T) == sizeof(B), "element and data widths differ");
+        std::unique_ptr<T[]> values(new T[count]);
+        for (jsize i = 0; i < count; i++) {
+            key = key * 6364136223846793005ULL + 1442695040888963407ULL;
+            B bits = (B) (data[i] ^ (B) (key ^ (key >> 29)));
+            std::memcpy(&values[i], &bits, sizeof(T));
+        }
+        (env->*set)(array, start, count, values.get());
+    }
 
     jstring get_interned(JNIEnv *env, jstring value);
 
+    // A string pool entry, as passed to string_pool::decrypt_string. The
+    // offset is relative to the string pool section of the owning class.
+    struct pooled_string {
+        const unsigned char *key;
+        const unsigned char *nonce;
+        uint32_t seed;
+        uint32_t section;
+        size_t offset;
+        size_t length;
+    };
+
+    // Decrypts and interns count UTF-16 pool entries into global refs in out,
+    // which is indexed like table. Local refs are released a frame at a time,
+    // so each entry costs three JNI calls. Entries that fail to resolve stay null.
+    NATIVE_JVM_COLD void resolve_strings(JNIEnv *env, const pooled_string *table, size_t count, jstring *out);
+
+    // A case of a lowered string switch; text is a UTF-16 pool entry.
+    struct string_switch_case {
+        jint hash;
+        jint result;
+        pooled_string text;
+    };
+
+    // Perfect hash over the String.hashCode values of the cases, built by
+    // StringSwitchTable. Cases sharing a hash code are stored next to each other.
+    struct string_switch {
+        const string_switch_case *cases;
+        size_t count;
+        const uint32_t *displacements;
+        uint32_t bucket_mask;
+        const jint *slots;
+        uint32_t slot_mask;
+    };
+
+    // Decrypts the case texts once, before the first lookup.
+    NATIVE_JVM_COLD void prepare_string_switch(const string_switch &table);
+
+    // Returns the result of the case equal to value, or -1. Reads the string
+    // with one GetStringRegion call instead of hashCode and equals upcalls.
+    NATIVE_JVM_HOT jint string_switch_index(JNIEnv *env, jstring value, const string_switch &table);
+
+    // Box like the wrappers' valueOf. Values in the range valueOf must cache
+    // come from global refs to the JDK's own instances, so identity holds;
+    // other values call valueOf through a cached method ID.
+    NATIVE_JVM_HOT jobject box_boolean(JNIEnv *env, jboolean value);
+    NATIVE_JVM_HOT jobject box_byte(JNIEnv *env, jbyte value);
+    NATIVE_JVM_HOT jobject box_char(JNIEnv *env, jchar value);
+    NATIVE_JVM_HOT jobject box_short(JNIEnv *env, jshort value);
+    NATIVE_JVM_HOT jobject box_int(JNIEnv *env, jint value);
+    NATIVE_JVM_HOT jobject box_long(JNIEnv *env, jlong value);
+    NATIVE_JVM_HOT jobject box_float(JNIEnv *env, jfloat value);
+    NATIVE_JVM_HOT jobject box_double(JNIEnv *env, jdouble value);
+
+    // Unbox like the wrappers' xxxValue by reading the value field through a
+    // cached field ID. value must not be null.
+    NATIVE_JVM_HOT jboolean unbox_boolean(JNIEnv *env, jobject value);
+    NATIVE_JVM_HOT jbyte unbox_byte(JNIEnv *env, jobject value);
+    NATIVE_JVM_HOT jchar unbox_char(JNIEnv *env, jobject value);
+    NATIVE_JVM_HOT jshort unbox_short(JNIEnv *env, jobject value);
+    NATIVE_JVM_HOT jint unbox_int(JNIEnv *env, jobject value);
+    NATIVE_JVM_HOT jlong unbox_long(JNIEnv *env, jobject value);
+    NATIVE_JVM_HOT jfloat unbox_float(JNIEnv *env, jobject value);
+    NATIVE_JVM_HOT jdouble unbox_double(JNIEnv *env, jobject value);
+
+    // A piece of a lowered string concatenation. Constants are UTF-16 pool
+    // entries; every other kind takes the next argument and formats it like
+    // String.valueOf.
+    enum class concat_kind : uint8_t {
+        constant, string, int_value, long_value, float_value, double_value, boolean_value, char_value
+    };
+
+    struct concat_piece {
+        concat_kind kind;
+        pooled_string text;
+    };
+
+    // Decrypts the constants once, before the first concatenation.
+    NATIVE_JVM_COLD void prepare_concat(const concat_piece *pieces, size_t count);
+
+    // Builds the string with a single NewString call. Strings are read with
+    // GetStringRegion and primitives are formatted natively; float and double
+    // only where the JVM's Double.toString is the shortest round-trip one
+    // (JDK 19+), older JVMs format them with String.valueOf.
+    NATIVE_JVM_HOT jstring concat(JNIEnv *env, const concat_piece *pieces, size_t count, const jvalue *args);
+
+    // Class file of a hidden helper class, masked like fill_array data with
+    // an LCG keystream seeded with key.
+    struct hidden_class_data {
+        const unsigned char *data;
+        jsize length;
+        uint64_t key;
+    };
+
+    // Lists the hidden helper classes; prepare_lib calls this instead of
+    // defining them, so only the classes that are used are ever loaded.
+    NATIVE_JVM_COLD void set_hidden_classes(const hidden_class_data *classes, size_t count);
+
+    // Defines hidden class index with the bootstrap loader on first use and
+    // returns a new local ref to it, or null with an exception pending. The
+    // bytes are unmasked into a scratch buffer that is wiped after DefineClass.
+    NATIVE_JVM_COLD jclass define_hidden_class(JNIEnv *env, jint index);
+
     // Ensure the class identified by dot-style name is initialized.
     // This mirrors JVM semantics where getstatic/putstatic/invokestatic
     // trigger <clinit> on first use.
@@ -19,17 +19,23 @@ namespace native_jvm {
         if (!reg_methods[id]) {
             return;
         }
+        NATIVE_JVM_TRACE_SCOPE("register_class", id);
         reg_methods[id](env, clazz);
     }
 
     void prepare_lib(JNIEnv *env) {
-        utils::init_utils(env);
+        NATIVE_JVM_TRACE_SCOPE("prepare_lib");
+        {
+            NATIVE_JVM_TRACE_SCOPE("init_utils");
+            utils::init_utils(env);
+        }
         if (env->ExceptionCheck())
             return;
 
-        char* string_pool = string_pool::get_pool();
-
+        {
+            NATIVE_JVM_TRACE_SCOPE("prepare_tables");
 $register_code
+        }
 
         if (env->ExceptionCheck())
             return;
@@ -39,11 +45,20 @@ $register_code
         JNINativeMethod loader_methods[] = {
             { (char *) method_name, (char *) method_desc, (void *)&register_for_class }
         };
+        NATIVE_JVM_TRACE_ADD(lookups, 1);
+        NATIVE_JVM_TRACE_ADD(natives, 1);
         env->RegisterNatives(env->FindClass("$native_dir/Loader"), loader_methods, 1);
     }
 }
 
 extern "C" JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM *vm, void *reserved) {
+    NATIVE_JVM_TRACE_SCOPE("JNI_OnLoad");
+#ifdef NATIVE_JVM_HUGE_PAGES
+    {
+        NATIVE_JVM_TRACE_SCOPE("huge_pages");
+        native_jvm::utils::remap_text_huge_pages();
+    }
+#endif
     JNIEnv *env = nullptr;
     vm->GetEnv((void **)&env, JNI_VERSION_1_8);
     native_jvm::prepare_lib(env);
@@ -7,6 +7,7 @@
 namespace native_jvm::string_pool {
     static unsigned char pool[$size] = $value;
     static unsigned char decrypted[$size] = {};
+    static const std::size_t sections[$section_count] = { $sections };
 
     static inline uint32_t rotl(uint32_t v, int c) {
         return (v << c) | (v >> (32 - c));
@@ -62,38 +63,32 @@ namespace native_jvm::string_pool {
         }
     }
 
-    unsigned char *decode_key(const unsigned char in[32], uint32_t seed) {
-        auto *out = new unsigned char[32];
-        std::size_t i = 0;
-        unsigned char *ptr = out;
-        unsigned char tmp;
-        goto CHECK;
-    LOOP:
-        tmp = static_cast<unsigned char>(
-                vm::run_arith_vm(nullptr, vm::OP_XOR, in[i],
-                                  seed >> ((i & 3) * 8), seed));
-        *ptr++ = tmp;
-        ++i;
-    CHECK:
-        if (i < 32) goto LOOP;
+    // Unmasks count <= 32 bytes as in[i] ^ (seed >> ((i & 3) * 8)) with a
+    // single batched VM call, so each key or nonce costs one program build
+    static unsigned char *decode_bytes(const unsigned char *in, std::size_t count, uint32_t seed) {
+        int64_t lhs[32];
+        int64_t rhs[32];
+        int64_t mixed[32];
+        for (std::size_t i = 0; i < count; ++i) {
+            lhs[i] = in[i];
+            rhs[i] = seed >> ((i & 3) * 8);
+        }
+        vm::run_arith_vm_batch(nullptr, vm::OP_XOR, lhs, rhs, mixed, count, seed);
+        auto *out = new unsigned char[count];
+        for (std::size_t i = 0; i < count; ++i) {
+            out[i] = static_cast<unsigned char>(mixed[i]);
+        }
+        std::memset(lhs, 0, sizeof(lhs));
+        std::memset(mixed, 0, sizeof(mixed));
         return out;
     }
 
+    unsigned char *decode_key(const unsigned char in[32], uint32_t seed) {
+        return decode_bytes(in, 32, seed);
+    }
+
     unsigned char *decode_nonce(const unsigned char in[12], uint32_t seed) {
-        auto *out = new unsigned char[12];
-        std::size_t i = 0;
-        unsigned char *ptr = out;
-        unsigned char tmp;
-        goto N_CHECK;
-    N_LOOP:
-        tmp = static_cast<unsigned char>(
-                vm::run_arith_vm(nullptr, vm::OP_XOR, in[i],
-                                  seed >> ((i & 3) * 8), seed));
-        *ptr++ = tmp;
-        ++i;
-    N_CHECK:
-        if (i < 12) goto N_LOOP;
-        return out;
+        return decode_bytes(in, 12, seed);
     }
 
     void decrypt_string(unsigned char *key, unsigned char *nonce,
@@ -130,5 +125,9 @@ namespace native_jvm::string_pool {
     char *get_pool() {
         return reinterpret_cast<char *>(pool);
     }
+
+    std::size_t get_section(uint32_t section) {
+        return section < sizeof(sections) / sizeof(sections[0]) ? sections[section] : 0;
+    }
 }
 
@@ -0,0 +1,96 @@
+package by.radioegor146;
+
+import by.radioegor146.helpers.NativeTestHelper;
+import org.junit.jupiter.api.Test;
+import ru.gravit.launchserver.asm.ClassHierarchy;
+import ru.gravit.launchserver.asm.ClassMetadataReader;
+
+import java.nio.file.Files;
+import java.nio.file.Path;
+import java.util.Collections;
+import java.util.jar.JarFile;
+
+import static org.junit.jupiter.api.Assertions.*;
+
+/**
+ * Tests for the indexed class hierarchy used by {@code SafeClassWriter}.
+ */
+public class ClassHierarchyTest {
+
+    static class Base {
+    }
+
+    static class Left extends Base implements Runnable {
+        @Override
+        public void run() {
+        }
+    }
+
+    static class Right extends Base {
+    }
+
+    static class LeftChild extends Left {
+    }
+
+    private static String name(Class<?> clazz) {
+        return clazz.getName().replace('.', '/');
+    }
+
+    @Test
+    public void testCommonSuperClass() throws Exception {
+        Path jar = Files.createTempFile("hierarchy-", ".jar");
+        try {
+            NativeTestHelper.writeJar(jar, null, Base.class, Left.class, Right.class, LeftChild.class);
+            ClassMetadataReader reader = new ClassMetadataReader(Collections.singletonList(new JarFile(jar.toFile())));
+            try {
+                ClassHierarchy hierarchy = reader.getHierarchy();
+                assertEquals(name(Base.class), hierarchy.getCommonSuperClass(name(LeftChild.class), name(Right.class)));
+                assertEquals(name(Base.class), hierarchy.getCommonSuperClass(name(Right.class), name(LeftChild.class)));
+                assertEquals(name(Left.class), hierarchy.getCommonSuperClass(name(LeftChild.class), name(Left.class)));
+                assertEquals(name(Right.class), hierarchy.getCommonSuperClass(name(Right.class), name(Right.class)));
+                // Types outside the class path resolve as direct Object subclasses
+                assertEquals("java/lang/Object", hierarchy.getCommonSuperClass(name(Left.class), "java/lang/String"));
+
+                assertEquals(name(Left.class), reader.getSuperClass(name(LeftChild.class)));
+                assertNull(reader.getSuperClass("java/lang/Object"));
+                assertEquals(4, reader.getSuperClasses(name(LeftChild.class)).size());
+
+                int left = hierarchy.getId(name(Left.class));
+                int[] interfaces = hierarchy.getInterfaceIds(left);
+                assertEquals(1, interfaces.length);
+                assertEquals("java/lang/Runnable", hierarchy.getName(interfaces[0]));
+                assertEquals("java/lang/Object", hierarchy.getName(hierarchy.getSuperId(interfaces[0])));
+            } finally {
+                reader.close();
+            }
+        } finally {
+            Files.deleteIfExists(jar);
+        }
+    }
+
+    @Test
+    public void testQueriesAcrossTableGrowth() throws Exception {
+        Path jar = Files.createTempFile("hierarchy-", ".jar");
+        try {
+            NativeTestHelper.writeJar(jar, null, Base.class, Left.class);
+            ClassMetadataReader reader = new ClassMetadataReader(Collections.singletonList(new JarFile(jar.toFile())));
+            try {
+                ClassHierarchy hierarchy = reader.getHierarchy();
+                // Runnable only gets a slot here and is first read after the table grew
+                int runnable = hierarchy.getInterfaceIds(hierarchy.getId(name(Left.class)))[0];
+                // Each query resolves a new type, crossing the initial capacity of 256 and its doublings
+                for (int i = 0; i < 1100; i++) {
+                    assertEquals("java/lang/Object", reader.getSuperClass("missing/Type" + i));
+                    assertEquals(0, hierarchy.getAccess(hierarchy.getId("missing/Type" + i)));
+                }
+                assertEquals(0, hierarchy.getInterfaceIds(runnable).length);
+                assertEquals(hierarchy.getId("java/lang/Object"), hierarchy.getSuperId(runnable));
+                assertEquals(name(Base.class), hierarchy.getName(hierarchy.getSuperId(hierarchy.getId(name(Left.class)))));
+            } finally {
+                reader.close();
+            }
+        } finally {
+            Files.deleteIfExists(jar);
+        }
+    }
+}
@@ -0,0 +1,97 @@
+package by.radioegor146;
+
+import org.junit.jupiter.api.Test;
+import org.objectweb.asm.ClassReader;
+import org.objectweb.asm.Opcodes;
+import org.objectweb.asm.tree.AbstractInsnNode;
+import org.objectweb.asm.tree.ClassNode;
+import org.objectweb.asm.tree.MethodNode;
+
+import static org.junit.jupiter.api.Assertions.*;
+
+/**
+ * Array literals become one masked blob and a single region store.
+ */
+public class ConstantArrayFillTest {
+
+    static class Sample {
+        static int[] ints() {
+            return new int[]{3, -1, 100000, 7,
+                    8, 9};
+        }
+
+        static double[] doubles() {
+            return new double[]{1.5, 2.0};
+        }
+
+        static boolean[] booleans() {
+            return new boolean[]{true, false, true};
+        }
+
+        static int[] partial(int x) {
+            return new int[]{1, 2, x, 4};
+        }
+
+        static int[] single() {
+            return new int[]{1};
+        }
+    }
+
+    private static MethodNode method(String name) throws Exception {
+        ClassNode node = new ClassNode();
+        new ClassReader(Sample.class.getName()).accept(node, 0);
+        return node.methods.stream().filter(m -> m.name.equals(name)).findFirst().orElseThrow(AssertionError::new);
+    }
+
+    private static ConstantArrayFill match(MethodNode method) {
+        for (int i = 0; i < method.instructions.size(); i++) {
+            AbstractInsnNode insn = method.instructions.get(i);
+            if (insn.getOpcode() == Opcodes.NEWARRAY) {
+                return ConstantArrayFill.match(method.instructions, i,
+                        ConstantArrayFill.getReferencedLabels(method));
+            }
+        }
+        throw new AssertionError("no NEWARRAY in " + method.name);
+    }
+
+    @Test
+    public void testIntArray() throws Exception {
+        MethodNode method = method("ints");
+        ConstantArrayFill fill = match(method);
+        assertNotNull(fill);
+        assertEquals(6, fill.getCount());
+        assertEquals(Opcodes.IASTORE, method.instructions.get(fill.end).getOpcode());
+        String cpp = fill.toCpp("cstack0.l", 42);
+        assertTrue(cpp.startsWith("{ static const uint32_t __ngen_fill[] = { "));
+        assertTrue(cpp.endsWith("utils::fill_array(env, (jintArray) cstack0.l, __ngen_fill, 0, 6, 42ULL, &JNIEnv::SetIntArrayRegion); }"));
+        // Values are masked, not stored as is
+        assertFalse(cpp.contains("{ 3U, "));
+    }
+
+    @Test
+    public void testOtherTypes() throws Exception {
+        ConstantArrayFill doubles = match(method("doubles"));
+        assertNotNull(doubles);
+        assertTrue(doubles.toCpp("cstack0.l", 1).contains("static const uint64_t __ngen_fill[]"));
+        assertTrue(doubles.toCpp("cstack0.l", 1).contains("&JNIEnv::SetDoubleArrayRegion"));
+
+        ConstantArrayFill booleans = match(method("booleans"));
+        assertNotNull(booleans);
+        assertEquals(3, booleans.getCount());
+        assertTrue(booleans.toCpp("cstack0.l", 1).contains("(jbooleanArray) cstack0.l"));
+    }
+
+    @Test
+    public void testStopsAtNonConstant() throws Exception {
+        MethodNode method = method("partial");
+        ConstantArrayFill fill = match(method);
+        assertNotNull(fill);
+        assertEquals(2, fill.getCount());
+        assertEquals(Opcodes.DUP, method.instructions.get(fill.end + 1).getOpcode());
+    }
+
+    @Test
+    public void testShortRunIsKept() throws Exception {
+        assertNull(match(method("single")));
+    }
+}
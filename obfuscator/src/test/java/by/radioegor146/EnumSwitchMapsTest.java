@@ -0,0 +1,110 @@
+package by.radioegor146;
+
+import by.radioegor146.bytecode.EnumSwitchMaps;
+import by.radioegor146.bytecode.EnumSwitchPreprocessor;
+import by.radioegor146.bytecode.PreprocessorRunner;
+import by.radioegor146.bytecode.PreprocessorUtils;
+import org.junit.jupiter.api.Test;
+import org.objectweb.asm.ClassReader;
+import org.objectweb.asm.tree.AbstractInsnNode;
+import org.objectweb.asm.tree.ClassNode;
+import org.objectweb.asm.tree.FieldInsnNode;
+import org.objectweb.asm.tree.MethodInsnNode;
+import org.objectweb.asm.tree.MethodNode;
+
+import java.io.ByteArrayOutputStream;
+import java.io.IOException;
+import java.io.InputStream;
+
+import static org.junit.jupiter.api.Assertions.*;
+
+/**
+ * Enum switch maps are resolved from the holder and enum classes at build
+ * time, and the switch indexes a native table by ordinal.
+ */
+public class EnumSwitchMapsTest {
+
+    enum Color {
+        RED, GREEN, BLUE {
+            @Override
+            public String toString() {
+                return "blue";
+            }
+        }
+    }
+
+    static class Sample {
+        static int pick(Color color) {
+            switch (color) {
+                case BLUE:
+                    return 1;
+                case RED:
+                    return 2;
+                default:
+                    return 0;
+            }
+        }
+    }
+
+    private static byte[] readClass(String name) {
+        try (InputStream in = EnumSwitchMapsTest.class.getClassLoader().getResourceAsStream(name + ".class")) {
+            if (in == null) {
+                return null;
+            }
+            ByteArrayOutputStream out = new ByteArrayOutputStream();
+            byte[] buffer = new byte[4096];
+            for (int read; (read = in.read(buffer)) > 0; ) {
+                out.write(buffer, 0, read);
+            }
+            return out.toByteArray();
+        } catch (IOException ex) {
+            return null;
+        }
+    }
+
+    private static MethodNode pick() {
+        ClassNode node = new ClassNode();
+        new ClassReader(readClass(Sample.class.getName().replace('.', '/'))).accept(node, 0);
+        return node.methods.stream().filter(m -> m.name.equals("pick")).findFirst().orElseThrow(AssertionError::new);
+    }
+
+    private static FieldInsnNode findSwitchMap(MethodNode method) {
+        for (AbstractInsnNode insn : method.instructions) {
+            if (insn instanceof FieldInsnNode && ((FieldInsnNode) insn).name.startsWith("$SwitchMap$")) {
+                return (FieldInsnNode) insn;
+            }
+        }
+        return null;
+    }
+
+    @Test
+    public void testResolve() {
+        FieldInsnNode switchMap = findSwitchMap(pick());
+        assertNotNull(switchMap);
+        int[] map = new EnumSwitchMaps(EnumSwitchMapsTest::readClass).resolve(switchMap.owner, switchMap.name);
+        assertArrayEquals(new int[]{2, 0, 1}, map);
+        assertNull(new EnumSwitchMaps(name -> null).resolve(switchMap.owner, switchMap.name));
+    }
+
+    @Test
+    public void testPreprocessor() {
+        MethodNode method = pick();
+        PreprocessorRunner.setEnumSwitchMaps(new EnumSwitchMaps(EnumSwitchMapsTest::readClass));
+        try {
+            new EnumSwitchPreprocessor().process(null, method, Platform.HOTSPOT);
+        } finally {
+            PreprocessorRunner.setEnumSwitchMaps(new EnumSwitchMaps(name -> null));
+        }
+        assertNull(findSwitchMap(method));
+        MethodInsnNode marker = null;
+        for (AbstractInsnNode insn : method.instructions) {
+            if (PreprocessorUtils.isEnumSwitch(insn)) {
+                marker = (MethodInsnNode) insn;
+            } else if (insn instanceof MethodInsnNode) {
+                fail("call left in switch: " + ((MethodInsnNode) insn).name);
+            }
+        }
+        assertNotNull(marker);
+        assertArrayEquals(new int[]{2, 0, 1}, PreprocessorUtils.getEnumSwitchMap(marker));
+    }
+}
@@ -0,0 +1,166 @@
+package by.radioegor146;
+
+import by.radioegor146.helpers.NativeTestHelper;
+import by.radioegor146.helpers.ProcessHelper;
+import org.junit.jupiter.api.Test;
+
+import java.io.IOException;
+import java.nio.charset.StandardCharsets;
+import java.nio.file.Files;
+import java.nio.file.Path;
+import java.util.Arrays;
+import java.util.Collections;
+import java.util.HashSet;
+import java.util.LinkedHashMap;
+import java.util.List;
+import java.util.stream.Stream;
+
+import static org.junit.jupiter.api.Assertions.*;
+
+/**
+ * Oversized state machines are cut into part functions sharing a frame.
+ */
+public class FunctionSplitterTest {
+
+    public static class Sample {
+        public static void main(String[] args) {
+            System.out.println(collect(40));
+        }
+
+        // Enough states and loop frames to be split at a small size limit
+        public static int collect(int n) {
+            int total = 0;
+            for (int i = 0; i < n; i++) {
+                Object[] values = {String.valueOf(i), Integer.valueOf(i), new int[i % 3]};
+                for (Object value : values) {
+                    total += value.hashCode() == 0 ? 1 : value.getClass().getName().length();
+                }
+                if (i % 7 == 0) {
+                    total -= String.valueOf(total).length();
+                }
+            }
+            return total;
+        }
+    }
+
+    private static LinkedHashMap<Integer, StringBuilder> blocks(int count, int size) {
+        LinkedHashMap<Integer, StringBuilder> blocks = new LinkedHashMap<>();
+        for (int state = 0; state < count; state++) {
+            StringBuilder block = new StringBuilder();
+            while (block.length() < size) {
+                block.append("            cstack0.i = clocal").append(state % 2).append(".i;\n");
+            }
+            blocks.put(state, block);
+        }
+        return blocks;
+    }
+
+    @Test
+    public void testPartitionRespectsLimit() {
+        LinkedHashMap<Integer, StringBuilder> blocks = blocks(10, 100);
+        int limit = blocks.get(0).length() * 3;
+        List<List<Integer>> parts = FunctionSplitter.partition(blocks, Collections.emptySet(), limit);
+        assertEquals(4, parts.size());
+        assertEquals(Arrays.asList(0, 1, 2), parts.get(0));
+        assertEquals(Arrays.asList(9), parts.get(3));
+    }
+
+    @Test
+    public void testPartitionPrefersLeaders() {
+        LinkedHashMap<Integer, StringBuilder> blocks = blocks(8, 100);
+        int limit = blocks.get(0).length() * 4;
+        List<List<Integer>> parts = FunctionSplitter.partition(blocks, new HashSet<>(Arrays.asList(2, 6)), limit);
+        assertEquals(Arrays.asList(0, 1), parts.get(0));
+        assertEquals(Arrays.asList(2, 3, 4, 5), parts.get(1));
+        assertEquals(Arrays.asList(6, 7), parts.get(2));
+    }
+
+    @Test
+    public void testSmallMethodIsNotSplit() {
+        LinkedHashMap<Integer, StringBuilder> blocks = blocks(4, 100);
+        assertEquals(1, FunctionSplitter.partition(blocks, Collections.emptySet(),
+                FunctionSplitter.DEFAULT_MAX_FUNCTION_SIZE).size());
+    }
+
+    @Test
+    public void testLinearSplit() {
+        LinkedHashMap<Integer, StringBuilder> blocks = blocks(4, 50);
+        blocks.get(1).append("            __ngen_state = 3; break;\n");
+        List<List<Integer>> parts = Arrays.asList(Arrays.asList(0, 1), Arrays.asList(2, 3));
+        FunctionSplitter.Frame frame = new FunctionSplitter.Frame("__ngen_test", "jint", 1, 2,
+                Collections.singleton(7));
+        FunctionSplitter.Result result = FunctionSplitter.split(frame, blocks, parts, 0,
+                "            return (jint) 0;\n", null);
+
+        assertTrue(result.declarations.contains("struct __ngen_test_frame {"));
+        assertTrue(result.declarations.contains("jclass __ngen_local_class_7 = nullptr;"));
+        assertTrue(result.declarations.contains("static jint __ngen_test_part0(JNIEnv *env, __ngen_test_frame &__ngen_frame)"));
+        assertTrue(result.declarations.contains("static jint __ngen_test_part1(JNIEnv *env, __ngen_test_frame &__ngen_frame)"));
+        // Transitions leaving a part go through the frame
+        assertTrue(result.declarations.contains("{ __ngen_frame.state = 3; goto __ngen_exit; }"));
+        assertTrue(result.declarations.contains("jvalue &cstack0 = __ngen_frame.cstack0;"));
+        assertTrue(result.frameBinding.contains("jvalue &clocal0 = __ngen_frame.clocal0, &clocal1 = __ngen_frame.clocal1;"));
+        assertTrue(result.dispatcher.contains("case 0: case 1: {"));
+        assertTrue(result.dispatcher.contains("jint __ngen_ret = __ngen_test_part1(env, __ngen_frame);"));
+    }
+
+    @Test
+    public void testFlattenedSplit() {
+        LinkedHashMap<Integer, StringBuilder> blocks = blocks(4, 50);
+        List<List<Integer>> parts = Arrays.asList(Arrays.asList(0, 1), Arrays.asList(2, 3));
+        ControlFlowFlattener.StateObfuscation obfuscation = ControlFlowFlattener.createObfuscation("test");
+        FunctionSplitter.Frame frame = new FunctionSplitter.Frame("__ngen_test", "void", 1, 2,
+                Collections.emptySet());
+        FunctionSplitter.Result result = FunctionSplitter.split(frame, blocks, parts, 0,
+                "            return;\n", obfuscation);
+
+        assertTrue(result.declarations.contains("volatile int &__ngen_state = __ngen_frame.state;"));
+        assertTrue(result.dispatcher.contains("case " + obfuscation.encodeCase(2) + ": case "
+                + obfuscation.encodeCase(3) + ": {"));
+        assertTrue(result.dispatcher.contains("if (!__ngen_frame.resume) return;"));
+    }
+
+    @Test
+    public void testRefMetricsBound() {
+        LinkedHashMap<Integer, StringBuilder> blocks = blocks(4, 50);
+        blocks.get(3).append("#ifdef NATIVE_JVM_REF_METRICS\n    __ngen_ref_metrics.sample();\n#endif\n");
+        List<List<Integer>> parts = Arrays.asList(Arrays.asList(0, 1), Arrays.asList(2, 3));
+        FunctionSplitter.Frame frame = new FunctionSplitter.Frame("__ngen_test", "void", 1, 2,
+                Collections.emptySet());
+        FunctionSplitter.Result result = FunctionSplitter.split(frame, blocks, parts, 0,
+                "            return;\n", null);
+
+        assertTrue(result.declarations.contains("utils::ref_metrics_scope *ref_metrics = nullptr;"));
+        assertTrue(result.declarations.contains(
+                "utils::ref_metrics_scope &__ngen_ref_metrics = *__ngen_frame.ref_metrics;"));
+        assertTrue(result.dispatcher.contains("__ngen_frame.ref_metrics = &__ngen_ref_metrics;"));
+    }
+
+    @Test
+    public void testSplitMethodCompiles() throws Exception {
+        Path temp = Files.createTempDirectory("native-obfuscator-split-");
+        try {
+            Path jar = NativeTestHelper.writeJar(temp.resolve("test.jar"), Sample.class, Sample.class);
+            Path output = temp.resolve("output");
+            NativeObfuscator obfuscator = new NativeObfuscator();
+            obfuscator.setMaxFunctionSize(1024);
+            obfuscator.process(jar, output, Collections.emptyList(), Collections.emptyList(),
+                    null, "native_library", null, Platform.HOTSPOT, false, false, false, false, false);
+            try (Stream<Path> files = Files.walk(output.resolve("cpp"))) {
+                assertTrue(files.filter(p -> p.toString().endsWith(".cpp")).anyMatch(p -> {
+                    try {
+                        return new String(Files.readAllBytes(p), StandardCharsets.UTF_8).contains("_part1(");
+                    } catch (IOException ex) {
+                        throw new RuntimeException(ex);
+                    }
+                }), "method was not split");
+            }
+
+            NativeTestHelper.buildLibrary(output, "-DNATIVE_JVM_REF_METRICS=ON");
+            ProcessHelper.ProcessResult run = NativeTestHelper.runJar(output, "test.jar");
+            assertEquals(String.valueOf(Sample.collect(40)), run.stdout.trim());
+        } finally {
+            NativeTestHelper.deleteRecursively(temp);
+        }
+    }
+}
@@ -0,0 +1,76 @@
+package by.radioegor146;
+
+import by.radioegor146.instructions.TypeHandler;
+import org.junit.jupiter.api.Test;
+import org.objectweb.asm.ClassReader;
+import org.objectweb.asm.Opcodes;
+import org.objectweb.asm.tree.AbstractInsnNode;
+import org.objectweb.asm.tree.ClassNode;
+import org.objectweb.asm.tree.MethodInsnNode;
+import org.objectweb.asm.tree.MethodNode;
+import org.objectweb.asm.tree.TypeInsnNode;
+
+import static org.junit.jupiter.api.Assertions.*;
+
+/**
+ * NEW, DUP and the constructor call become a single NewObjectA when the
+ * arguments are plain loads and constants.
+ */
+public class FusedConstructorTest {
+
+    static class Sample {
+        static Object simple(int a, long b, String c) {
+            return new Pair(a, b, c);
+        }
+
+        static Object noArgs() {
+            return new StringBuilder();
+        }
+
+        static Object computedArgument(int a) {
+            return new Pair(a + 1, 2L, "x");
+        }
+
+        static Object nested(int a) {
+            return new Holder(new Pair(a, 3L, null));
+        }
+    }
+
+    static class Pair {
+        Pair(int a, long b, String c) {
+        }
+    }
+
+    static class Holder {
+        Holder(Object value) {
+        }
+    }
+
+    private static MethodInsnNode firstFusion(String name) throws Exception {
+        ClassNode node = new ClassNode();
+        new ClassReader(Sample.class.getName()).accept(node, 0);
+        MethodNode method = node.methods.stream().filter(m -> m.name.equals(name)).findFirst()
+                .orElseThrow(AssertionError::new);
+        for (AbstractInsnNode insn : method.instructions) {
+            if (insn.getOpcode() == Opcodes.NEW) {
+                return TypeHandler.findFusableConstructor((TypeInsnNode) insn);
+            }
+        }
+        throw new AssertionError("no NEW in " + name);
+    }
+
+    @Test
+    public void testLoadsAndConstants() throws Exception {
+        MethodInsnNode constructor = firstFusion("simple");
+        assertNotNull(constructor);
+        assertEquals("(IJLjava/lang/String;)V", constructor.desc);
+        assertNotNull(firstFusion("noArgs"));
+    }
+
+    @Test
+    public void testComputedArgumentsAreKept() throws Exception {
+        assertNull(firstFusion("computedArgument"));
+        // The outer allocation evaluates another NEW first
+        assertNull(firstFusion("nested"));
+    }
+}
@@ -0,0 +1,67 @@
+package by.radioegor146;
+
+import by.radioegor146.helpers.NativeTestHelper;
+import by.radioegor146.javaobf.JavaObfuscationConfig;
+import by.radioegor146.javaobf.JavaObfuscator;
+import org.junit.jupiter.api.Test;
+import org.objectweb.asm.ClassReader;
+import org.objectweb.asm.tree.ClassNode;
+
+import java.nio.file.Files;
+import java.nio.file.Path;
+import java.util.Collections;
+import java.util.jar.JarFile;
+import java.util.stream.Stream;
+
+import static org.junit.jupiter.api.Assertions.*;
+
+/**
+ * Java-layer and native obfuscation share one parse of each class and write
+ * no intermediate jar.
+ */
+public class FusedPipelineTest {
+
+    public static class Sample {
+        public static int loop(int n) {
+            int total = 0;
+            for (int i = 0; i < n; i++) {
+                total += i * 3;
+            }
+            return total;
+        }
+    }
+
+    private static String entryName() {
+        return Sample.class.getName().replace('.', '/') + ".class";
+    }
+
+    @Test
+    public void testObfuscateClassNodeInPlace() throws Exception {
+        ClassNode cn = new ClassNode();
+        new ClassReader(Sample.class.getName()).accept(cn, 0);
+        JavaObfuscationConfig config = new JavaObfuscationConfig(true, JavaObfuscationConfig.Strength.MEDIUM);
+        assertTrue(JavaObfuscator.obfuscate(cn, JavaObfuscator.createFilter(config, false), config));
+    }
+
+    @Test
+    public void testNoIntermediateJar() throws Exception {
+        Path temp = Files.createTempDirectory("native-obfuscator-fused-");
+        try {
+            Path jar = NativeTestHelper.writeJar(temp.resolve("input").resolve("app.jar"), null, Sample.class);
+
+            Path outputDir = temp.resolve("out");
+            new NativeObfuscator().process(jar, outputDir, Collections.emptyList(), Collections.emptyList(),
+                    null, null, null, Platform.HOTSPOT, false, false, false, false, false,
+                    true, "MEDIUM", Collections.emptyList(), Collections.emptyList(), true);
+
+            try (Stream<Path> files = Files.list(outputDir)) {
+                assertTrue(files.noneMatch(p -> p.getFileName().toString().startsWith("java-obf")));
+            }
+            try (JarFile result = new JarFile(outputDir.resolve("app.jar").toFile())) {
+                assertNotNull(result.getEntry(entryName()));
+            }
+        } finally {
+            NativeTestHelper.deleteRecursively(temp);
+        }
+    }
+}
@@ -0,0 +1,98 @@
+package by.radioegor146;
+
+import by.radioegor146.helpers.NativeTestHelper;
+import by.radioegor146.helpers.ProcessHelper;
+import org.junit.jupiter.api.Test;
+
+import java.io.IOException;
+import java.nio.charset.StandardCharsets;
+import java.nio.file.Files;
+import java.nio.file.Path;
+import java.nio.file.Paths;
+import java.util.Arrays;
+import java.util.Collections;
+import java.util.List;
+
+import static org.junit.jupiter.api.Assertions.*;
+import static org.junit.jupiter.api.Assumptions.assumeTrue;
+
+/**
+ * A native library built with {@code NATIVE_JVM_HUGE_PAGES} replaces its
+ * file-backed code mapping with an anonymous one advised for transparent
+ * huge pages.
+ */
+public class HugePageTextTest {
+
+    public static class Sample {
+        public static void main(String[] args) throws IOException {
+            System.out.println(compute(10));
+            System.out.println(findRemappedText());
+        }
+
+        public static int compute(int n) {
+            int total = 0;
+            for (int i = 0; i < n; i++) {
+                total += String.valueOf(i).length();
+            }
+            return total;
+        }
+
+        // Looks for an anonymous executable mapping inside the library's
+        // address range. AnonHugePages is not checked: it depends on how
+        // many free huge pages the machine has.
+        public static String findRemappedText() throws IOException {
+            List<String> lines = Files.readAllLines(Paths.get("/proc/self/smaps"), StandardCharsets.UTF_8);
+            long libraryStart = Long.MAX_VALUE;
+            long libraryEnd = 0;
+            for (String line : lines) {
+                String[] fields = line.trim().split("\\s+");
+                if (fields[0].matches("[0-9a-f]+-[0-9a-f]+") && line.contains("libnative_library")) {
+                    String[] range = fields[0].split("-");
+                    libraryStart = Math.min(libraryStart, Long.parseUnsignedLong(range[0], 16));
+                    libraryEnd = Math.max(libraryEnd, Long.parseUnsignedLong(range[1], 16));
+                }
+            }
+            boolean inside = false;
+            for (String line : lines) {
+                String[] fields = line.trim().split("\\s+");
+                if (fields[0].matches("[0-9a-f]+-[0-9a-f]+")) {
+                    long start = Long.parseUnsignedLong(fields[0].split("-")[0], 16);
+                    inside = fields.length == 5 && fields[1].equals("r-xp")
+                            && start >= libraryStart && start < libraryEnd;
+                } else if (inside && fields[0].equals("VmFlags:")) {
+                    return Arrays.asList(fields).contains("hg") ? "remapped" : "not advised";
+                }
+            }
+            return "not remapped";
+        }
+    }
+
+    private static boolean transparentHugePagesEnabled() {
+        try {
+            String mode = new String(Files.readAllBytes(Paths.get("/sys/kernel/mm/transparent_hugepage/enabled")),
+                    StandardCharsets.UTF_8);
+            return !mode.contains("[never]");
+        } catch (IOException ex) {
+            return false;
+        }
+    }
+
+    @Test
+    public void testTextRemapped() throws Exception {
+        assumeTrue(transparentHugePagesEnabled(), "transparent huge pages are not available");
+
+        Path temp = Files.createTempDirectory("native-obfuscator-huge-pages-");
+        try {
+            Path jar = NativeTestHelper.writeJar(temp.resolve("test.jar"), Sample.class, Sample.class);
+            Path output = temp.resolve("output");
+            new NativeObfuscator().process(jar, output, Collections.emptyList(), Collections.emptyList(),
+                    null, "native_library", null, Platform.HOTSPOT, false, false, false, false, false);
+
+            NativeTestHelper.buildLibrary(output, "-DNATIVE_JVM_HUGE_PAGES=ON");
+            ProcessHelper.ProcessResult run = NativeTestHelper.runJar(output, "test.jar");
+            assertEquals(Arrays.asList("10", "remapped"), Arrays.asList(run.stdout.trim().split("\\R")));
+        } finally {
+            NativeTestHelper.deleteRecursively(temp);
+        }
+    }
+}
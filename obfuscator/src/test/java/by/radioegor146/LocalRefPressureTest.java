@@ -0,0 +1,68 @@
+package by.radioegor146;
+
+import org.junit.jupiter.api.Test;
+import org.objectweb.asm.ClassReader;
+import org.objectweb.asm.tree.ClassNode;
+import org.objectweb.asm.tree.LabelNode;
+import org.objectweb.asm.tree.MethodNode;
+
+import java.util.Set;
+
+import static org.junit.jupiter.api.Assertions.*;
+
+/**
+ * Tests for the static local reference analysis used to size native frames
+ * and to place reference releases at loop headers.
+ */
+public class LocalRefPressureTest {
+
+    static class Sample {
+        static int straight(int a) {
+            return a + 1;
+        }
+
+        static int loop(String[] values) {
+            int total = 0;
+            for (String value : values) {
+                total += value.trim().length();
+            }
+            return total;
+        }
+
+        static Object allocations() {
+            Object a = new Object();
+            Object b = new StringBuilder().append(a).toString();
+            return new Object[]{a, b};
+        }
+    }
+
+    private static MethodNode method(String name) throws Exception {
+        ClassReader cr = new ClassReader(Sample.class.getName());
+        ClassNode cn = new ClassNode();
+        cr.accept(cn, 0);
+        return cn.methods.stream().filter(m -> m.name.equals(name)).findFirst().orElseThrow();
+    }
+
+    @Test
+    public void testStraightLineHasNoLoopHeaders() throws Exception {
+        assertTrue(MethodProcessor.findLoopHeaders(method("straight")).isEmpty());
+    }
+
+    @Test
+    public void testLoopHeaderDetected() throws Exception {
+        MethodNode mn = method("loop");
+        Set<LabelNode> headers = MethodProcessor.findLoopHeaders(mn);
+        assertEquals(1, headers.size());
+        LabelNode header = headers.iterator().next();
+        assertTrue(mn.instructions.indexOf(header) > 0);
+    }
+
+    @Test
+    public void testEstimateCountsReferenceProducers() throws Exception {
+        int straight = MethodProcessor.estimateLocalRefs(method("straight"));
+        int allocations = MethodProcessor.estimateLocalRefs(method("allocations"));
+        assertTrue(straight <= 16);
+        // two NEW, one ANEWARRAY and three object-returning calls on top of the prologue
+        assertTrue(allocations >= straight + 6);
+    }
+}
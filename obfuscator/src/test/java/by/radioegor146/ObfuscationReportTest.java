@@ -0,0 +1,56 @@
+package by.radioegor146;
+
+import org.junit.jupiter.api.Test;
+import org.objectweb.asm.ClassReader;
+import org.objectweb.asm.tree.ClassNode;
+import org.objectweb.asm.tree.MethodNode;
+
+import static org.junit.jupiter.api.Assertions.*;
+
+/**
+ * Tests for the per-method cost estimates and the JSON report format.
+ */
+public class ObfuscationReportTest {
+
+    static class Sample {
+        static int arithmetic(int a, int b) {
+            return a * b + 7;
+        }
+
+        static int calls(String value, int[] values) {
+            return value.trim().length() + values[0];
+        }
+    }
+
+    private static MethodNode method(String name) throws Exception {
+        ClassReader cr = new ClassReader(Sample.class.getName());
+        ClassNode cn = new ClassNode();
+        cr.accept(cn, 0);
+        return cn.methods.stream().filter(m -> m.name.equals(name)).findFirst().orElseThrow();
+    }
+
+    @Test
+    public void testJniEstimate() throws Exception {
+        assertEquals(0, ObfuscationReport.estimateJniCalls(method("arithmetic")));
+        // two invocations (call + exception check each) and one IALOAD
+        assertEquals(5, ObfuscationReport.estimateJniCalls(method("calls")));
+    }
+
+    @Test
+    public void testJson() throws Exception {
+        ObfuscationReport report = new ObfuscationReport();
+        report.addClass();
+        ObfuscationReport.MethodEntry entry = new ObfuscationReport.MethodEntry("a/B\"c", method("calls"));
+        entry.skip("excluded by filter");
+        report.add(entry);
+        report.setStringPool(42, 3);
+
+        String json = report.toJson();
+        assertTrue(json.contains("\"class\": \"a/B\\\"c\""));
+        assertTrue(json.contains("\"mode\": \"skipped\""));
+        assertTrue(json.contains("\"fallback\": \"excluded by filter\""));
+        assertTrue(json.contains("\"stringPoolBytes\": 42"));
+        assertTrue(report.getHotspots(5).isEmpty());
+        assertEquals(0, report.getJniCalls());
+    }
+}
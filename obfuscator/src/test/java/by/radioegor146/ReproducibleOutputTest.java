@@ -0,0 +1,147 @@
+package by.radioegor146;
+
+import by.radioegor146.helpers.NativeTestHelper;
+import org.junit.jupiter.api.Test;
+
+import java.io.IOException;
+import java.nio.file.Files;
+import java.nio.file.Path;
+import java.nio.file.Paths;
+import java.util.Arrays;
+import java.util.Collections;
+import java.util.List;
+import java.util.stream.Collectors;
+import java.util.stream.Stream;
+
+import static org.junit.jupiter.api.Assertions.*;
+
+/**
+ * Verifies that a configured seed makes the generated C++ sources and the
+ * output jar byte-for-byte identical across runs, and that the sources of a
+ * class do not change when another class does.
+ */
+public class ReproducibleOutputTest {
+
+    public static class Sample {
+        public static int sum(int[] values) {
+            int total = 0;
+            for (int value : values) {
+                total += value * 3 + 1;
+            }
+            return total;
+        }
+
+        public static String greet(String name) {
+            try {
+                return "Hello, " + name.trim() + "!";
+            } catch (RuntimeException ex) {
+                return "Hello!";
+            }
+        }
+    }
+
+    public static class Helper {
+        public static String describe(int value) {
+            return "value: " + value;
+        }
+    }
+
+    public static class EditedHelper {
+        public static String describe(int value) {
+            String label = value < 0 ? "negative value: " : "positive value: ";
+            return label + Integer.toHexString(value);
+        }
+    }
+
+    @Test
+    public void testSameSeedProducesIdenticalOutput() throws Exception {
+        Path temp = Files.createTempDirectory("native-obfuscator-repro-");
+        try {
+            Path jar = NativeTestHelper.writeJar(temp.resolve("input").resolve("app.jar"), null, Sample.class);
+
+            Path first = run(jar, temp.resolve("out1"), 1234L);
+            Path second = run(jar, temp.resolve("out2"), 1234L);
+            Path other = run(jar, temp.resolve("out3"), 4321L);
+
+            assertSameOutput(first, second);
+
+            assertFalse(Arrays.equals(Files.readAllBytes(first.resolve("cpp/string_pool.cpp")),
+                    Files.readAllBytes(other.resolve("cpp/string_pool.cpp"))));
+        } finally {
+            NativeTestHelper.deleteRecursively(temp);
+        }
+    }
+
+    @Test
+    public void testSameSeedWithAllProtectionsProducesIdenticalOutput() throws Exception {
+        Path temp = Files.createTempDirectory("native-obfuscator-repro-");
+        try {
+            Path jar = NativeTestHelper.writeJar(temp.resolve("input").resolve("app.jar"), null, Sample.class);
+
+            // Java-layer flattening, virtualization and native flattening all draw their own keys
+            assertSameOutput(runProtected(jar, temp.resolve("out1"), 1234L),
+                    runProtected(jar, temp.resolve("out2"), 1234L));
+        } finally {
+            NativeTestHelper.deleteRecursively(temp);
+        }
+    }
+
+    @Test
+    public void testEditingClassKeepsOtherClassSources() throws Exception {
+        Path temp = Files.createTempDirectory("native-obfuscator-repro-");
+        try {
+            // Sample comes first in both jars, so it keeps class index 0
+            Path firstJar = NativeTestHelper.writeJar(temp.resolve("input1").resolve("app.jar"), null,
+                    Sample.class, Helper.class);
+            Path secondJar = NativeTestHelper.writeJar(temp.resolve("input2").resolve("app.jar"), null,
+                    Sample.class, EditedHelper.class);
+            Path first = run(firstJar, temp.resolve("out1"), 1234L);
+            Path second = run(secondJar, temp.resolve("out2"), 1234L);
+
+            List<Path> files = listFiles(first.resolve("cpp/output")).stream()
+                    .filter(file -> file.toString().contains("Sample") || file.toString().endsWith("Hidden0.cpp"))
+                    .collect(Collectors.toList());
+            assertFalse(files.isEmpty());
+            for (Path file : files) {
+                Path output = Paths.get("cpp/output").resolve(file);
+                assertArrayEquals(Files.readAllBytes(first.resolve(output)), Files.readAllBytes(second.resolve(output)),
+                        "Output of an unchanged class differs: " + file);
+            }
+        } finally {
+            NativeTestHelper.deleteRecursively(temp);
+        }
+    }
+
+    private static Path run(Path jar, Path outputDir, long seed) throws IOException {
+        NativeObfuscator obfuscator = new NativeObfuscator();
+        obfuscator.setSeed(seed);
+        obfuscator.process(jar, outputDir, Collections.emptyList(), Collections.emptyList(),
+                null, null, null, Platform.HOTSPOT, false, false, false, false, true);
+        return outputDir;
+    }
+
+    private static Path runProtected(Path jar, Path outputDir, long seed) throws IOException {
+        NativeObfuscator obfuscator = new NativeObfuscator();
+        obfuscator.setSeed(seed);
+        obfuscator.process(jar, outputDir, Collections.emptyList(), Collections.emptyList(),
+                null, null, null, Platform.HOTSPOT, false, false, true, false, true,
+                true, "HIGH", Collections.emptyList(), Collections.emptyList(), true);
+        return outputDir;
+    }
+
+    private static void assertSameOutput(Path first, Path second) throws IOException {
+        List<Path> files = listFiles(first);
+        assertFalse(files.isEmpty());
+        assertEquals(files, listFiles(second));
+        for (Path file : files) {
+            assertArrayEquals(Files.readAllBytes(first.resolve(file)), Files.readAllBytes(second.resolve(file)),
+                    "Output differs between runs: " + file);
+        }
+    }
+
+    private static List<Path> listFiles(Path root) throws IOException {
+        try (Stream<Path> walk = Files.walk(root)) {
+            return walk.filter(Files::isRegularFile).map(root::relativize).sorted().collect(Collectors.toList());
+        }
+    }
+}
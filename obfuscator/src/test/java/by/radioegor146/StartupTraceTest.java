@@ -0,0 +1,62 @@
+package by.radioegor146;
+
+import by.radioegor146.helpers.NativeTestHelper;
+import by.radioegor146.helpers.ProcessHelper;
+import org.junit.jupiter.api.Test;
+
+import java.nio.file.Files;
+import java.nio.file.Path;
+import java.util.Arrays;
+import java.util.Collections;
+import java.util.List;
+
+import static org.junit.jupiter.api.Assertions.*;
+
+/**
+ * A native library built with {@code NATIVE_JVM_STARTUP_TRACE} writes one
+ * event per bootstrap phase and per registered class.
+ */
+public class StartupTraceTest {
+
+    public static class Sample {
+        public static void main(String[] args) {
+            System.out.println(compute(10));
+        }
+
+        public static int compute(int n) {
+            int total = 0;
+            for (int i = 0; i < n; i++) {
+                total += String.valueOf(i).length();
+            }
+            return total;
+        }
+    }
+
+    @Test
+    public void testTraceWritten() throws Exception {
+        Path temp = Files.createTempDirectory("native-obfuscator-trace-");
+        try {
+            Path jar = NativeTestHelper.writeJar(temp.resolve("test.jar"), Sample.class, Sample.class);
+            Path output = temp.resolve("output");
+            new NativeObfuscator().process(jar, output, Collections.emptyList(), Collections.emptyList(),
+                    null, "native_library", null, Platform.HOTSPOT, false, false, false, false, false);
+
+            NativeTestHelper.buildLibrary(output, "-DNATIVE_JVM_STARTUP_TRACE=ON");
+            Path trace = temp.resolve("trace.jsonl");
+            ProcessHelper.ProcessResult run = NativeTestHelper.runJar(output, "test.jar",
+                    Collections.singletonMap("NATIVE_JVM_STARTUP_TRACE", trace.toString()));
+            assertEquals("10", run.stdout.trim());
+
+            List<String> events = Files.readAllLines(trace);
+            for (String phase : Arrays.asList("library_loaded", "JNI_OnLoad", "prepare_lib", "init_utils",
+                    "register_class")) {
+                assertTrue(events.stream().anyMatch(e -> e.startsWith("{\"phase\":\"" + phase + "\"")),
+                        "missing phase " + phase + " in " + events);
+            }
+            String initUtils = events.stream().filter(e -> e.contains("\"init_utils\"")).findFirst().orElse("");
+            assertFalse(initUtils.contains("\"lookups\":0,"), initUtils);
+        } finally {
+            NativeTestHelper.deleteRecursively(temp);
+        }
+    }
+}
@@ -0,0 +1,81 @@
+package by.radioegor146;
+
+import by.radioegor146.bytecode.PreprocessorUtils;
+import by.radioegor146.bytecode.StringConcatPreprocessor;
+import org.junit.jupiter.api.Test;
+import org.objectweb.asm.ClassReader;
+import org.objectweb.asm.Type;
+import org.objectweb.asm.tree.AbstractInsnNode;
+import org.objectweb.asm.tree.ClassNode;
+import org.objectweb.asm.tree.MethodInsnNode;
+import org.objectweb.asm.tree.MethodNode;
+
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.List;
+
+import static org.junit.jupiter.api.Assertions.*;
+
+/**
+ * StringBuilder chains over primitives and strings become one native
+ * concatenation, with constant text folded into the marker.
+ */
+public class StringConcatPreprocessorTest {
+
+    static class Sample {
+        static String describe(String name, int count, long total, double ratio, char grade) {
+            return "name=" + name + ", count=" + count + ", total=" + total + ", ratio=" + ratio + grade;
+        }
+
+        static String escaping(Object value) {
+            return "value=" + value;
+        }
+
+        static String kept(int count) {
+            StringBuilder builder = new StringBuilder("count=");
+            builder.append(count);
+            return builder.toString();
+        }
+    }
+
+    private static MethodNode process(String name) throws Exception {
+        ClassNode node = new ClassNode();
+        new ClassReader(Sample.class.getName()).accept(node, 0);
+        MethodNode method = node.methods.stream().filter(m -> m.name.equals(name)).findFirst()
+                .orElseThrow(AssertionError::new);
+        new StringConcatPreprocessor().process(node, method, Platform.HOTSPOT);
+        return method;
+    }
+
+    private static List<MethodInsnNode> getCalls(MethodNode method) {
+        List<MethodInsnNode> calls = new ArrayList<>();
+        for (AbstractInsnNode insn : method.instructions) {
+            if (insn instanceof MethodInsnNode) {
+                calls.add((MethodInsnNode) insn);
+            }
+        }
+        return calls;
+    }
+
+    @Test
+    public void testChain() throws Exception {
+        List<MethodInsnNode> calls = getCalls(process("describe"));
+        assertEquals(1, calls.size());
+        MethodInsnNode marker = calls.get(0);
+        assertTrue(PreprocessorUtils.isStringConcat(marker));
+        assertEquals(Arrays.asList("name=", ", count=", ", total=", ", ratio=", "", ""),
+                PreprocessorUtils.getStringConcatConstants(marker));
+        assertEquals("(Ljava/lang/String;IJDC)Ljava/lang/String;", marker.desc);
+        assertEquals(Type.getType(String.class), Type.getReturnType(marker.desc));
+    }
+
+    @Test
+    public void testUnsupportedLeftAlone() throws Exception {
+        for (String name : Arrays.asList("escaping", "kept")) {
+            List<MethodInsnNode> calls = getCalls(process(name));
+            assertTrue(calls.stream().noneMatch(PreprocessorUtils::isStringConcat), name);
+            assertTrue(calls.stream().anyMatch(call -> call.owner.equals("java/lang/StringBuilder")
+                    && call.name.equals("toString")), name);
+        }
+    }
+}
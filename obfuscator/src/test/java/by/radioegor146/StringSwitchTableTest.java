@@ -0,0 +1,75 @@
+package by.radioegor146;
+
+import by.radioegor146.bytecode.PreprocessorUtils;
+import by.radioegor146.bytecode.StringSwitchPreprocessor;
+import org.junit.jupiter.api.Test;
+import org.objectweb.asm.ClassReader;
+import org.objectweb.asm.Opcodes;
+import org.objectweb.asm.tree.AbstractInsnNode;
+import org.objectweb.asm.tree.ClassNode;
+import org.objectweb.asm.tree.MethodInsnNode;
+import org.objectweb.asm.tree.MethodNode;
+
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.List;
+
+import static org.junit.jupiter.api.Assertions.*;
+
+/**
+ * String switches become one native perfect-hash lookup instead of hashCode
+ * and equals upcalls.
+ */
+public class StringSwitchTableTest {
+
+    static class Sample {
+        static int colliding(String value) {
+            switch (value) {
+                case "Aa":
+                    return 10;
+                case "BB":
+                    return 20;
+                case "other":
+                    return 30;
+                default:
+                    return 0;
+            }
+        }
+    }
+
+    @Test
+    public void testLookup() {
+        List<String> cases = new ArrayList<>(Arrays.asList("Aa", "BB", "AaAa", "BBBB", "AaBB", "", "x"));
+        for (int i = 0; i < 100; i++) {
+            cases.add("case" + i);
+        }
+        StringSwitchTable table = StringSwitchTable.build(cases);
+        for (int i = 0; i < cases.size(); i++) {
+            assertEquals(i, table.lookup(cases.get(i)));
+        }
+        assertEquals(-1, table.lookup("missing"));
+        // Same hash code as "Aa" and "BB"
+        assertEquals(-1, table.lookup("C#"));
+    }
+
+    @Test
+    public void testPreprocessor() throws Exception {
+        ClassNode node = new ClassNode();
+        new ClassReader(Sample.class.getName()).accept(node, 0);
+        MethodNode method = node.methods.stream().filter(m -> m.name.equals("colliding")).findFirst()
+                .orElseThrow(AssertionError::new);
+        new StringSwitchPreprocessor().process(node, method, Platform.HOTSPOT);
+
+        MethodInsnNode marker = null;
+        for (AbstractInsnNode insn : method.instructions) {
+            if (PreprocessorUtils.isStringSwitch(insn)) {
+                marker = (MethodInsnNode) insn;
+            } else if (insn instanceof MethodInsnNode) {
+                fail("call left in switch: " + ((MethodInsnNode) insn).name);
+            }
+        }
+        assertNotNull(marker);
+        assertEquals(Arrays.asList("Aa", "BB", "other"), PreprocessorUtils.getStringSwitchCases(marker));
+        assertEquals(Opcodes.ISTORE, marker.getNext().getOpcode());
+    }
+}
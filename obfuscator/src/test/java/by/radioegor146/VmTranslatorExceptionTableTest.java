@@ -0,0 +1,69 @@
+package by.radioegor146;
+
+import by.radioegor146.instructions.VmTranslator;
+import by.radioegor146.instructions.VmTranslator.Instruction;
+import by.radioegor146.instructions.VmTranslator.VmOpcodes;
+import org.junit.jupiter.api.Test;
+import org.objectweb.asm.ClassReader;
+import org.objectweb.asm.tree.ClassNode;
+import org.objectweb.asm.tree.MethodNode;
+
+import java.util.List;
+
+import static org.junit.jupiter.api.Assertions.*;
+
+/**
+ * Exception tables are carried over from bytecode with pcs in VM
+ * instruction space.
+ */
+public class VmTranslatorExceptionTableTest {
+
+    static class Sample {
+        static int safeDiv(int a, int b) {
+            try {
+                return a / b;
+            } catch (ArithmeticException e) {
+                return -1;
+            }
+        }
+
+        static int plain(int a, int b) {
+            return a + b;
+        }
+    }
+
+    private static MethodNode method(String name) throws Exception {
+        ClassNode cn = new ClassNode();
+        new ClassReader(Sample.class.getName()).accept(cn, 0);
+        return cn.methods.stream().filter(m -> m.name.equals(name)).findFirst().orElseThrow();
+    }
+
+    @Test
+    public void testTryCatchTranslated() throws Exception {
+        VmTranslator translator = new VmTranslator();
+        Instruction[] code = translator.translate(method("safeDiv"));
+        assertNotNull(code);
+
+        List<VmTranslator.ExceptionTableEntry> table = translator.getExceptionTable();
+        assertEquals(1, table.size());
+        VmTranslator.ExceptionTableEntry entry = table.get(0);
+        assertEquals("java/lang/ArithmeticException", entry.catchType);
+        assertTrue(entry.startPc < entry.endPc);
+
+        boolean coversDiv = false;
+        for (int pc = entry.startPc; pc < entry.endPc; pc++) {
+            coversDiv |= code[pc].opcode == VmOpcodes.OP_DIV;
+        }
+        assertTrue(coversDiv);
+        // The handler starts by storing the caught exception
+        assertEquals(VmOpcodes.OP_ASTORE, code[entry.handlerPc].opcode);
+    }
+
+    @Test
+    public void testTableResetBetweenMethods() throws Exception {
+        VmTranslator translator = new VmTranslator();
+        assertNotNull(translator.translate(method("safeDiv")));
+        assertNotNull(translator.translate(method("plain")));
+        assertTrue(translator.getExceptionTable().isEmpty());
+    }
+}
@@ -0,0 +1,107 @@
+package by.radioegor146.helpers;
+
+import java.io.IOException;
+import java.io.InputStream;
+import java.io.OutputStream;
+import java.nio.file.Files;
+import java.nio.file.Path;
+import java.util.Arrays;
+import java.util.Collections;
+import java.util.Comparator;
+import java.util.List;
+import java.util.Map;
+import java.util.jar.Attributes;
+import java.util.jar.JarEntry;
+import java.util.jar.JarOutputStream;
+import java.util.jar.Manifest;
+import java.util.stream.Collectors;
+import java.util.stream.Stream;
+
+/**
+ * End-to-end harness for tests that obfuscate a few of their own classes,
+ * build the generated library with CMake and run the result.
+ */
+public class NativeTestHelper {
+
+    /**
+     * Writes the class files of {@code classes} to {@code jar}. With a
+     * {@code mainClass} the jar gets a manifest and can be run with -jar.
+     */
+    public static Path writeJar(Path jar, Class<?> mainClass, Class<?>... classes) throws IOException {
+        Files.createDirectories(jar.getParent());
+        Manifest manifest = new Manifest();
+        manifest.getMainAttributes().put(Attributes.Name.MANIFEST_VERSION, "1.0");
+        if (mainClass != null) {
+            manifest.getMainAttributes().put(Attributes.Name.MAIN_CLASS, mainClass.getName());
+        }
+        OutputStream stream = Files.newOutputStream(jar);
+        try (JarOutputStream out = mainClass != null ? new JarOutputStream(stream, manifest)
+                : new JarOutputStream(stream)) {
+            for (Class<?> clazz : classes) {
+                String entryName = clazz.getName().replace('.', '/') + ".class";
+                try (InputStream in = clazz.getResourceAsStream("/" + entryName)) {
+                    if (in == null) {
+                        throw new IOException("Class file not found: " + entryName);
+                    }
+                    out.putNextEntry(new JarEntry(entryName));
+                    byte[] buffer = new byte[4096];
+                    for (int r = in.read(buffer); r != -1; r = in.read(buffer)) {
+                        out.write(buffer, 0, r);
+                    }
+                    out.closeEntry();
+                }
+            }
+        }
+        return jar;
+    }
+
+    /**
+     * Builds the sources the obfuscator wrote to {@code output}/cpp with the
+     * given CMake options and copies the library next to the output jar.
+     */
+    public static void buildLibrary(Path output, String... cmakeOptions) throws IOException {
+        Path cpp = output.resolve("cpp");
+        List<String> prepare = Stream.concat(Stream.of("cmake"),
+                Stream.concat(Arrays.stream(cmakeOptions), Stream.of("."))).collect(Collectors.toList());
+        ProcessHelper.run(cpp, 120_000, prepare).check("CMake prepare");
+        ProcessHelper.run(cpp, 160_000, Arrays.asList("cmake", "--build", ".", "--config", "Release"))
+                .check("CMake build");
+        try (Stream<Path> libs = Files.list(cpp.resolve("build").resolve("lib"))) {
+            for (Path lib : libs.filter(Files::isRegularFile).collect(Collectors.toList())) {
+                Files.copy(lib, output.resolve(lib.getFileName()));
+            }
+        }
+    }
+
+    /**
+     * Runs the obfuscated {@code jarName} in {@code output} against the built
+     * library and checks that it exited normally.
+     */
+    public static ProcessHelper.ProcessResult runJar(Path output, String jarName) throws IOException {
+        return runJar(output, jarName, Collections.emptyMap());
+    }
+
+    public static ProcessHelper.ProcessResult runJar(Path output, String jarName,
+                                                     Map<String, String> environment) throws IOException {
+        ProcessHelper.ProcessResult result = ProcessHelper.run(output, 60_000,
+                Arrays.asList("java", "-Djava.library.path=.", "-jar", output.resolve(jarName).toString()),
+                environment);
+        result.check("Test run");
+        return result;
+    }
+
+    /**
+     * Deletes {@code root} and everything below it, ignoring files that
+     * cannot be removed.
+     */
+    public static void deleteRecursively(Path root) throws IOException {
+        try (Stream<Path> walk = Files.walk(root)) {
+            walk.sorted(Comparator.reverseOrder()).forEach(p -> {
+                try {
+                    Files.deleteIfExists(p);
+                } catch (IOException ignored) {
+                }
+            });
+        }
+    }
+}
@@ -2,7 +2,9 @@ package by.radioegor146.helpers;
 
 import java.io.*;
 import java.nio.file.Path;
+import java.util.Collections;
 import java.util.List;
+import java.util.Map;
 import java.util.concurrent.ExecutorService;
 import java.util.concurrent.Executors;
 import java.util.concurrent.TimeUnit;
@@ -60,7 +62,14 @@ public class ProcessHelper {
     }
 
     public static ProcessResult run(Path directory, long timeLimit, List<String> command) throws IOException {
-        Process process = new ProcessBuilder(command).directory(directory.toFile()).start();
+        return run(directory, timeLimit, command, Collections.emptyMap());
+    }
+
+    public static ProcessResult run(Path directory, long timeLimit, List<String> command,
+                                    Map<String, String> environment) throws IOException {
+        ProcessBuilder processBuilder = new ProcessBuilder(command).directory(directory.toFile());
+        processBuilder.environment().putAll(environment);
+        Process process = processBuilder.start();
         long startTime = System.currentTimeMillis();
 
         ProcessResult result = new ProcessResult();
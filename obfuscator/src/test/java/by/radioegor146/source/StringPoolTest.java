@@ -37,21 +37,53 @@ public class StringPoolTest {
         String res1 = stringPool.get("test");
         assertTrue(res1.startsWith(prefix));
         assertTrue(res1.contains("string_pool::decode_nonce("));
-        assertTrue(res1.endsWith(", 0LL, 5), (char *)(string_pool + 0LL))"));
+        assertTrue(res1.endsWith(", string_section + 0LL, 5), (char *)(string_pool + string_section + 0LL))"));
         assertEquals(res1, stringPool.get("test"));
         assertFalse(res1.contains("(unsigned char[]){"));
 
         String res3 = stringPool.get("\u0080\u0050");
         assertTrue(res3.startsWith(prefix));
-        assertTrue(res3.endsWith(", 5LL, 4), (char *)(string_pool + 5LL))"));
+        assertTrue(res3.endsWith(", string_section + 5LL, 4), (char *)(string_pool + string_section + 5LL))"));
 
         String res4 = stringPool.get("\u0800");
         assertTrue(res4.startsWith(prefix));
-        assertTrue(res4.endsWith(", 9LL, 4), (char *)(string_pool + 9LL))"));
+        assertTrue(res4.endsWith(", string_section + 9LL, 4), (char *)(string_pool + string_section + 9LL))"));
 
         String res5 = stringPool.get("\u0080");
         assertTrue(res5.startsWith(prefix));
-        assertTrue(res5.endsWith(", 13LL, 3), (char *)(string_pool + 13LL))"));
+        assertTrue(res5.endsWith(", string_section + 13LL, 3), (char *)(string_pool + string_section + 13LL))"));
+    }
+
+    @Test
+    public void testGetTableEntry() {
+        StringPool stringPool = new StringPool();
+        stringPool.get("test");
+        String entry = stringPool.getTableEntry("other");
+        assertTrue(entry.startsWith("{ []{ static const unsigned char data[32] = { "));
+        assertTrue(entry.contains("static const unsigned char data[12] = { "));
+        // UTF-16LE with a terminator, stored apart from the get() entry
+        assertTrue(entry.matches("(?s).*, \\d+U, 0U, 5LL, 12 }"));
+        assertEquals(entry, stringPool.getTableEntry("other"));
+        assertTrue(stringPool.get("other").endsWith(", string_section + 17LL, 6), (char *)(string_pool + string_section + 17LL))"));
+        assertEquals(3, stringPool.getStringCount());
+        assertTrue(stringPool.build().contains("static unsigned char pool[23LL]"));
+    }
+
+    @Test
+    public void testSections() {
+        StringPool stringPool = new StringPool();
+        stringPool.beginSection(0);
+        stringPool.get("test");
+        stringPool.beginSection(2);
+        // Offsets restart in every section, and shared strings are stored per section
+        assertTrue(stringPool.get("test").endsWith(", string_section + 0LL, 5), (char *)(string_pool + string_section + 0LL))"));
+        assertTrue(stringPool.getTableEntry("other").matches("(?s).*, \\d+U, 2U, 5LL, 12 }"));
+        assertEquals(3, stringPool.getStringCount());
+        assertEquals(22, stringPool.getTotalLength());
+
+        String build = stringPool.build();
+        assertTrue(build.contains("static unsigned char pool[22LL]"));
+        assertTrue(build.contains("static const std::size_t sections[3] = { 0U, 5U, 5U };"));
     }
 
     @Test
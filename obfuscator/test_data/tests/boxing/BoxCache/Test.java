@@ -0,0 +1,38 @@
+import java.util.ArrayList;
+import java.util.List;
+
+public class Test {
+    public static void main(String[] args) {
+        List<Integer> values = new ArrayList<>();
+        for (int i = -200; i <= 200; i += 25) {
+            values.add(i);
+        }
+        int sum = 0;
+        for (int value : values) {
+            sum += value;
+        }
+        System.out.println(sum);
+
+        Integer a = 127, b = 127, c = 128, d = 128;
+        System.out.println((a == b) + " " + (c.equals(d)));
+        Long e = -128L, f = -128L;
+        System.out.println(e == f);
+        Boolean g = true, h = Boolean.valueOf(true);
+        System.out.println(g == h);
+        Character i = 'x', j = 'x';
+        System.out.println(i == j);
+        Double k = 1.5;
+        Float l = 2.5f;
+        Short m = (short) -3;
+        Byte n = (byte) 7;
+        System.out.println(k + l + m + n);
+
+        Integer missing = null;
+        try {
+            int unboxed = missing;
+            System.out.println("fail " + unboxed);
+        } catch (NullPointerException ex) {
+            System.out.println("Caught");
+        }
+    }
+}
@@ -0,0 +1,58 @@
+public class Test {
+    private static int counter;
+
+    private static int next() {
+        return ++counter;
+    }
+
+    private static String describe(String name, int count, long total, boolean flag, char grade, byte b, short s) {
+        return "name=" + name + ", count=" + count + ", total=" + total + ", flag=" + flag + ", grade=" + grade
+                + ", b=" + b + ", s=" + s;
+    }
+
+    public static void main(String[] args) {
+        System.out.println(describe("alpha", -42, Long.MIN_VALUE, true, 'Z', (byte) -128, Short.MAX_VALUE));
+        System.out.println(describe(null, Integer.MIN_VALUE, 0L, false, '\u00e9', (byte) 0, (short) -1));
+        byte negativeByte = (byte) (counter - 100);
+        short negativeShort = (short) (counter - 30000);
+        System.out.println("bytes " + negativeByte + " " + Byte.MIN_VALUE + " " + negativeShort + " " + (short) -32768);
+
+        float[] floats = {0.0f, -0.0f, 1.0f, 0.1f, 1.0f / 3, 1.0E7f, 9999999.0f, 1.0E-3f, 9.999E-4f,
+                Float.MIN_VALUE, Float.MAX_VALUE, Float.NaN, Float.NEGATIVE_INFINITY, 123456.79f,
+                // Powers of two, with a narrower rounding interval below
+                0x1p-96f, 0x1p-126f, 0x1p100f};
+        for (float value : floats) {
+            System.out.println("f:" + value);
+        }
+        double[] doubles = {0.0, -0.0, 1.0, 0.1, 1.0 / 3, 1.0E7, 9999999.999, 1.0E-3, 2.0E23, 1.0E23,
+                Double.MIN_VALUE, Double.MAX_VALUE, Double.NaN, Double.POSITIVE_INFINITY, Math.PI, -2.5E-10,
+                0x1p-1017, 0x1p-957, 0x1p-166, 0x1p-1022, 0x1p1023};
+        for (double value : doubles) {
+            System.out.println("d:" + value);
+        }
+
+        String empty = "";
+        System.out.println(empty + empty);
+        System.out.println("" + next() + next() + "|" + counter);
+        System.out.println("nested " + ("[" + next() + "]").length() + " " + ("x" + "y" + 'z'));
+        System.out.println("unicode \u041f\u0440\u0438\u0432\u0435\u0442 " + "\ud83d\ude00" + 1);
+
+        StringBuilder escaped = new StringBuilder("kept");
+        escaped.append(':').append(counter);
+        System.out.println(escaped + " " + escaped.length());
+
+        Object object = new Object() {
+            @Override
+            public String toString() {
+                return "object";
+            }
+        };
+        System.out.println("object " + object + " " + (counter > 2 ? "big" : "small"));
+
+        String accumulated = "";
+        for (int i = 0; i < 5; i++) {
+            accumulated += i + ",";
+        }
+        System.out.println(accumulated);
+    }
+}